@@ -21,6 +21,11 @@
 
 /* maximum message size for incoming and outgoing RSs and RAs */
 #define MSG_SIZE_RECV ((64 * 1024)-1) // Largest possible IPv6 packet size without Jumbograms
+#define RECV_BATCH_MAX 32 // Most packets received by one recvmmsg call
+#define DFLT_RecvBatch RECV_BATCH_MAX
+#define SEND_BATCH_MAX 64 // Most RAs sent by one sendmmsg call
+#define MAX_EXPIRED_IFACES_PER_WAKEUP 64 // Bound on timer work done between two polls of the sockets
+#define FORWARDING_REFRESH_INTERVAL 60 // Seconds between reads of the forwarding setting without netconf
 #define RFC2460_MIN_MTU 1280 /* RFC2460 5. Packet Size Issues: lowest valid MTU supported by IPv6 */
 
 #define MAX2(X, Y) (((X) >= (Y)) ? (X) : (Y))
@@ -48,6 +53,7 @@
 #define DFLT_UnicastOnly 0
 #define DFLT_UnrestrictedUnicast 0
 #define DFLT_AdvRASolicitedUnicast 1
+#define DFLT_AdvOptionScheduling 0
 #define DFLT_RemoveAdvOnExit 1
 
 /* Options sent with RA */
@@ -105,6 +111,8 @@
 
 #define MAX_INITIAL_RTR_ADVERT_INTERVAL 16
 #define MAX_INITIAL_RTR_ADVERTISEMENTS 3
+#define MIN_OPTION_REFRESHES 3 // Times an option is sent per lifetime at least, when they are scheduled
+#define DFLT_PaceWindow 0 // Seconds the initial RAs of all interfaces are spread over
 #define MAX_FINAL_RTR_ADVERTISEMENTS 3
 #define MIN_DELAY_BETWEEN_RAS 3.0
 #define MIN_DELAY_BETWEEN_RAS_MIPv6 (30.0 / 1000.0)
@@ -184,6 +184,18 @@ int check_ip6_forwarding(void)
 	return 0;
 }
 
+int set_ip6_forwarding(int value)
+{
+	dlog(LOG_DEBUG, 4, "tracking ipv6 forwarding not supported");
+	return 0;
+}
+
+int64_t get_rs_ra_received(const char *iface)
+{
+	dlog(LOG_DEBUG, 4, "counting received RSs and RAs not supported");
+	return -1;
+}
+
 int check_ip6_iface_forwarding(const char *iface)
 {
 	dlog(LOG_DEBUG, 4, "checking ipv6 forwarding of interface not supported");
@@ -18,6 +18,10 @@
 #include "pathnames.h"
 #include "radvd.h"
 
+#ifdef HAVE_NETLINK
+#include "netlink.h"
+#endif
+
 int check_device(int sock, struct Interface *iface)
 {
 	struct ifreq ifr;
@@ -61,8 +65,10 @@ int check_device(int sock, struct Interface *iface)
 
 int get_v4addr(const char *ifn, unsigned int *dst)
 {
-
-	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	/* asked for every RA with a 6to4 prefix, so the socket is kept */
+	static int fd = -1;
+	if (fd < 0)
+		fd = socket(AF_INET, SOCK_DGRAM, 0);
 	if (fd < 0) {
 		flog(LOG_ERR, "create socket for IPv4 ioctl failed on %s: %s", ifn, strerror(errno));
 		return -1;
@@ -75,7 +81,6 @@ int get_v4addr(const char *ifn, unsigned int *dst)
 
 	if (ioctl(fd, SIOCGIFADDR, &ifr) < 0) {
 		flog(LOG_ERR, "ioctl(SIOCGIFADDR) failed on %s: %s", ifn, strerror(errno));
-		close(fd);
 		return -1;
 	}
 
@@ -85,13 +90,54 @@ int get_v4addr(const char *ifn, unsigned int *dst)
 
 	*dst = addr->sin_addr.s_addr;
 
-	close(fd);
-
 	return 0;
 }
 
 static int cmp_iface_addrs(void const *a, void const *b) { return memcmp(a, b, sizeof(struct in6_addr)); }
 
+/* Whether addr is one of the addresses setup_iface_addrs found on iface. */
+int iface_has_addr(struct Interface const *iface, struct in6_addr const *addr)
+{
+	if (!iface->props.if_addrs || iface->props.addrs_count <= 0)
+		return 0;
+	return NULL != bsearch(addr, iface->props.if_addrs, iface->props.addrs_count, sizeof(struct in6_addr), cmp_iface_addrs);
+}
+
+/*
+ * getifaddrs dumps every address of every interface, so the auto prefixes
+ * keep its list until netlink tells of an address it doesn't have, or of
+ * one of its addresses being deleted.
+ */
+static struct ifaddrs *ifaddrs_snapshot;
+
+struct ifaddrs const *get_ifaddrs_snapshot(void)
+{
+	if (!ifaddrs_snapshot && getifaddrs(&ifaddrs_snapshot) != 0) {
+		flog(LOG_ERR, "getifaddrs failed: %s", strerror(errno));
+		ifaddrs_snapshot = NULL;
+	}
+	return ifaddrs_snapshot;
+}
+
+void drop_ifaddrs_snapshot(void)
+{
+	if (ifaddrs_snapshot)
+		freeifaddrs(ifaddrs_snapshot);
+	ifaddrs_snapshot = NULL;
+}
+
+/* Drop the snapshot if addr being added, or deleted if deleted is set, changes it. */
+void note_address_change(struct in6_addr const *addr, int deleted)
+{
+	int found = 0;
+	for (struct ifaddrs const *ifa = ifaddrs_snapshot; ifa && !found; ifa = ifa->ifa_next) {
+		found = ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET6 &&
+			IN6_ARE_ADDR_EQUAL(&((struct sockaddr_in6 const *)ifa->ifa_addr)->sin6_addr, addr);
+	}
+	if (found == deleted)
+		drop_ifaddrs_snapshot();
+}
+
 /*
  * Return first IPv6 link local addr in if_addr.
  * Return all the IPv6 addresses in if_addrs in ascending
@@ -161,7 +207,13 @@ int get_iface_addrs(char const *name, struct in6_addr *if_addr, struct in6_addr
  */
 int setup_iface_addrs(struct Interface *iface)
 {
+#ifdef HAVE_NETLINK
+	int rc = netlink_get_iface_addrs(iface->props.if_index, iface->props.name, &iface->props.if_addr, &iface->props.if_addrs);
+	if (rc == -2)
+		rc = get_iface_addrs(iface->props.name, &iface->props.if_addr, &iface->props.if_addrs);
+#else
 	int rc = get_iface_addrs(iface->props.name, &iface->props.if_addr, &iface->props.if_addrs);
+#endif
 
 	if (-1 != rc) {
 		iface->props.addrs_count = rc;
@@ -193,6 +245,8 @@ int setup_iface_addrs(struct Interface *iface)
 			iface->props.if_addr_rasrc = &iface->props.if_addr;
 		}
 	} else {
+		/* the list was read again, the count of the old one no longer fits it */
+		iface->props.addrs_count = 0;
 		if (iface->IgnoreIfMissing)
 			dlog(LOG_DEBUG, 4, "no linklocal address configured on %s", iface->props.name);
 		else
@@ -271,7 +271,36 @@ int check_ip6_iface_forwarding(const char *iface)
 	return value;
 }
 
-int check_ip6_forwarding(void)
+/* The number of RSs and RAs the kernel has received on iface so far, or -1 if unknown. */
+int64_t get_rs_ra_received(const char *iface)
+{
+	char path[sizeof(PROC_NET_IFACE_SNMP6) + IFNAMSIZ];
+	snprintf(path, sizeof(path), PROC_NET_IFACE_SNMP6, iface);
+
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		dlog(LOG_DEBUG, 4, "cannot open %s: %s", path, strerror(errno));
+		return -1;
+	}
+
+	int64_t received = 0;
+	char name[64];
+	unsigned long long value;
+	while (fscanf(fp, "%63s %llu", name, &value) == 2) {
+		if (!strcmp(name, "Icmp6InRouterSolicits") || !strcmp(name, "Icmp6InRouterAdvertisements"))
+			received += value;
+	}
+	fclose(fp);
+
+	return received;
+}
+
+/* The all/forwarding sysctl as last read or notified, and where that came from. */
+static int ip6_forwarding = -1;
+static enum { FORWARDING_UNKNOWN, FORWARDING_READ, FORWARDING_NOTIFIED } ip6_forwarding_source = FORWARDING_UNKNOWN;
+static struct timespec ip6_forwarding_read_time;
+
+static int read_ip6_forwarding(void)
 {
 	int value;
 	FILE *fp = NULL;
@@ -297,25 +326,64 @@ int check_ip6_forwarding(void)
 	if (!fp && sysctl(forw_sysctl, sizeof(forw_sysctl) / sizeof(forw_sysctl[0]), &value, &size, NULL, 0) < 0) {
 		flog(LOG_DEBUG, "Correct IPv6 forwarding sysctl branch not found, "
 				"perhaps the kernel interface has changed?");
-		return 0; /* this is of advisory value only */
+		return 1; /* this is of advisory value only */
 	}
 #endif
 
-	/* Linux allows the forwarding value to be either 1 or 2.
-	 * https://git.kernel.org/cgit/linux/kernel/git/torvalds/linux.git/tree/Documentation/networking/ip-sysctl.txt?id=ae8abfa00efb8ec550f772cbd1e1854977d06212#n1078
-	 *
-	 * The value 2 indicates forwarding is enabled and that *AS* *WELL* router solicitations are being done.
-	 *
-	 * Which is sometimes used on routers performing RS on their WAN (ppp, etc.) links
-	 */
-	static int warned = 0;
-	if (!warned && value != 1 && value != 2) {
-		warned = 1;
-		flog(LOG_DEBUG, "IPv6 forwarding setting is: %u, should be 1 or 2", value);
-		return -1;
+	return value;
+}
+
+/* Linux allows the forwarding value to be either 1 or 2.
+ * https://git.kernel.org/cgit/linux/kernel/git/torvalds/linux.git/tree/Documentation/networking/ip-sysctl.txt?id=ae8abfa00efb8ec550f772cbd1e1854977d06212#n1078
+ *
+ * The value 2 indicates forwarding is enabled and that *AS* *WELL* router solicitations are being done.
+ *
+ * Which is sometimes used on routers performing RS on their WAN (ppp, etc.) links
+ */
+static int forwarding_enabled(int value) { return value == 1 || value == 2; }
+
+/* Take value as the forwarding setting, returns 1 if that enables or disables forwarding. */
+static int note_ip6_forwarding(int value)
+{
+	int flipped = ip6_forwarding_source != FORWARDING_UNKNOWN && forwarding_enabled(value) != forwarding_enabled(ip6_forwarding);
+
+	if (flipped)
+		flog(LOG_INFO, "IPv6 forwarding is now %s", forwarding_enabled(value) ? "enabled" : "disabled");
+	else if (ip6_forwarding_source == FORWARDING_UNKNOWN && !forwarding_enabled(value))
+		flog(LOG_DEBUG, "IPv6 forwarding setting is: %d, should be 1 or 2", value);
+
+	ip6_forwarding = value;
+	return flipped;
+}
+
+/*
+ * Returns 0 if IPv6 forwarding is enabled, -1 if not.  This is asked for
+ * every RA, so the setting is kept here: netlink.c passes on the netconf
+ * notifications of the kernel, and until one arrives procfs is read again
+ * every FORWARDING_REFRESH_INTERVAL seconds.
+ */
+int check_ip6_forwarding(void)
+{
+	if (ip6_forwarding_source != FORWARDING_NOTIFIED) {
+		struct timespec now;
+		clock_now(&now);
+		if (ip6_forwarding_source == FORWARDING_UNKNOWN ||
+		    timespecdiff(&now, &ip6_forwarding_read_time) >= FORWARDING_REFRESH_INTERVAL * 1000) {
+			note_ip6_forwarding(read_ip6_forwarding());
+			ip6_forwarding_source = FORWARDING_READ;
+			ip6_forwarding_read_time = now;
+		}
 	}
 
-	return 0;
+	return forwarding_enabled(ip6_forwarding) ? 0 : -1;
+}
+
+/* The forwarding setting as notified by netconf, returns 1 if that enables or disables forwarding. */
+int set_ip6_forwarding(int value)
+{
+	int flipped = note_ip6_forwarding(value);
+	ip6_forwarding_source = FORWARDING_NOTIFIED;
+	return flipped;
 }
 
 static char const *hwstr(unsigned short sa_family)
@@ -0,0 +1,223 @@
+/*
+ *
+ *   Authors:
+ *    Lars Fenneberg		<lf@elemental.net>
+ *    Reuben Hawkins		<reubenhwk@gmail.com>
+ *
+ *   This software is Copyright 1996,1997 by the above mentioned author(s),
+ *   All Rights Reserved.
+ *
+ *   The license which is distributed with this software in the file COPYRIGHT
+ *   applies to this software. If your distribution is missing this file, you
+ *   may request it from https://github.com/radvd-project/radvd/issues
+ *
+ */
+
+#include "config.h"
+#include "includes.h"
+#include "radvd.h"
+
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+/*
+ * Linux event loop: every descriptor lives in one epoll set, the earliest
+ * interface deadline arms a single timerfd with an absolute, nanosecond
+ * precision expiry, and the signals are read synchronously from a signalfd.
+ */
+
+#define EVENT_MAX_EVENTS 16
+
+struct event_fd {
+	void (*handler)(int fd, void *data);
+	void *data;
+};
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static int signal_fd = -1;
+static struct timespec timer_armed;
+
+static sigset_t signal_mask;
+static void (*signal_handlers[NSIG])(int sig);
+
+/* Indexed by descriptor so a wakeup finds its handler in O(1). */
+static struct event_fd *event_fds = NULL;
+static int event_fds_len = 0;
+
+static void timer_fd_handler(int fd, void *data);
+static void signal_fd_handler(int fd, void *data);
+
+void event_init(void)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		flog(LOG_ERR, "epoll_create1 failed: %s", strerror(errno));
+		exit(1);
+	}
+
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timer_fd < 0) {
+		flog(LOG_ERR, "timerfd_create failed: %s", strerror(errno));
+		exit(1);
+	}
+	memset(&timer_armed, 0, sizeof(timer_armed));
+
+	sigemptyset(&signal_mask);
+
+	event_add_fd(timer_fd, timer_fd_handler, 0);
+}
+
+void event_close(void)
+{
+	free(event_fds);
+	event_fds = NULL;
+	event_fds_len = 0;
+
+	if (signal_fd >= 0) {
+		close(signal_fd);
+		signal_fd = -1;
+	}
+
+	if (timer_fd >= 0) {
+		close(timer_fd);
+		timer_fd = -1;
+	}
+
+	if (epoll_fd >= 0) {
+		close(epoll_fd);
+		epoll_fd = -1;
+	}
+}
+
+void event_add_fd(int fd, void (*handler)(int fd, void *data), void *data)
+{
+	if (fd >= event_fds_len) {
+		int len = fd + 1;
+		event_fds = realloc(event_fds, len * sizeof(*event_fds));
+		if (!event_fds) {
+			flog(LOG_ERR, "unable to grow the event table to %d descriptors", len);
+			exit(1);
+		}
+		memset(&event_fds[event_fds_len], 0, (len - event_fds_len) * sizeof(*event_fds));
+		event_fds_len = len;
+	}
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+
+	int op = event_fds[fd].handler ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+		flog(LOG_ERR, "epoll_ctl failed to add fd %d: %s", fd, strerror(errno));
+		exit(1);
+	}
+
+	event_fds[fd].handler = handler;
+	event_fds[fd].data = data;
+}
+
+void event_del_fd(int fd)
+{
+	if (fd < 0 || fd >= event_fds_len || !event_fds[fd].handler)
+		return;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, 0) < 0) {
+		flog(LOG_WARNING, "epoll_ctl failed to remove fd %d: %s", fd, strerror(errno));
+	}
+
+	event_fds[fd].handler = 0;
+	event_fds[fd].data = 0;
+}
+
+void event_add_signal(int sig, void (*handler)(int sig))
+{
+	signal_handlers[sig] = handler;
+
+	sigaddset(&signal_mask, sig);
+	sigprocmask(SIG_BLOCK, &signal_mask, NULL);
+
+	int fd = signalfd(signal_fd, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0) {
+		flog(LOG_ERR, "signalfd failed: %s", strerror(errno));
+		exit(1);
+	}
+
+	if (signal_fd < 0) {
+		signal_fd = fd;
+		event_add_fd(signal_fd, signal_fd_handler, 0);
+	}
+}
+
+/*
+ * Wait for the descriptors and signals until the absolute CLOCK_MONOTONIC
+ * deadline, or forever if there is none, and run their handlers.  Returns
+ * the number of events handled or -1 on error.
+ */
+int event_wait(struct timespec const *deadline)
+{
+	struct itimerspec its;
+	memset(&its, 0, sizeof(its));
+
+	if (deadline) {
+		its.it_value = *deadline;
+		/* An all zero it_value disarms the timer instead of firing it. */
+		if (!its.it_value.tv_sec && !its.it_value.tv_nsec)
+			its.it_value.tv_nsec = 1;
+	}
+
+	if (its.it_value.tv_sec != timer_armed.tv_sec || its.it_value.tv_nsec != timer_armed.tv_nsec) {
+		if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, 0) < 0) {
+			flog(LOG_ERR, "timerfd_settime failed: %s", strerror(errno));
+			return -1;
+		}
+		timer_armed = its.it_value;
+	}
+
+	struct epoll_event events[EVENT_MAX_EVENTS];
+	int rc = epoll_wait(epoll_fd, events, EVENT_MAX_EVENTS, -1);
+	if (rc < 0) {
+		dlog(LOG_INFO, 3, "epoll_wait returned early: %s", strerror(errno));
+		return -1;
+	}
+
+	for (int i = 0; i < rc; ++i) {
+		int fd = events[i].data.fd;
+
+		/* An earlier handler may have removed this descriptor. */
+		if (fd >= event_fds_len || !event_fds[fd].handler)
+			continue;
+
+		if (events[i].events & EPOLLIN) {
+			event_fds[fd].handler(fd, event_fds[fd].data);
+		} else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+			flog(LOG_WARNING, "socket error on fd %d", fd);
+		}
+	}
+
+	return rc;
+}
+
+static void timer_fd_handler(int fd, void *data)
+{
+	uint64_t expirations;
+
+	if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+		flog(LOG_WARNING, "timerfd read failed: %s", strerror(errno));
+	}
+
+	/* The expiry is consumed, so the next event_wait must rearm it. */
+	memset(&timer_armed, 0, sizeof(timer_armed));
+}
+
+static void signal_fd_handler(int fd, void *data)
+{
+	struct signalfd_siginfo si;
+
+	while (read(fd, &si, sizeof(si)) == sizeof(si)) {
+		if (si.ssi_signo < NSIG && signal_handlers[si.ssi_signo])
+			signal_handlers[si.ssi_signo](si.ssi_signo);
+	}
+}
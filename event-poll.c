@@ -0,0 +1,182 @@
+/*
+ *
+ *   Authors:
+ *    Lars Fenneberg		<lf@elemental.net>
+ *    Reuben Hawkins		<reubenhwk@gmail.com>
+ *
+ *   This software is Copyright 1996,1997 by the above mentioned author(s),
+ *   All Rights Reserved.
+ *
+ *   The license which is distributed with this software in the file COPYRIGHT
+ *   applies to this software. If your distribution is missing this file, you
+ *   may request it from https://github.com/radvd-project/radvd/issues
+ *
+ */
+
+#include "config.h"
+#include "includes.h"
+#include "radvd.h"
+
+#include <poll.h>
+
+/*
+ * Portable event loop built on ppoll, or poll where ppoll is missing.  The
+ * signals are blocked outside of the wait and delivered to their handlers
+ * through sigaction.
+ */
+
+struct event_fd {
+	void (*handler)(int fd, void *data);
+	void *data;
+};
+
+static sigset_t signal_mask;
+
+/* Indexed by descriptor so a wakeup finds its handler in O(1). */
+static struct event_fd *event_fds = NULL;
+static int event_fds_len = 0;
+
+/* Rebuilt from event_fds before the next wait whenever a descriptor is added or removed. */
+static struct pollfd *pollfds = NULL;
+static int pollfds_len = 0;
+static int pollfds_dirty = 0;
+
+void event_init(void)
+{
+	sigemptyset(&signal_mask);
+	pollfds_dirty = 1;
+}
+
+void event_close(void)
+{
+	free(event_fds);
+	event_fds = NULL;
+	event_fds_len = 0;
+
+	free(pollfds);
+	pollfds = NULL;
+	pollfds_len = 0;
+}
+
+void event_add_fd(int fd, void (*handler)(int fd, void *data), void *data)
+{
+	if (fd >= event_fds_len) {
+		int len = fd + 1;
+		event_fds = realloc(event_fds, len * sizeof(*event_fds));
+		if (!event_fds) {
+			flog(LOG_ERR, "unable to grow the event table to %d descriptors", len);
+			exit(1);
+		}
+		memset(&event_fds[event_fds_len], 0, (len - event_fds_len) * sizeof(*event_fds));
+		event_fds_len = len;
+	}
+
+	event_fds[fd].handler = handler;
+	event_fds[fd].data = data;
+	pollfds_dirty = 1;
+}
+
+void event_del_fd(int fd)
+{
+	if (fd < 0 || fd >= event_fds_len || !event_fds[fd].handler)
+		return;
+
+	event_fds[fd].handler = 0;
+	event_fds[fd].data = 0;
+	pollfds_dirty = 1;
+}
+
+void event_add_signal(int sig, void (*handler)(int sig))
+{
+	struct sigaction sa;
+
+	sigaddset(&signal_mask, sig);
+	sigprocmask(SIG_BLOCK, &signal_mask, NULL);
+
+	sa.sa_handler = handler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(sig, &sa, 0);
+}
+
+static void rebuild_pollfds(void)
+{
+	pollfds = realloc(pollfds, (event_fds_len ? event_fds_len : 1) * sizeof(*pollfds));
+	if (!pollfds) {
+		flog(LOG_ERR, "unable to grow the poll set to %d descriptors", event_fds_len);
+		exit(1);
+	}
+
+	pollfds_len = 0;
+	for (int fd = 0; fd < event_fds_len; ++fd) {
+		if (event_fds[fd].handler) {
+			pollfds[pollfds_len].fd = fd;
+			pollfds[pollfds_len].events = POLLIN;
+			pollfds[pollfds_len].revents = 0;
+			++pollfds_len;
+		}
+	}
+
+	pollfds_dirty = 0;
+}
+
+/*
+ * Wait for the descriptors and signals until the absolute CLOCK_MONOTONIC
+ * deadline, or forever if there is none, and run their handlers.  Returns
+ * the number of events handled or -1 on error.
+ */
+int event_wait(struct timespec const *deadline)
+{
+	if (pollfds_dirty)
+		rebuild_pollfds();
+
+	struct timespec ts;
+	struct timespec *tsp = 0;
+	if (deadline) {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		int64_t nsec = ((int64_t)deadline->tv_sec - ts.tv_sec) * 1000000000LL + ((int64_t)deadline->tv_nsec - ts.tv_nsec);
+		if (nsec < 0)
+			nsec = 0;
+		ts.tv_sec = nsec / 1000000000LL;
+		ts.tv_nsec = nsec % 1000000000LL;
+		tsp = &ts;
+	}
+
+#ifdef HAVE_PPOLL
+	sigset_t sigempty;
+	sigemptyset(&sigempty);
+	int rc = ppoll(pollfds, pollfds_len, tsp, &sigempty);
+#else
+	/* Round up so the deadline is never missed by waking up early. */
+	int timeout = tsp ? tsp->tv_sec * 1000 + (tsp->tv_nsec + 999999) / 1000000 : -1;
+	sigprocmask(SIG_UNBLOCK, &signal_mask, NULL);
+	int rc = poll(pollfds, pollfds_len, timeout);
+	sigprocmask(SIG_BLOCK, &signal_mask, NULL);
+#endif
+
+	if (rc < 0) {
+		dlog(LOG_INFO, 3, "poll returned early: %s", strerror(errno));
+		return -1;
+	}
+
+	int handled = 0;
+	for (int i = 0; i < pollfds_len && handled < rc; ++i) {
+		int fd = pollfds[i].fd;
+
+		if (!pollfds[i].revents)
+			continue;
+		++handled;
+
+		/* An earlier handler may have removed this descriptor. */
+		if (fd >= event_fds_len || !event_fds[fd].handler)
+			continue;
+
+		if (pollfds[i].revents & POLLIN) {
+			event_fds[fd].handler(fd, event_fds[fd].data);
+		} else if (pollfds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+			flog(LOG_WARNING, "socket error on fd %d", fd);
+		}
+	}
+
+	return rc;
+}
@@ -104,6 +104,7 @@ int yylex_destroy (void);
 %token		T_UnicastOnly
 %token		T_UnrestrictedUnicast
 %token		T_AdvRASolicitedUnicast
+%token		T_AdvOptionScheduling
 %token		T_AdvCaptivePortalAPI
 
 %token		T_HomeAgentPreference
@@ -367,6 +368,10 @@ ifaceval	: T_MinRtrAdvInterval NUMBER ';'
 		{
 			iface->AdvRASolicitedUnicast = $2;
 		}
+		| T_AdvOptionScheduling SWITCH ';'
+		{
+			iface->AdvOptionScheduling = $2;
+		}
 		| T_AdvCaptivePortalAPI STRING ';'
 		{
 			const char *source = $2;
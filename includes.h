@@ -22,6 +22,7 @@
 #include <pwd.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -61,6 +62,7 @@
 #endif
 
 #include <sys/ioctl.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/uio.h>
@@ -108,3 +110,7 @@
 #ifdef HAVE_LINUX_IF_ARP_H
 #include <linux/if_arp.h>
 #endif
+
+#ifdef HAVE_LINUX_FILTER_H
+#include <linux/filter.h>
+#endif
@@ -19,11 +19,20 @@
 
 #define IFACE_SETUP_DELAY 1
 
+static int setup_iface_state(int sock, struct Interface *iface, int *addrs_changed);
+
+#ifdef UNIT_TEST
+#include "test/interface.c"
+#endif
+
 void iface_init_defaults(struct Interface *iface)
 {
 	memset(iface, 0, sizeof(struct Interface));
 
 	iface->state_info.changed = 1;
+	iface->state_info.forwarding = -1;
+	iface->state_info.rx_kernel_base = -1;
+	iface->props.sock = -1;
 
 	iface->IgnoreIfMissing = DFLT_IgnoreIfMissing;
 	iface->AdvSendAdvert = DFLT_AdvSendAdv;
@@ -35,6 +44,7 @@ void iface_init_defaults(struct Interface *iface)
 	iface->UnicastOnly = DFLT_UnicastOnly;
 	iface->UnrestrictedUnicast = DFLT_UnrestrictedUnicast;
 	iface->AdvRASolicitedUnicast = DFLT_AdvRASolicitedUnicast;
+	iface->AdvOptionScheduling = DFLT_AdvOptionScheduling;
 
 	iface->ra_header_info.AdvDefaultPreference = DFLT_AdvDefaultPreference;
 	iface->ra_header_info.AdvDefaultLifetime = -1;
@@ -54,17 +64,107 @@ void iface_init_defaults(struct Interface *iface)
 	iface->AdvRAMTU = DFLT_AdvRAMTU;
 }
 
+/*
+ * A change to iface has it set up again IFACE_SETUP_DELAY after the first
+ * one noticed: the changes that come within that time, as a link bouncing
+ * or a renumbering bring by the hundred, are handled by the same setup and
+ * start the initial RAs over once.
+ */
 void touch_iface(struct Interface *iface)
 {
+	++stats.iface_touches;
+	if (iface->state_info.touches++ > 0) {
+		++stats.iface_touches_coalesced;
+		return;
+	}
+
 	iface->state_info.changed = 1;
 	iface->state_info.ready = 0;
 	iface->state_info.racount = 0;
+	/* The hosts start over too, with all of the options. */
+	free_option_schedules(iface);
 	reschedule_iface(iface, 0);
 }
 
+/* Counts the RSs and RAs the kernel receives on iface from now on against those radvd receives. */
+void reset_iface_rx_stats(struct Interface *iface)
+{
+	iface->state_info.rx_kernel_base = get_rs_ra_received(iface->props.name);
+	iface->state_info.rx_packets = 0;
+}
+
+/*
+ * The RSs and RAs the kernel received on iface since reset_iface_rx_stats
+ * that radvd didn't: those the prefilter or a full socket buffer dropped,
+ * and those still queued.  -1 if the kernel's count can't be read.
+ */
+int64_t get_iface_rx_missed(struct Interface const *iface)
+{
+	if (iface->state_info.rx_kernel_base < 0)
+		return -1;
+
+	int64_t received = get_rs_ra_received(iface->props.name);
+	if (received < 0)
+		return -1;
+
+	int64_t missed = received - iface->state_info.rx_kernel_base - (int64_t)iface->state_info.rx_packets;
+	return missed > 0 ? missed : 0;
+}
+
+/* What setup_iface finds out about an interface that goes into its RAs. */
+struct iface_setup {
+	unsigned int if_index;
+	struct in6_addr if_addr;
+	struct in6_addr rasrc;
+	uint32_t max_ra_option_size;
+	struct sllao sllao;
+	int forwarding;
+	int ready;
+};
+
+static void get_iface_setup(struct Interface const *iface, struct iface_setup *setup)
+{
+	memset(setup, 0, sizeof(*setup));
+	setup->if_index = iface->props.if_index;
+	setup->if_addr = iface->props.if_addr;
+	if (iface->props.if_addr_rasrc)
+		setup->rasrc = *iface->props.if_addr_rasrc;
+	setup->max_ra_option_size = iface->props.max_ra_option_size;
+	memcpy(&setup->sllao, &iface->sllao, sizeof(setup->sllao));
+	setup->forwarding = iface->state_info.forwarding;
+	setup->ready = iface->state_info.ready;
+}
+
+/* sock is the shared socket, the one iface falls back to if its own can no longer follow it. */
 int setup_iface(int sock, struct Interface *iface)
 {
+	if (iface->state_info.touches > 1)
+		dlog(LOG_DEBUG, 3, "%s set up for %d changes at once", iface->props.name, iface->state_info.touches);
+	iface->state_info.touches = 0;
 	iface->state_info.changed = 0;
+
+	struct iface_setup before;
+	struct iface_setup after;
+	get_iface_setup(iface, &before);
+	int addrs_changed = 0;
+	int rc = setup_iface_state(sock, iface, &addrs_changed);
+	get_iface_setup(iface, &after);
+
+	/* A recreated interface counts from zero again, as does one that wasn't there to count from. */
+	if (after.if_index != before.if_index && (before.if_index || iface->state_info.rx_kernel_base < 0))
+		reset_iface_rx_stats(iface);
+
+	/* Without netlink this runs before every send, only a change may cost the RAs built. */
+	if (addrs_changed || memcmp(&before, &after, sizeof(before))) {
+		dlog(LOG_DEBUG, 4, "%s has changed, its RAs are built again", iface->props.name);
+		invalidate_ra_cache(iface);
+	}
+
+	return rc;
+}
+
+static int setup_iface_state(int sock, struct Interface *iface, int *addrs_changed)
+{
 	iface->state_info.ready = 0;
 
 	/* The device index must be setup first so we can search it later */
@@ -72,6 +172,15 @@ int setup_iface(int sock, struct Interface *iface)
 		return -1;
 	}
 
+	/* A recreated interface has a new index its own socket may not follow. */
+	if (iface->props.sock >= 0 && check_iface_socket(iface->props.name, iface->props.if_index) < 0) {
+		flog(LOG_WARNING, "%s has changed, receiving its packets on the shared socket", iface->props.name);
+		event_del_fd(iface->props.sock);
+		close_iface_socket(iface->props.name);
+		iface->props.sock = -1;
+		set_icmpv6_filter(sock, 1);
+	}
+
 	/* Check IFF_UP, IFF_RUNNING and IFF_MULTICAST */
 	if (check_device(sock, iface) < 0) {
 		return -2;
@@ -89,8 +198,18 @@ int setup_iface(int sock, struct Interface *iface)
 	}
 
 	/* Save the first link local address seen on the specified interface to
-	 * iface->props.if_addr and keep a list off all addrs in iface->props.if_addrs */
-	if (setup_iface_addrs(iface) < 0) {
+	 * iface->props.if_addr and keep a list off all addrs in iface->props.if_addrs.
+	 * The list is read into a new one to tell whether it changed. */
+	struct in6_addr *old_addrs = iface->props.if_addrs;
+	int old_count = iface->props.addrs_count;
+	iface->props.if_addrs = NULL;
+	int addrs = setup_iface_addrs(iface);
+	*addrs_changed = (addrs != old_count ||
+			  (addrs > 0 && memcmp(old_addrs, iface->props.if_addrs, addrs * sizeof(struct in6_addr))));
+	free(old_addrs);
+	if (addrs < 0) {
+		/* it may still point into the old list */
+		iface->props.if_addr_rasrc = NULL;
 		return -5;
 	}
 
@@ -100,6 +219,9 @@ int setup_iface(int sock, struct Interface *iface)
 		return -6;
 	}
 
+	if (iface->props.sock >= 0)
+		sock = iface->props.sock;
+
 	/* join the allrouters multicast group so we get the solicitations */
 	if (setup_allrouters_membership(sock, iface) < 0) {
 		return -7;
@@ -114,6 +236,9 @@ int setup_iface(int sock, struct Interface *iface)
 
 int cleanup_iface(int sock, struct Interface *iface)
 {
+	if (iface->props.sock >= 0)
+		sock = iface->props.sock;
+
 	/* leave the allrouters multicast group */
 	cleanup_allrouters_membership(sock, iface);
 	return 0;
@@ -183,8 +308,9 @@ int check_iface(struct Interface *iface)
 		flog(LOG_INFO, "using Mobile IPv6 extensions");
 	}
 
-	/* Check forwarding on interface */
-	if (check_ip6_iface_forwarding(iface->props.name) < 1) {
+	/* Check forwarding on interface, netlink.c keeps it up to date from here on */
+	iface->state_info.forwarding = check_ip6_iface_forwarding(iface->props.name);
+	if (iface->state_info.forwarding < 1) {
 		flog(LOG_WARNING, "IPv6 forwarding on interface seems to be disabled, but continuing anyway");
 	}
 
@@ -350,24 +476,195 @@ struct Interface *find_iface_by_name(struct Interface *iface, const char *name)
 	return 0;
 }
 
-struct Interface *find_iface_by_time(struct Interface *iface)
+/*
+ * The timer queue is a binary min-heap of interfaces keyed on
+ * times.next_multicast, so the main loop can find the next interface to
+ * expire in O(1) and reschedule_iface can reposition one in O(log n).
+ */
+static struct Interface **iface_queue = NULL;
+static size_t iface_queue_len = 0;
+static size_t iface_queue_size = 0;
+
+/* How much earlier than its deadline a timer may run, to share a wakeup with another. */
+static double timer_slack = 0;
+
+static int64_t timespec_nsec(struct timespec const *ts) { return (int64_t)ts->tv_sec * 1000000000LL + ts->tv_nsec; }
+
+static int iface_queue_before(struct Interface const *a, struct Interface const *b)
+{
+	return timespec_nsec(&a->times.next_multicast) < timespec_nsec(&b->times.next_multicast);
+}
+
+static void iface_queue_set(size_t i, struct Interface *iface)
 {
-	if (!iface) {
-		return 0;
+	iface_queue[i] = iface;
+	iface->times.queue_pos = i + 1;
+}
+
+static void iface_queue_sift_up(size_t i)
+{
+	struct Interface *iface = iface_queue[i];
+
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!iface_queue_before(iface, iface_queue[parent]))
+			break;
+		iface_queue_set(i, iface_queue[parent]);
+		i = parent;
+	}
+	iface_queue_set(i, iface);
+}
+
+static void iface_queue_sift_down(size_t i)
+{
+	struct Interface *iface = iface_queue[i];
+
+	for (;;) {
+		size_t child = 2 * i + 1;
+		if (child >= iface_queue_len)
+			break;
+		if (child + 1 < iface_queue_len && iface_queue_before(iface_queue[child + 1], iface_queue[child]))
+			child++;
+		if (!iface_queue_before(iface_queue[child], iface))
+			break;
+		iface_queue_set(i, iface_queue[child]);
+		i = child;
+	}
+	iface_queue_set(i, iface);
+}
+
+/* Restore the heap order after iface->times.next_multicast changed, queueing it if needed. */
+static void iface_queue_update(struct Interface *iface)
+{
+	if (!iface->times.queue_pos) {
+		iface_queue_add(iface);
+		return;
 	}
 
-	int timeout = next_time_msec(iface);
-	struct Interface *next = iface;
+	iface_queue_sift_up(iface->times.queue_pos - 1);
+	iface_queue_sift_down(iface->times.queue_pos - 1);
+}
 
-	for (iface = iface->next; iface; iface = iface->next) {
-		int t = next_time_msec(iface);
-		if (timeout > t) {
-			timeout = t;
-			next = iface;
+void iface_queue_add(struct Interface *iface)
+{
+	if (iface->times.queue_pos)
+		return;
+
+	if (iface_queue_len == iface_queue_size) {
+		iface_queue_size = iface_queue_size ? 2 * iface_queue_size : 16;
+		iface_queue = realloc(iface_queue, iface_queue_size * sizeof(*iface_queue));
+		if (!iface_queue) {
+			flog(LOG_ERR, "unable to grow the timer queue to %zu interfaces", iface_queue_size);
+			exit(1);
 		}
 	}
 
-	return next;
+	iface_queue_set(iface_queue_len++, iface);
+	iface_queue_sift_up(iface_queue_len - 1);
+}
+
+void iface_queue_remove(struct Interface *iface)
+{
+	if (!iface->times.queue_pos)
+		return;
+
+	size_t i = iface->times.queue_pos - 1;
+	iface->times.queue_pos = 0;
+
+	struct Interface *last = iface_queue[--iface_queue_len];
+	if (i == iface_queue_len)
+		return;
+
+	iface_queue_set(i, last);
+	iface_queue_sift_up(i);
+	iface_queue_sift_down(last->times.queue_pos - 1);
+}
+
+struct Interface *find_iface_by_time(void)
+{
+	if (!iface_queue_len) {
+		return 0;
+	}
+
+	return iface_queue[0];
+}
+
+/*
+ * Collect, from the subtree of the queue rooted at i, the interfaces whose
+ * deadline is before bound and whose earliest time has passed.  The heap
+ * order lets whole subtrees past the bound be skipped.
+ */
+static int iface_queue_collect(size_t i, int64_t bound, int64_t now, struct Interface **found, int count, int max)
+{
+	if (i >= iface_queue_len || count >= max)
+		return count;
+
+	struct Interface *iface = iface_queue[i];
+	if (timespec_nsec(&iface->times.next_multicast) > bound)
+		return count;
+
+	if (timespec_nsec(&iface->times.earliest_multicast) <= now)
+		found[count++] = iface;
+
+	count = iface_queue_collect(2 * i + 1, bound, now, found, count, max);
+	return iface_queue_collect(2 * i + 2, bound, now, found, count, max);
+}
+
+void set_timer_slack(double slack) { timer_slack = slack; }
+
+/*
+ * Run foo, in deadline order, for every interface whose timer has expired,
+ * but for at most max of them so a wakeup can't be monopolised by timers.
+ * With a timer slack, the interfaces allowed to run early are then handled
+ * in the same wakeup, saving each one a wakeup of its own.  foo is expected
+ * to reschedule the interface.  Returns the number of interfaces handled.
+ */
+int expire_ifaces(void (*foo)(struct Interface *, void *), void *data, int max)
+{
+	struct timespec now;
+	clock_now(&now);
+
+	/* to the ns, timespecdiff would take a deadline less than a ms away for expired */
+	int64_t now_nsec = timespec_nsec(&now);
+	int count = 0;
+	while (count < max) {
+		struct Interface *iface = find_iface_by_time();
+		if (!iface || timespec_nsec(&iface->times.next_multicast) > now_nsec)
+			break;
+		foo(iface, data);
+		++count;
+	}
+
+	if (timer_slack <= 0 || count >= max)
+		return count;
+
+	/* foo reschedules and so moves the interfaces, collect them first. */
+	struct Interface *early[MAX_EXPIRED_IFACES_PER_WAKEUP];
+	int found = iface_queue_collect(0, now_nsec + (int64_t)(timer_slack * 1000000000.0), now_nsec, early, 0,
+					min(max - count, MAX_EXPIRED_IFACES_PER_WAKEUP));
+
+	for (int i = 0; i < found; ++i) {
+		foo(early[i], data);
+	}
+	stats.timers_coalesced += found;
+
+	return count + found;
+}
+
+/* Sends the unsolicited RA of an expired interface, data is the socket. */
+void timer_handler(struct Interface *iface, void *data)
+{
+	int sock = *(int *)data;
+
+	dlog(LOG_DEBUG, 1, "timer_handler called for %s", iface->props.name);
+
+	if (send_ra_forall(sock, iface, NULL) != 0) {
+		dlog(LOG_DEBUG, 4, "send_ra_forall failed on interface %s", iface->props.name);
+	}
+
+	double next = rand_between(iface->MinRtrAdvInterval, iface->MaxRtrAdvInterval);
+
+	reschedule_iface(iface, next);
 }
 
 void reschedule_iface(struct Interface *iface, double next)
@@ -386,6 +683,64 @@ void reschedule_iface(struct Interface *iface, double next)
 	dlog(LOG_DEBUG, 5, "%s next scheduled RA in %g second(s)", iface->props.name, next);
 
 	iface->times.next_multicast = next_timespec(next);
+
+	/*
+	 * The RA may go out up to timer_slack early, but never closer than
+	 * MinRtrAdvInterval to the one just sent, so the intervals stay
+	 * within the randomised range of RFC 4861 6.2.4.
+	 */
+	double early = next - iface->MinRtrAdvInterval;
+	if (early > timer_slack)
+		early = timer_slack;
+	if (early > 0)
+		iface->times.earliest_multicast = next_timespec(next - early);
+	else
+		iface->times.earliest_multicast = iface->times.next_multicast;
+
+	iface_queue_update(iface);
+}
+
+/*
+ * Schedule the first multicast RA of an interface being kicked off in the
+ * slot-th of slots evenly spaced slots over window seconds, so that many
+ * interfaces don't all advertise at once.  The RAs after it follow the
+ * initial RA intervals of reschedule_iface as usual.
+ */
+void pace_iface(struct Interface *iface, double window, int slot, int slots)
+{
+	double next = slots > 0 ? window * slot / slots : 0;
+
+	/* never later than the second RA would have been without pacing */
+	next = min(next, min(MAX_INITIAL_RTR_ADVERT_INTERVAL, iface->MaxRtrAdvInterval));
+
+	dlog(LOG_DEBUG, 5, "%s first RA paced to %g second(s) from now", iface->props.name, next);
+
+	iface->times.next_multicast = next_timespec(next);
+	iface->times.earliest_multicast = iface->times.next_multicast;
+	iface_queue_update(iface);
+}
+
+/*
+ * Bring the next multicast RA of iface forward to as soon as MinDelayBetweenRAs
+ * allows, for a change the hosts should hear of now, like forwarding being
+ * disabled.  The RAs after it follow reschedule_iface as usual.
+ */
+void hasten_iface(struct Interface *iface)
+{
+	struct timespec now;
+	clock_now(&now);
+
+	double next = iface->MinDelayBetweenRAs - timespecdiff(&now, &iface->times.last_multicast) / 1000.0;
+	if (next < 0)
+		next = 0;
+	if (timespecdiff(&iface->times.next_multicast, &now) <= next * 1000)
+		return;
+
+	dlog(LOG_DEBUG, 5, "%s next RA hastened to %g second(s) from now", iface->props.name, next);
+
+	iface->times.next_multicast = next_timespec(next);
+	iface->times.earliest_multicast = iface->times.next_multicast;
+	iface_queue_update(iface);
 }
 
 void for_each_iface(struct Interface *ifaces, void (*foo)(struct Interface *, void *), void *data)
@@ -402,6 +757,10 @@ static void free_iface_list(struct Interface *iface)
 
 		dlog(LOG_DEBUG, 4, "freeing interface %s", iface->props.name);
 
+		iface_queue_remove(iface);
+		free_ra_cache(iface);
+		free_option_schedules(iface);
+
 		struct AdvPrefix *prefix = iface->AdvPrefixList;
 		while (prefix) {
 			struct AdvPrefix *next_prefix = prefix->next;
@@ -21,6 +21,7 @@
 
 #include <asm/types.h>
 #include <errno.h>
+#include <linux/netconf.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 
@@ -33,218 +34,820 @@
 #define SOL_NETLINK 270
 #endif
 
-struct iplink_req {
-	struct nlmsghdr n;
-	struct ifinfomsg i;
-	char buf[1024];
-};
+/* The largest notification there is fits, a link with all of its attributes */
+#define NETLINK_RECV_SIZE 32768
 
-struct ipaddr_req {
-	struct nlmsghdr n;
-	struct ifaddrmsg r;
-};
+/* Room for a renumbering's worth of notifications between two reads */
+#define NETLINK_RCVBUF_SIZE (1024 * 1024)
 
-int prefix_match(struct AdvPrefix const *prefix, struct in6_addr *addr) {
-	if ((prefix->PrefixLen % 8) == 0) {
-		return !memcmp(&prefix->Prefix, addr, prefix->PrefixLen/8);
-	} else {
-		int i;
-		for (i = 0; i < prefix->PrefixLen; i++) {
-			char mask = 1 << (8 - (i % 8));
-			int index = i / 8;
-			if ((prefix->Prefix.s6_addr[index] & mask) !=
-			    (addr->s6_addr[index] & mask))
-				return 0;
-		}
+static void process_netconf_msg(struct nlmsghdr *nh, struct Interface *ifaces);
+static void process_netlink_datagram(char *buf, int len, struct Interface *ifaces, int icmp_sock);
+static void netlink_resync(struct Interface *ifaces);
+static void invalidate_prefix_ras(struct Interface *ifaces, int ifindex, struct in6_addr const *addr);
+static int lookup_prefix_lifetimes(struct AdvPrefix const *prefix, unsigned int *preferred_lft, unsigned int *valid_lft);
+static int netlink_dump(int type, void const *hdr, size_t hdrlen, void (*foo)(struct nlmsghdr *nh, void *data), void *data);
+
+#ifdef UNIT_TEST
+#include "test/netlink.c"
+#endif
+
+static int addr_in_prefix(struct in6_addr const *prefix, int prefixlen, struct in6_addr const *addr)
+{
+	int bytes = prefixlen / 8;
+	if (memcmp(prefix, addr, bytes))
+		return 0;
+	if (prefixlen % 8 == 0)
 		return 1;
+
+	uint8_t mask = 0xff << (8 - prefixlen % 8);
+	return (prefix->s6_addr[bytes] & mask) == (addr->s6_addr[bytes] & mask);
+}
+
+int prefix_match(struct AdvPrefix const *prefix, struct in6_addr const *addr) {
+	return addr_in_prefix(&prefix->Prefix, prefix->PrefixLen, addr);
+}
+
+/*
+ * The socket of the requests, opened once.  It joins none of the
+ * notification groups, so all it reads are the replies.  The kernel is
+ * asked to check the requests strictly, so it filters the dumps by what
+ * the header of the request says, and to tell why a request failed.
+ */
+static int netlink_request_sock = -1;
+static uint32_t netlink_request_seq;
+
+static int netlink_request_socket(void)
+{
+	if (netlink_request_sock != -1)
+		return netlink_request_sock;
+
+	netlink_request_sock = socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if (netlink_request_sock == -1) {
+		flog(LOG_ERR, "Unable to open netlink request socket: %s", strerror(errno));
+		return -1;
 	}
+
+	/* Older kernels have neither, what they send is filtered here as well. */
+#ifdef NETLINK_GET_STRICT_CHK
+	if (setsockopt(netlink_request_sock, SOL_NETLINK, NETLINK_GET_STRICT_CHK, (int[]){1}, sizeof(int)) < 0)
+		dlog(LOG_DEBUG, 3, "netlink: unable to setsockopt NETLINK_GET_STRICT_CHK: %s", strerror(errno));
+#endif
+#ifdef NETLINK_EXT_ACK
+	if (setsockopt(netlink_request_sock, SOL_NETLINK, NETLINK_EXT_ACK, (int[]){1}, sizeof(int)) < 0)
+		dlog(LOG_DEBUG, 3, "netlink: unable to setsockopt NETLINK_EXT_ACK: %s", strerror(errno));
+#endif
+
+	return netlink_request_sock;
 }
 
-int netlink_get_address_lifetimes(struct AdvPrefix const *prefix, unsigned int *preferred_lft, unsigned int *valid_lft) {
-	int ret = 0;
-	struct ipaddr_req req = {};
-	struct nlmsghdr *retmsg;
-	struct ifaddrmsg *retaddr;
-	struct rtattr *tb;
-	int attrlen;
-	char buf[32768];
-	unsigned int valid = 0;
-	unsigned int preferred = 0;
-	int sock = -1;
-	int len;
+/*
+ * Send a request of type, with flags, over the request socket.  hdr is the
+ * header of the request, hdrlen long, which says what it is about.  Returns
+ * the sequence number of the request, for netlink_reply, or 0 if it wasn't
+ * sent.  Its reply has to be read before the next request is sent: the
+ * reply of a request sent behind a dump comes between the parts of the
+ * dump, and netlink_reply skips it there as a leftover.
+ */
+static uint32_t netlink_request(int type, int flags, void const *hdr, size_t hdrlen)
+{
+	struct {
+		struct nlmsghdr n;
+		char hdr[sizeof(struct ifinfomsg)]; /* the largest of the request headers */
+	} req;
 
-	memset(&req, 0, sizeof(req));
-	req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
-	req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_ROOT;
-	req.n.nlmsg_type = RTM_GETADDR;
-	req.r.ifa_family = AF_INET6;
+	if (NLMSG_ALIGN(hdrlen) > sizeof(req.hdr))
+		return 0;
 
-	sock = netlink_socket();
+	int sock = netlink_request_socket();
 	if (sock == -1)
-		return ret;
+		return 0;
 
-	/* Send and receive the netlink message */
-	len = send(sock, &req, req.n.nlmsg_len, 0);
-	if (len == -1) {
-		flog(LOG_ERR, "netlink: send for address lifetimes failed: %s", strerror(errno));
-		close (sock);
-		return ret;
+	/* 0 is no request */
+	if (++netlink_request_seq == 0)
+		++netlink_request_seq;
+
+	/* padded, as iproute2 sends them: the kernel checks strictly that a header as short as netconfmsg is */
+	memset(&req, 0, sizeof(req));
+	req.n.nlmsg_len = NLMSG_LENGTH(NLMSG_ALIGN(hdrlen));
+	req.n.nlmsg_flags = NLM_F_REQUEST | flags;
+	req.n.nlmsg_type = type;
+	req.n.nlmsg_seq = netlink_request_seq;
+	memcpy(req.hdr, hdr, hdrlen);
+
+	if (send(sock, &req, req.n.nlmsg_len, 0) == -1) {
+		flog(LOG_ERR, "netlink: send for request of type %d failed: %s", type, strerror(errno));
+		return 0;
 	}
 
-	len = recv(sock, buf, sizeof(buf), 0);
-	if (len == -1) {
-		flog(LOG_ERR, "netlink: recv for address lifetimes failed: %s", strerror(errno));
-		close (sock);
-		return ret;
+	return req.n.nlmsg_seq;
+}
+
+/* Log why the request of type failed, with what the kernel says of it if it does, from an error or a dump done with one. */
+static void netlink_request_failed(int type, struct nlmsghdr const *nh)
+{
+	if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(int))) {
+		flog(LOG_ERR, "netlink: request of type %d failed", type);
+		return;
+	}
+
+	int error = *(int const *)NLMSG_DATA(nh);
+	char const *why = "";
+
+#ifdef NLM_F_ACK_TLVS
+	if (nh->nlmsg_flags & NLM_F_ACK_TLVS) {
+		/* the attributes come after the error, and after the request an error repeats unless it was left out */
+		size_t offset = sizeof(int);
+		if (nh->nlmsg_type == NLMSG_ERROR) {
+			struct nlmsgerr const *err = NLMSG_DATA(nh);
+			offset = sizeof(*err);
+			if (nh->nlmsg_len >= NLMSG_LENGTH(sizeof(*err)) && !(nh->nlmsg_flags & NLM_F_CAPPED))
+				offset += NLMSG_ALIGN(err->msg.nlmsg_len - sizeof(struct nlmsghdr));
+		}
+		int len = (int)nh->nlmsg_len - (int)NLMSG_LENGTH(offset);
+		struct rtattr const *rta = (struct rtattr const *)((char const *)NLMSG_DATA(nh) + offset);
+		for (; len > 0 && RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+			if (rta->rta_type == NLMSGERR_ATTR_MSG && memchr(RTA_DATA(rta), 0, RTA_PAYLOAD(rta)))
+				why = RTA_DATA(rta);
+		}
 	}
+#endif
 
-	retmsg = (struct nlmsghdr *)buf;
+	flog(LOG_ERR, "netlink: request of type %d failed: %s%s%s", type, strerror(-error), *why ? ": " : "", why);
+}
 
-	while NLMSG_OK(retmsg, len) {
-		retaddr = (struct ifaddrmsg *)NLMSG_DATA(retmsg);
-		tb = (struct rtattr *)IFA_RTA(retaddr);
+/*
+ * Read the reply to the request seq, calling foo for each of its messages:
+ * all of a dump, however many reads it takes, or the one message of any
+ * other request.  What is left of the replies to earlier requests, which
+ * no one waits for any more, is skipped.  Returns 0, or -1 if the request
+ * failed.
+ */
+static int netlink_reply(uint32_t seq, int type, void (*foo)(struct nlmsghdr *nh, void *data), void *data)
+{
+	static char buf[32768];
 
-		attrlen = IFA_PAYLOAD(retmsg);
+	int sock = netlink_request_socket();
+	if (seq == 0 || sock == -1)
+		return -1;
 
-		char addr[INET6_ADDRSTRLEN];
-		int found = 0;
+	for (;;) {
+		int len = recv(sock, buf, sizeof(buf), 0);
+		if (len == -1) {
+			if (errno == EINTR)
+				continue;
+			flog(LOG_ERR, "netlink: recv for request of type %d failed: %s", type, strerror(errno));
+			return -1;
+		}
 
-		while RTA_OK(tb, attrlen) {
-			if (tb->rta_type == IFA_ADDRESS) {
-				/* Test if the address matches the prefix we are searching for */
-				struct in6_addr *tmp = RTA_DATA(tb);
-				if (prefix_match(prefix, tmp)) {
-					inet_ntop(AF_INET6, RTA_DATA(tb), addr, sizeof(addr));
-					found = 1;
-				} else {
-					found = 0;
+		int done = 0;
+		for (struct nlmsghdr *nh = (struct nlmsghdr *)buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+			if (nh->nlmsg_seq != seq)
+				continue;
+
+			if (nh->nlmsg_type == NLMSG_DONE) {
+				/* a dump that failed is done with the error */
+				if (nh->nlmsg_len >= NLMSG_LENGTH(sizeof(int)) && *(int const *)NLMSG_DATA(nh) < 0) {
+					netlink_request_failed(type, nh);
+					return -1;
 				}
+				return 0;
 			}
 
-			/**
-			 *  If we have matched an address, retrieve and update the valid and preferred lifetimes for that prefix.
-			 */
-			if(found && tb->rta_type == IFA_CACHEINFO) {
-				struct ifa_cacheinfo *cache_info = (struct ifa_cacheinfo *)RTA_DATA(tb);
-				if (cache_info->ifa_valid > valid) {
-					valid = cache_info->ifa_valid;
-				}
+			if (nh->nlmsg_type == NLMSG_ERROR) {
+				struct nlmsgerr const *err = NLMSG_DATA(nh);
+				/* an acknowledgement */
+				if (nh->nlmsg_len >= NLMSG_LENGTH(sizeof(*err)) && err->error == 0)
+					return 0;
+				netlink_request_failed(type, nh);
+				return -1;
+			}
 
-				if (cache_info->ifa_prefered > preferred) {
-					preferred = cache_info->ifa_prefered;
-				}
-				/* Reset found flag, in case more than one address exists on the same prefix */
-				found = 0;
-				/* At lease 1 lifetime have been found, return value is true */
-				ret = 1;
+			foo(nh, data);
+			if (!(nh->nlmsg_flags & NLM_F_MULTI))
+				done = 1;
+		}
+
+		if (done)
+			return 0;
+	}
+}
+
+/* Dump the objects of type the header hdr, hdrlen long, filters, calling foo for each. */
+static int netlink_dump(int type, void const *hdr, size_t hdrlen, void (*foo)(struct nlmsghdr *nh, void *data), void *data)
+{
+	return netlink_reply(netlink_request(type, NLM_F_DUMP, hdr, hdrlen), type, foo, data);
+}
+
+struct address_lifetimes {
+	struct AdvPrefix const *prefix;
+	unsigned int valid;
+	unsigned int preferred;
+	int found;
+};
+
+static void address_lifetimes_foo(struct nlmsghdr *nh, void *data)
+{
+	struct address_lifetimes *lifetimes = data;
+	struct ifaddrmsg *retaddr = (struct ifaddrmsg *)NLMSG_DATA(nh);
+	struct rtattr *tb = (struct rtattr *)IFA_RTA(retaddr);
+	int attrlen = IFA_PAYLOAD(nh);
+	int found = 0;
+
+	while RTA_OK(tb, attrlen) {
+		if (tb->rta_type == IFA_ADDRESS) {
+			/* Test if the address matches the prefix we are searching for */
+			struct in6_addr *tmp = RTA_DATA(tb);
+			found = prefix_match(lifetimes->prefix, tmp);
+		}
+
+		/**
+		 *  If we have matched an address, retrieve and update the valid and preferred lifetimes for that prefix.
+		 */
+		if(found && tb->rta_type == IFA_CACHEINFO) {
+			struct ifa_cacheinfo *cache_info = (struct ifa_cacheinfo *)RTA_DATA(tb);
+			if (cache_info->ifa_valid > lifetimes->valid) {
+				lifetimes->valid = cache_info->ifa_valid;
 			}
 
-			tb = RTA_NEXT(tb, attrlen);
+			if (cache_info->ifa_prefered > lifetimes->preferred) {
+				lifetimes->preferred = cache_info->ifa_prefered;
+			}
+			/* Reset found flag, in case more than one address exists on the same prefix */
+			found = 0;
+			/* At lease 1 lifetime have been found, return value is true */
+			lifetimes->found = 1;
 		}
-		retmsg = NLMSG_NEXT(retmsg, len);
+
+		tb = RTA_NEXT(tb, attrlen);
 	}
+}
+
+int netlink_get_address_lifetimes(struct AdvPrefix const *prefix, unsigned int *preferred_lft, unsigned int *valid_lft) {
+	int found = lookup_prefix_lifetimes(prefix, preferred_lft, valid_lft);
+	if (found >= 0)
+		return found;
+
+	/* the address table isn't seeded, the kernel is asked for all of the addresses */
+	struct address_lifetimes lifetimes = {prefix, 0, 0, 0};
+	struct ifaddrmsg ifaddr = {.ifa_family = AF_INET6};
+
+	if (netlink_dump(RTM_GETADDR, &ifaddr, sizeof(ifaddr), address_lifetimes_foo, &lifetimes) < 0)
+		return 0;
 
-	*valid_lft = valid;
-	*preferred_lft = preferred;
+	*valid_lft = lifetimes.valid;
+	*preferred_lft = lifetimes.preferred;
 
-	close (sock);
-	return ret;
+	return lifetimes.found;
 }
 
-int netlink_get_device_addr_len(struct Interface *iface)
+/*
+ * The IPv6 addresses of every interface, as one dump found them and the
+ * notifications changed them since, so nothing has to ask the kernel for
+ * all of them again: one entry per ifindex, sorted by it, each with its
+ * addresses sorted.
+ */
+struct addr_table_entry {
+	int ifindex;
+	char name[IFNAMSIZ];
+	unsigned int flags;
+	uint32_t carrier_changes;
+	int count;
+	int size;
+	struct iface_addr *addrs;
+};
+
+static struct addr_table_entry *addr_table;
+static int addr_table_len;
+static int addr_table_size;
+static int addr_table_seeded;
+
+static int cmp_iface_addr(void const *a, void const *b) { return memcmp(a, b, sizeof(struct in6_addr)); }
+
+/*
+ * The longest lifetimes of the addresses in each of the prefixes asked
+ * about, sorted by prefix, so an RA finds them without going through all
+ * of the addresses.  A change to an address in a prefix has it worked out
+ * again the next time it is asked for.
+ */
+struct prefix_lifetimes {
+	struct in6_addr prefix;
+	int prefixlen;
+	int stale;
+	int found;
+	int64_t valid_until;
+	int64_t preferred_until;
+};
+
+static struct prefix_lifetimes *prefix_lifetimes;
+static int prefix_lifetimes_len;
+static int prefix_lifetimes_size;
+
+static int cmp_prefix_lifetimes(void const *a, void const *b)
 {
-	struct iplink_req req = {};
-	struct iovec iov = {&req, sizeof(req)};
-	struct sockaddr_nl sa = {};
-	struct msghdr msg = {.msg_name=(void *)&sa, .msg_namelen=sizeof(sa), .msg_iov=&iov, .msg_iovlen=1, .msg_control=NULL, .msg_controllen=0, .msg_flags=0};
-	int sock, len, addr_len = -1;
-	unsigned short type;
-	char answer[32768];
-	struct rtattr *tb;
-
-	/* nl_pid (for linux kernel) and nl_groups (unicast) should be zero */
-	sa.nl_family = AF_NETLINK;
-	req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
-	req.n.nlmsg_flags = NLM_F_REQUEST;
-	req.n.nlmsg_type = RTM_GETLINK;
-	req.i.ifi_index = iface->props.if_index;
-
-	sock = netlink_socket();
-	if (sock == -1)
+	struct prefix_lifetimes const *pa = a;
+	struct prefix_lifetimes const *pb = b;
+	int cmp = memcmp(&pa->prefix, &pb->prefix, sizeof(pa->prefix));
+	return cmp ? cmp : pa->prefixlen - pb->prefixlen;
+}
+
+static int64_t lifetime_until(uint32_t lifetime, int64_t now) { return lifetime == UINT32_MAX ? INT64_MAX : now + lifetime; }
+
+static uint32_t lifetime_left(int64_t until, int64_t now)
+{
+	if (until == INT64_MAX)
+		return UINT32_MAX;
+	return until > now ? min(until - now, UINT32_MAX - 1) : 0;
+}
+
+static void prefix_lifetimes_changed(struct in6_addr const *addr)
+{
+	for (int i = 0; i < prefix_lifetimes_len; ++i) {
+		if (addr_in_prefix(&prefix_lifetimes[i].prefix, prefix_lifetimes[i].prefixlen, addr))
+			prefix_lifetimes[i].stale = 1;
+	}
+}
+
+static void prefix_lifetimes_scan(struct prefix_lifetimes *entry)
+{
+	entry->stale = 0;
+	entry->found = 0;
+	entry->valid_until = entry->preferred_until = INT64_MIN;
+
+	for (int i = 0; i < addr_table_len; ++i) {
+		for (int j = 0; j < addr_table[i].count; ++j) {
+			struct iface_addr const *addr = &addr_table[i].addrs[j];
+			if (!addr->has_lifetimes || !addr_in_prefix(&entry->prefix, entry->prefixlen, &addr->addr))
+				continue;
+			entry->found = 1;
+			if (addr->valid_until > entry->valid_until)
+				entry->valid_until = addr->valid_until;
+			if (addr->preferred_until > entry->preferred_until)
+				entry->preferred_until = addr->preferred_until;
+		}
+	}
+}
+
+/*
+ * netlink_get_address_lifetimes out of the address table.  Returns -1 if
+ * the table isn't seeded.
+ */
+static int lookup_prefix_lifetimes(struct AdvPrefix const *prefix, unsigned int *preferred_lft, unsigned int *valid_lft)
+{
+	if (!addr_table_seeded)
+		return -1;
+
+	struct prefix_lifetimes key;
+	memset(&key, 0, sizeof(key));
+	struct in6_addr mask = prefixlen_mask(prefix->PrefixLen);
+	key.prefix = get_prefix6(&prefix->Prefix, &mask);
+	key.prefixlen = prefix->PrefixLen;
+	key.stale = 1;
+
+	struct prefix_lifetimes *entry =
+	    bsearch(&key, prefix_lifetimes, prefix_lifetimes_len, sizeof(key), cmp_prefix_lifetimes);
+	if (!entry) {
+		if (prefix_lifetimes_len == prefix_lifetimes_size) {
+			int size = prefix_lifetimes_size ? 2 * prefix_lifetimes_size : 8;
+			struct prefix_lifetimes *index = realloc(prefix_lifetimes, size * sizeof(*index));
+			if (!index) {
+				/* worked out each time then */
+				entry = &key;
+			} else {
+				prefix_lifetimes = index;
+				prefix_lifetimes_size = size;
+			}
+		}
+		if (!entry) {
+			int i = prefix_lifetimes_len;
+			while (i > 0 && cmp_prefix_lifetimes(&prefix_lifetimes[i - 1], &key) > 0)
+				--i;
+			memmove(&prefix_lifetimes[i + 1], &prefix_lifetimes[i], (prefix_lifetimes_len - i) * sizeof(key));
+			prefix_lifetimes[i] = key;
+			++prefix_lifetimes_len;
+			entry = &prefix_lifetimes[i];
+		}
+	}
+
+	if (entry->stale)
+		prefix_lifetimes_scan(entry);
+
+	if (!entry->found)
+		return 0;
+
+	struct timespec now;
+	clock_now(&now);
+	*valid_lft = lifetime_left(entry->valid_until, now.tv_sec);
+	*preferred_lft = lifetime_left(entry->preferred_until, now.tv_sec);
+	return 1;
+}
+
+/* The index of ifindex in the table, or where it would go as the complement of that. */
+static int addr_table_index(int ifindex)
+{
+	int lo = 0, hi = addr_table_len;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (addr_table[mid].ifindex < ifindex)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < addr_table_len && addr_table[lo].ifindex == ifindex ? lo : ~lo;
+}
+
+static struct addr_table_entry *addr_table_find(int ifindex, int create)
+{
+	int i = addr_table_index(ifindex);
+	if (i >= 0)
+		return &addr_table[i];
+	if (!create)
+		return NULL;
+
+	if (addr_table_len == addr_table_size) {
+		int size = addr_table_size ? 2 * addr_table_size : 16;
+		struct addr_table_entry *table = realloc(addr_table, size * sizeof(*table));
+		if (!table) {
+			flog(LOG_ERR, "netlink: no memory for the addresses of ifindex %d", ifindex);
+			return NULL;
+		}
+		addr_table = table;
+		addr_table_size = size;
+	}
+
+	i = ~i;
+	memmove(&addr_table[i + 1], &addr_table[i], (addr_table_len - i) * sizeof(*addr_table));
+	++addr_table_len;
+	memset(&addr_table[i], 0, sizeof(*addr_table));
+	addr_table[i].ifindex = ifindex;
+	return &addr_table[i];
+}
+
+static struct addr_table_entry *addr_table_find_name(char const *name)
+{
+	for (int i = 0; i < addr_table_len; ++i) {
+		if (!strncmp(addr_table[i].name, name, IFNAMSIZ))
+			return &addr_table[i];
+	}
+	return NULL;
+}
+
+static struct iface_addr *addr_table_insert(struct addr_table_entry *entry, struct in6_addr const *addr)
+{
+	if (entry->count == entry->size) {
+		int size = entry->size ? 2 * entry->size : 4;
+		struct iface_addr *addrs = realloc(entry->addrs, size * sizeof(*addrs));
+		if (!addrs) {
+			flog(LOG_ERR, "netlink: no memory for the addresses of ifindex %d", entry->ifindex);
+			return NULL;
+		}
+		entry->addrs = addrs;
+		entry->size = size;
+	}
+
+	int i = entry->count;
+	while (i > 0 && memcmp(&entry->addrs[i - 1].addr, addr, sizeof(*addr)) > 0)
+		--i;
+	memmove(&entry->addrs[i + 1], &entry->addrs[i], (entry->count - i) * sizeof(*entry->addrs));
+	memset(&entry->addrs[i], 0, sizeof(*entry->addrs));
+	entry->addrs[i].addr = *addr;
+	++entry->count;
+	return &entry->addrs[i];
+}
+
+/* Add addr, or update it, with the lifetimes of cacheinfo if the kernel told them. */
+static void addr_table_add(int ifindex, struct in6_addr const *addr, int prefixlen, struct ifa_cacheinfo const *cacheinfo)
+{
+	struct addr_table_entry *entry = addr_table_find(ifindex, 1);
+	if (!entry)
+		return;
+
+	prefix_lifetimes_changed(addr);
+
+	struct iface_addr *found = bsearch(addr, entry->addrs, entry->count, sizeof(struct iface_addr), cmp_iface_addr);
+	if (!found) {
+		found = addr_table_insert(entry, addr);
+		if (!found)
+			return;
+	}
+
+	found->prefixlen = prefixlen;
+	found->has_lifetimes = cacheinfo != NULL;
+	if (cacheinfo) {
+		struct timespec now;
+		clock_now(&now);
+		found->valid_until = lifetime_until(cacheinfo->ifa_valid, now.tv_sec);
+		found->preferred_until = lifetime_until(cacheinfo->ifa_prefered, now.tv_sec);
+	}
+}
+
+
+static void addr_table_del(int ifindex, struct in6_addr const *addr)
+{
+	struct addr_table_entry *entry = addr_table_find(ifindex, 0);
+	if (!entry)
+		return;
+
+	struct iface_addr *found = bsearch(addr, entry->addrs, entry->count, sizeof(struct iface_addr), cmp_iface_addr);
+	if (!found)
+		return;
+
+	prefix_lifetimes_changed(addr);
+	--entry->count;
+	memmove(found, found + 1, (entry->addrs + entry->count - found) * sizeof(*found));
+}
+
+static void addr_table_drop(int ifindex)
+{
+	int i = addr_table_index(ifindex);
+	if (i < 0)
+		return;
+
+	for (int j = 0; j < addr_table[i].count; ++j)
+		prefix_lifetimes_changed(&addr_table[i].addrs[j].addr);
+	free(addr_table[i].addrs);
+	--addr_table_len;
+	memmove(&addr_table[i], &addr_table[i + 1], (addr_table_len - i) * sizeof(*addr_table));
+}
+
+/* Bring the table up to date with a link or address message, dumped or notified. */
+static void addr_table_update(struct nlmsghdr *nh, void *data)
+{
+	if (nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK) {
+		if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+			return;
+		struct ifinfomsg *ifinfo = (struct ifinfomsg *)NLMSG_DATA(nh);
+		if (nh->nlmsg_type == RTM_DELLINK) {
+			addr_table_drop(ifinfo->ifi_index);
+			return;
+		}
+
+		struct addr_table_entry *entry = addr_table_find(ifinfo->ifi_index, 1);
+		if (!entry)
+			return;
+		entry->flags = ifinfo->ifi_flags;
+
+		struct rtattr *rta = IFLA_RTA(ifinfo);
+		int rta_len = nh->nlmsg_len - NLMSG_LENGTH(sizeof(struct ifinfomsg));
+		for (; RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+			if (rta->rta_type == IFLA_IFNAME && memchr(RTA_DATA(rta), 0, RTA_PAYLOAD(rta)))
+				strlcpy(entry->name, RTA_DATA(rta), sizeof(entry->name));
+			else if (rta->rta_type == IFLA_CARRIER_CHANGES && RTA_PAYLOAD(rta) >= sizeof(uint32_t))
+				memcpy(&entry->carrier_changes, RTA_DATA(rta), sizeof(uint32_t));
+		}
+	} else if (nh->nlmsg_type == RTM_NEWADDR || nh->nlmsg_type == RTM_DELADDR) {
+		if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifaddrmsg)))
+			return;
+		struct ifaddrmsg *ifaddr = (struct ifaddrmsg *)NLMSG_DATA(nh);
+		if (ifaddr->ifa_family != AF_INET6)
+			return;
+
+		struct in6_addr const *addr = NULL;
+		struct ifa_cacheinfo const *cacheinfo = NULL;
+		struct rtattr *rta = IFA_RTA(ifaddr);
+		int rta_len = IFA_PAYLOAD(nh);
+		for (; RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+			if (rta->rta_type == IFA_ADDRESS && RTA_PAYLOAD(rta) >= sizeof(struct in6_addr))
+				addr = RTA_DATA(rta);
+			else if (rta->rta_type == IFA_CACHEINFO && RTA_PAYLOAD(rta) >= sizeof(struct ifa_cacheinfo))
+				cacheinfo = RTA_DATA(rta);
+		}
+
+		if (!addr)
+			return;
+		if (nh->nlmsg_type == RTM_NEWADDR)
+			addr_table_add(ifaddr->ifa_index, addr, ifaddr->ifa_prefixlen, cacheinfo);
+		else
+			addr_table_del(ifaddr->ifa_index, addr);
+	}
+}
+
+/*
+ * Fill the address table from one dump of the links, for their names, and
+ * one of the addresses.  The notification socket should be open already,
+ * so that no change is missed in between.
+ */
+int netlink_seed_addr_table(void)
+{
+	while (addr_table_len > 0)
+		addr_table_drop(addr_table[addr_table_len - 1].ifindex);
+	addr_table_seeded = 0;
+	prefix_lifetimes_len = 0;
+
+	struct ifinfomsg ifinfo = {.ifi_family = AF_UNSPEC};
+	struct ifaddrmsg ifaddr = {.ifa_family = AF_INET6};
+	if (netlink_dump(RTM_GETLINK, &ifinfo, sizeof(ifinfo), addr_table_update, NULL) < 0 ||
+	    netlink_dump(RTM_GETADDR, &ifaddr, sizeof(ifaddr), addr_table_update, NULL) < 0) {
+		flog(LOG_WARNING, "netlink: the addresses of the interfaces will be asked for each time");
+		return -1;
+	}
+
+	addr_table_seeded = 1;
+	dlog(LOG_DEBUG, 3, "netlink: addresses of %d interfaces dumped", addr_table_len);
+	return 0;
+}
+
+/*
+ * The addresses of ifindex, or of the interface called name if ifindex is
+ * 0, in *addrs sorted.  Returns how many there are, or -1 if the table
+ * isn't seeded and the caller has to ask the kernel itself.
+ */
+int netlink_iface_addrs(int ifindex, char const *name, struct iface_addr const **addrs)
+{
+	*addrs = NULL;
+	if (!addr_table_seeded)
 		return -1;
 
-	len = sendmsg(sock, &msg, 0);
-	if (len == -1) {
-		flog(LOG_ERR, "netlink: sendmsg for addr_len failed: %s", strerror(errno));
-		goto out;
+	struct addr_table_entry const *entry = ifindex ? addr_table_find(ifindex, 0) : addr_table_find_name(name);
+
+	if (!entry)
+		return 0;
+
+	*addrs = entry->addrs;
+	return entry->count;
+}
+
+/* Collect the IPv6 addresses of the ifindex of entry, of a dump the kernel may not have filtered. */
+static void iface_addrs_foo(struct nlmsghdr *nh, void *data)
+{
+	struct addr_table_entry *entry = data;
+	if (nh->nlmsg_type != RTM_NEWADDR || nh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifaddrmsg)))
+		return;
+	struct ifaddrmsg *ifaddr = (struct ifaddrmsg *)NLMSG_DATA(nh);
+	if (ifaddr->ifa_family != AF_INET6 || (int)ifaddr->ifa_index != entry->ifindex)
+		return;
+
+	struct rtattr *rta = IFA_RTA(ifaddr);
+	int rta_len = IFA_PAYLOAD(nh);
+	for (; RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+		if (rta->rta_type != IFA_ADDRESS || RTA_PAYLOAD(rta) < sizeof(struct in6_addr))
+			continue;
+		struct iface_addr *addr = bsearch(RTA_DATA(rta), entry->addrs, entry->count, sizeof(struct iface_addr), cmp_iface_addr);
+		if (!addr)
+			addr = addr_table_insert(entry, RTA_DATA(rta));
+		if (addr)
+			addr->prefixlen = ifaddr->ifa_prefixlen;
 	}
+}
 
-	iov.iov_base = answer;
-	iov.iov_len = sizeof(answer);
-	len = recvmsg(sock, &msg, 0);
-	if (len == -1) {
-		flog(LOG_ERR, "netlink: recvmsg for addr_len failed: %s", strerror(errno));
-		goto out;
+/*
+ * get_iface_addrs out of the address table, or of a dump of the addresses
+ * of ifindex alone while the table isn't seeded.  Returns -2 if netlink
+ * can't tell, for the caller to ask getifaddrs instead.
+ */
+int netlink_get_iface_addrs(int ifindex, char const *name, struct in6_addr *if_addr, struct in6_addr **if_addrs)
+{
+	struct addr_table_entry dumped = {.ifindex = ifindex};
+	struct iface_addr const *addrs;
+	int count = netlink_iface_addrs(ifindex, name, &addrs);
+	if (count < 0) {
+		struct ifaddrmsg ifaddr = {.ifa_family = AF_INET6, .ifa_index = ifindex};
+		if (!ifindex || netlink_dump(RTM_GETADDR, &ifaddr, sizeof(ifaddr), iface_addrs_foo, &dumped) < 0) {
+			free(dumped.addrs);
+			return -2;
+		}
+		addrs = dumped.addrs;
+		count = dumped.count;
 	}
 
-	if (len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
-		goto out;
-	len -= NLMSG_LENGTH(sizeof(struct ifinfomsg));
+	/* last item in the list is all zero (unspecified) address */
+	struct in6_addr *list = realloc(*if_addrs, (count + 1) * sizeof(struct in6_addr));
+	if (!list) {
+		flog(LOG_ERR, "netlink: no memory for the addresses of %s", name);
+		free(dumped.addrs);
+		return -1;
+	}
+	*if_addrs = list;
+	memset(&list[count], 0, sizeof(struct in6_addr));
+
+	int link_local_set = 0;
+	uint8_t const ll_prefix[] = {0xfe, 0x80, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0};
+	for (int i = 0; i < count; ++i) {
+		list[i] = addrs[i].addr;
+		if (link_local_set || 0 != memcmp(&addrs[i].addr, ll_prefix, sizeof(ll_prefix)))
+			continue;
+		if (if_addr)
+			*if_addr = addrs[i].addr;
+		link_local_set = 1;
+	}
+	free(dumped.addrs);
 
-	tb = (struct rtattr *)(answer + NLMSG_LENGTH(sizeof(struct ifinfomsg)));
-	while (RTA_OK(tb, len)) {
-		type = tb->rta_type & ~NLA_F_NESTED;
+	if (!link_local_set)
+		return -1;
+
+	return count;
+}
+
+static void device_addr_len_foo(struct nlmsghdr *nh, void *data)
+{
+	int *addr_len = data;
+	if (nh->nlmsg_type != RTM_NEWLINK || nh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+		return;
+
+	struct rtattr *tb = IFLA_RTA((struct ifinfomsg *)NLMSG_DATA(nh));
+	int len = nh->nlmsg_len - NLMSG_LENGTH(sizeof(struct ifinfomsg));
+	for (; RTA_OK(tb, len); tb = RTA_NEXT(tb, len)) {
+		unsigned short type = tb->rta_type & ~NLA_F_NESTED;
 		if (type == IFLA_ADDRESS) {
-			addr_len = RTA_PAYLOAD(tb);
-			break;
+			*addr_len = RTA_PAYLOAD(tb);
+			return;
 		}
-		tb = RTA_NEXT(tb, len);
 	}
+}
+
+int netlink_get_device_addr_len(struct Interface *iface)
+{
+	/* the one link, not a dump */
+	struct ifinfomsg ifinfo = {.ifi_family = AF_UNSPEC, .ifi_index = iface->props.if_index};
+	int addr_len = -1;
 
-out:
-	close(sock);
+	if (netlink_reply(netlink_request(RTM_GETLINK, 0, &ifinfo, sizeof(ifinfo)), RTM_GETLINK, device_addr_len_foo, &addr_len) < 0)
+		return -1;
 
 	return addr_len;
 }
 
+/*
+ * Read all of the notifications queued on netlink_sock.  If some were lost,
+ * because the socket overran or one didn't fit the buffer, what they were
+ * about is dumped again once the rest are read, so nothing older than the
+ * dump comes after it.
+ */
 void process_netlink_msg(int netlink_sock, struct Interface *ifaces, int icmp_sock)
 {
-	char buf[4096];
-	struct iovec iov = {buf, sizeof(buf)};
-	struct sockaddr_nl sa;
-	struct msghdr msg = {.msg_name=(void *)&sa, .msg_namelen=sizeof(sa), .msg_iov=&iov, .msg_iovlen=1, .msg_control=NULL, .msg_controllen=0, .msg_flags=0};
-	int len = recvmsg(netlink_sock, &msg, 0);
-	if (len == -1) {
-		flog(LOG_ERR, "netlink: recvmsg failed: %s", strerror(errno));
+	static char buf[NETLINK_RECV_SIZE];
+	int lost = 0;
+
+	for (;;) {
+		struct iovec iov = {buf, sizeof(buf)};
+		struct sockaddr_nl sa;
+		struct msghdr msg = {.msg_name = (void *)&sa, .msg_namelen = sizeof(sa), .msg_iov = &iov, .msg_iovlen = 1};
+		int len = recvmsg(netlink_sock, &msg, MSG_DONTWAIT);
+		if (len == -1) {
+			if (errno == EINTR)
+				continue;
+			if (errno == ENOBUFS) {
+				lost = 1;
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				flog(LOG_ERR, "netlink: recvmsg failed: %s", strerror(errno));
+			break;
+		}
+
+		if (msg.msg_flags & MSG_TRUNC) {
+			lost = 1;
+			continue;
+		}
+
+		process_netlink_datagram(buf, len, ifaces, icmp_sock);
 	}
 
+	if (lost)
+		netlink_resync(ifaces);
+}
+
+static void process_netlink_datagram(char *buf, int len, struct Interface *ifaces, int icmp_sock)
+{
 	for (struct nlmsghdr *nh = (struct nlmsghdr *)buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
-		char ifnamebuf[IF_NAMESIZE];
 		/* The end of multipart message. */
 		if (nh->nlmsg_type == NLMSG_DONE)
 			return;
 
+		/* No request is sent over this socket, there is nothing to make of one. */
 		if (nh->nlmsg_type == NLMSG_ERROR) {
-			flog(LOG_ERR, "netlink: unknown error");
-			abort();
+			flog(LOG_ERR, "netlink: unexpected error message");
+			continue;
 		}
 
+		++stats.netlink_events;
+
+		/* Before anything below reads the table. */
+		addr_table_update(nh, NULL);
+
 		/* Continue with parsing payload. */
 		if (nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK || nh->nlmsg_type == RTM_SETLINK) {
 			struct ifinfomsg *ifinfo = (struct ifinfomsg *)NLMSG_DATA(nh);
-			const char *ifname = if_indextoname(ifinfo->ifi_index, ifnamebuf);
+			/* the name comes with the message, if_indextoname would open a socket to ask for it */
+			char const *ifname = NULL;
+			int link_state = 0;
 
 			struct rtattr *rta = IFLA_RTA(NLMSG_DATA(nh));
 			int rta_len = nh->nlmsg_len - NLMSG_LENGTH(sizeof(struct ifinfomsg));
 			for (; RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
-				if (rta->rta_type == IFLA_OPERSTATE || rta->rta_type == IFLA_LINKMODE) {
-					if (ifinfo->ifi_flags & IFF_RUNNING) {
-						dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, flags is running", ifname,
-						     ifinfo->ifi_index);
-					} else {
-						dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, flags is *NOT* running", ifname,
-						     ifinfo->ifi_index);
-					}
+				if (rta->rta_type == IFLA_IFNAME && RTA_PAYLOAD(rta) > 0 &&
+				    memchr(RTA_DATA(rta), 0, RTA_PAYLOAD(rta))) {
+					ifname = RTA_DATA(rta);
+				} else if (rta->rta_type == IFLA_OPERSTATE || rta->rta_type == IFLA_LINKMODE) {
+					link_state = 1;
+				}
+			}
+
+			if (link_state) {
+				if (ifinfo->ifi_flags & IFF_RUNNING) {
+					dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, flags is running", ifname, ifinfo->ifi_index);
+				} else {
+					dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, flags is *NOT* running", ifname,
+					     ifinfo->ifi_index);
 				}
 			}
 
@@ -252,7 +855,7 @@ void process_netlink_msg(int netlink_sock, struct Interface *ifaces, int icmp_so
 			struct Interface *iface;
 			switch (nh->nlmsg_type) {
 			case RTM_NEWLINK:
-				iface = find_iface_by_name(ifaces, ifname);
+				iface = ifname ? find_iface_by_name(ifaces, ifname) : NULL;
 				break;
 			default:
 				iface = find_iface_by_index(ifaces, ifinfo->ifi_index);
@@ -270,30 +873,32 @@ void process_netlink_msg(int netlink_sock, struct Interface *ifaces, int icmp_so
 
 		} else if (nh->nlmsg_type == RTM_NEWADDR || nh->nlmsg_type == RTM_DELADDR) {
 			struct ifaddrmsg *ifaddr = (struct ifaddrmsg *)NLMSG_DATA(nh);
-			const char *ifname = if_indextoname(ifaddr->ifa_index, ifnamebuf);
+			int deleted = nh->nlmsg_type == RTM_DELADDR;
+			struct in6_addr const *addr = NULL;
 
-			switch (nh->nlmsg_type) {
+			struct rtattr *rta = IFA_RTA(ifaddr);
+			int rta_len = IFA_PAYLOAD(nh);
+			for (; RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+				if (rta->rta_type == IFA_ADDRESS && RTA_PAYLOAD(rta) >= sizeof(struct in6_addr))
+					addr = RTA_DATA(rta);
+			}
 
-			case RTM_DELADDR:
-				dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, address deleted", ifname, ifaddr->ifa_index);
-				break;
+			struct Interface *iface = find_iface_by_index(ifaces, ifaddr->ifa_index);
+			char const *ifname = iface ? iface->props.name : NULL;
+			dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, %s", ifname, ifaddr->ifa_index,
+			     deleted ? "address deleted" : "new address");
 
-			case RTM_NEWADDR:
-				dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, new address", ifname, ifaddr->ifa_index);
-				break;
+			if (ifaddr->ifa_family != AF_INET6 || !addr)
+				continue;
 
-			default:
-				flog(LOG_ERR, "netlink: unhandled event: %d", nh->nlmsg_type);
-				break;
-			}
+			note_address_change(addr, deleted);
 
-			struct Interface *iface = find_iface_by_index(ifaces, ifaddr->ifa_index);
-			if (iface) {
-				struct in6_addr *if_addrs = NULL;
-				int count = get_iface_addrs(iface->props.name, NULL, &if_addrs);
+			/* The lifetimes of an address, new or not, may be those of a prefix anywhere. */
+			invalidate_prefix_ras(ifaces, ifaddr->ifa_index, addr);
 
-				if (count != iface->props.addrs_count ||
-				    0 != memcmp(if_addrs, iface->props.if_addrs, count * sizeof(struct in6_addr))) {
+			/* A new address the interface has already, or a deleted one it hasn't, changes nothing. */
+			if (iface) {
+				if (iface_has_addr(iface, addr) == deleted) {
 					dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, addresses are different", ifname,
 					     ifaddr->ifa_index);
 					touch_iface(iface);
@@ -301,12 +906,163 @@ void process_netlink_msg(int netlink_sock, struct Interface *ifaces, int icmp_so
 					dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, addresses are the same", ifname,
 					     ifaddr->ifa_index);
 				}
-				free(if_addrs);
+			}
+		} else if (nh->nlmsg_type == RTM_NEWNETCONF) {
+			process_netconf_msg(nh, ifaces);
+		}
+	}
+}
+
+/*
+ * Drop the RAs built by the interfaces with a prefix that addr, of the
+ * interface with ifindex, is in, as they have the lifetimes of the
+ * addresses in it.  An auto prefix is in the addresses of the interface it
+ * is taken from.
+ */
+static void invalidate_prefix_ras(struct Interface *ifaces, int ifindex, struct in6_addr const *addr)
+{
+	static struct in6_addr const zero;
+	char name[IFNAMSIZ] = {""};
+
+	for (struct Interface *iface = ifaces; iface; iface = iface->next) {
+		for (struct AdvPrefix const *prefix = iface->AdvPrefixList; prefix; prefix = prefix->next) {
+			int auto_prefix = IN6_ARE_ADDR_EQUAL(&prefix->Prefix, &zero);
+			if (prefix->if6[0] && !name[0]) {
+				struct addr_table_entry const *entry = addr_table_find(ifindex, 0);
+				if (entry && entry->name[0])
+					strlcpy(name, entry->name, sizeof(name));
+				else if (!if_indextoname(ifindex, name))
+					name[0] = '\0';
+			}
+			if ((auto_prefix && iface->props.if_index == (unsigned int)ifindex) ||
+			    (prefix->if6[0] && !strncmp(prefix->if6, name, IFNAMSIZ)) ||
+			    (!auto_prefix && prefix_match(prefix, addr))) {
+				dlog(LOG_DEBUG, 4, "netlink: %s, RAs with the changed address built again", iface->props.name);
+				invalidate_ra_cache(iface);
+				break;
 			}
 		}
 	}
 }
 
+/* Keep the forwarding settings up to date, telling the hosts at once when forwarding is enabled or disabled. */
+static void process_netconf_msg(struct nlmsghdr *nh, struct Interface *ifaces)
+{
+	struct netconfmsg *ncm = (struct netconfmsg *)NLMSG_DATA(nh);
+	if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(struct netconfmsg)) || ncm->ncm_family != AF_INET6)
+		return;
+
+	int ifindex = 0;
+	int forwarding = -1;
+	struct rtattr *rta = (struct rtattr *)((char *)ncm + NLMSG_ALIGN(sizeof(struct netconfmsg)));
+	int rta_len = nh->nlmsg_len - NLMSG_LENGTH(sizeof(struct netconfmsg));
+	for (; RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len)) {
+		if (RTA_PAYLOAD(rta) < sizeof(int32_t))
+			continue;
+		if (rta->rta_type == NETCONFA_IFINDEX)
+			memcpy(&ifindex, RTA_DATA(rta), sizeof(int32_t));
+		else if (rta->rta_type == NETCONFA_FORWARDING)
+			memcpy(&forwarding, RTA_DATA(rta), sizeof(int32_t));
+	}
+
+	/* Not every notification is about forwarding. */
+	if (forwarding == -1)
+		return;
+
+	if (ifindex == NETCONFA_IFINDEX_ALL) {
+		dlog(LOG_DEBUG, 3, "netlink: IPv6 forwarding is %d", forwarding);
+		if (!set_ip6_forwarding(forwarding))
+			return;
+		for (struct Interface *iface = ifaces; iface; iface = iface->next) {
+			if (iface->AdvSendAdvert && iface->state_info.ready && !iface->state_info.cease_adv)
+				hasten_iface(iface);
+		}
+	} else if (ifindex > 0) {
+		struct Interface *iface = find_iface_by_index(ifaces, ifindex);
+		if (!iface || iface->state_info.forwarding == forwarding)
+			return;
+		dlog(LOG_DEBUG, 3, "netlink: %s, ifindex %d, IPv6 forwarding is %d", iface->props.name, ifindex, forwarding);
+		if (forwarding < 1)
+			flog(LOG_WARNING, "IPv6 forwarding on %s has been disabled, but continuing anyway", iface->props.name);
+		iface->state_info.forwarding = forwarding;
+	}
+}
+
+static void netconf_dump_foo(struct nlmsghdr *nh, void *data) { process_netconf_msg(nh, data); }
+
+/* The state of a link as the notifications left it, to tell from a dump whether one was lost. */
+struct link_state {
+	int known;
+	unsigned int flags;
+	uint32_t carrier_changes;
+};
+
+/*
+ * Whether the link and addresses of iface in the table are others than
+ * those it was set up with.  A link that went down, or bounced with its
+ * addresses back as they were, shows in its flags or its carrier changes.
+ */
+static int iface_resync_changed(struct Interface const *iface, struct link_state const *before)
+{
+	struct addr_table_entry const *entry = addr_table_find_name(iface->props.name);
+
+	/* one that isn't there has nothing to set up */
+	if (!entry)
+		return iface->state_info.ready;
+	if (!iface->state_info.ready || entry->ifindex != (int)iface->props.if_index || entry->count != iface->props.addrs_count)
+		return 1;
+	if (!before->known || entry->flags != before->flags || entry->carrier_changes != before->carrier_changes)
+		return 1;
+	for (int i = 0; i < entry->count; ++i) {
+		if (!IN6_ARE_ADDR_EQUAL(&entry->addrs[i].addr, &iface->props.if_addrs[i]))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Notifications were lost: dump all of what they tell of again, and set up
+ * anew the interfaces that missed a change.  Forwarding is dealt with as
+ * its notifications are, when it changes.
+ */
+static void netlink_resync(struct Interface *ifaces)
+{
+	++stats.netlink_resyncs;
+	flog(LOG_WARNING, "netlink: notifications were lost, dumping the links and addresses again");
+
+	/* the links as the notifications left them, the dump replaces them */
+	int count = 0;
+	for (struct Interface *iface = ifaces; iface; iface = iface->next)
+		++count;
+	struct link_state *before = calloc(count ? count : 1, sizeof(*before));
+	if (!before)
+		flog(LOG_ERR, "netlink: no memory for the state of the links, all of them are set up again");
+	int i = 0;
+	for (struct Interface *iface = ifaces; before && iface; iface = iface->next, ++i) {
+		struct addr_table_entry const *entry = addr_table_find_name(iface->props.name);
+		if (entry)
+			before[i] = (struct link_state){1, entry->flags, entry->carrier_changes};
+	}
+
+	netlink_seed_addr_table();
+	drop_ifaddrs_snapshot();
+
+	struct netconfmsg ncm = {.ncm_family = AF_INET6};
+	netlink_dump(RTM_GETNETCONF, &ncm, sizeof(ncm), netconf_dump_foo, ifaces);
+
+	struct link_state const unknown = {0};
+	i = 0;
+	for (struct Interface *iface = ifaces; iface; iface = iface->next, ++i) {
+		/* the prefixes of the addresses may have changed all the same, the next RAs are built again */
+		invalidate_ra_cache(iface);
+		if (iface_resync_changed(iface, before ? &before[i] : &unknown)) {
+			dlog(LOG_DEBUG, 3, "netlink: %s changed while notifications were lost", iface->props.name);
+			touch_iface(iface);
+		}
+	}
+	free(before);
+}
+
 int netlink_socket(void)
 {
 	int sock = socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
@@ -314,11 +1070,10 @@ int netlink_socket(void)
 		flog(LOG_ERR, "Unable to open netlink socket: %s", strerror(errno));
 		return -1;
 	}
-#if defined SOL_NETLINK && defined NETLINK_NO_ENOBUFS
-	else if (setsockopt(sock, SOL_NETLINK, NETLINK_NO_ENOBUFS, (int[]){1}, sizeof(int)) < 0) {
-		flog(LOG_ERR, "Unable to setsockopt NETLINK_NO_ENOBUFS: %s", strerror(errno));
+	/* Overruns are reported, with ENOBUFS, for process_netlink_msg to resync. */
+	else if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (int[]){NETLINK_RCVBUF_SIZE}, sizeof(int)) < 0) {
+		flog(LOG_DEBUG, "Unable to setsockopt SO_RCVBUF on the netlink socket: %s", strerror(errno));
 	}
-#endif
 	struct sockaddr_nl snl;
 	memset(&snl, 0, sizeof(snl));
 	snl.nl_family = AF_NETLINK;
@@ -330,6 +1085,12 @@ int netlink_socket(void)
 		close(sock);
 		sock = -1;
 	}
+#ifdef RTNLGRP_IPV6_NETCONF
+	/* Without these check_ip6_forwarding reads procfs now and then instead. */
+	else if (setsockopt(sock, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, (int[]){RTNLGRP_IPV6_NETCONF}, sizeof(int)) < 0) {
+		flog(LOG_DEBUG, "Unable to join the netconf group of the netlink socket: %s", strerror(errno));
+	}
+#endif
 
 	return sock;
 }
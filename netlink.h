@@ -19,6 +19,9 @@
 
 int netlink_get_address_lifetimes(struct AdvPrefix const *prefix, unsigned int *preferred_lft, unsigned int *valid_lft);
 int netlink_get_device_addr_len(struct Interface *iface);
+int netlink_get_iface_addrs(int ifindex, char const *name, struct in6_addr *if_addr, struct in6_addr **if_addrs);
+int netlink_iface_addrs(int ifindex, char const *name, struct iface_addr const **addrs);
+int netlink_seed_addr_table(void);
 void process_netlink_msg(int netlink_sock, struct Interface *ifaces, int icmp_sock);
 int netlink_socket(void);
-int prefix_match (struct AdvPrefix const *prefix, struct in6_addr *addr);
+int prefix_match (struct AdvPrefix const *prefix, struct in6_addr const *addr);
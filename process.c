@@ -20,25 +20,51 @@
 static void process_rs(int sock, struct Interface *, unsigned char *msg, int len, struct sockaddr_in6 *);
 static void process_ra(struct Interface *, unsigned char *msg, int len, struct sockaddr_in6 *);
 static int addr_match(struct in6_addr *a1, struct in6_addr *a2, int prefixlen);
+static void process_packet(int sock, struct Interface *interfaces, struct Interface *iface, unsigned char *msg, int len,
+			   struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info, int hoplimit);
 
+/* Process a packet received on the shared socket, for any of the interfaces. */
 void process(int sock, struct Interface *interfaces, unsigned char *msg, int len, struct sockaddr_in6 *addr,
 	     struct in6_pktinfo *pkt_info, int hoplimit)
 {
-	char if_namebuf[IF_NAMESIZE] = {""};
-	char *if_name = if_indextoname(pkt_info->ipi6_ifindex, if_namebuf);
-	if (!if_name) {
-		if_name = "unknown interface";
-	}
-	dlog(LOG_DEBUG, 4, "%s received a packet", if_name);
+	process_packet(sock, interfaces, NULL, msg, len, addr, pkt_info, hoplimit);
+}
 
+/* Process a packet received on the socket bound to iface, no lookup needed. */
+void process_iface(int sock, struct Interface *iface, unsigned char *msg, int len, struct sockaddr_in6 *addr,
+		   struct in6_pktinfo *pkt_info, int hoplimit)
+{
+	process_packet(sock, NULL, iface, msg, len, addr, pkt_info, hoplimit);
+}
+
+static void process_packet(int sock, struct Interface *interfaces, struct Interface *iface, unsigned char *msg, int len,
+			   struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info, int hoplimit)
+{
 	char addr_str[INET6_ADDRSTRLEN];
 	addrtostr(&addr->sin6_addr, addr_str, sizeof(addr_str));
 
 	if (!pkt_info) {
-		flog(LOG_WARNING, "%s received packet with no pkt_info from %s!", if_name, addr_str);
+		flog(LOG_WARNING, "received packet with no pkt_info from %s!", addr_str);
 		return;
 	}
 
+	/* get iface by received if_index */
+	int shared = iface == NULL;
+	if (shared)
+		iface = find_iface_by_index(interfaces, pkt_info->ipi6_ifindex);
+
+	/* valid or not, it reached radvd; the copy on the shared socket of one the interface's own got isn't counted twice */
+	if (iface && !(shared && iface->props.sock >= 0))
+		++iface->state_info.rx_packets;
+
+	/* if_indextoname opens a socket to ask, so it's left for the interfaces we don't know */
+	char if_namebuf[IF_NAMESIZE] = {""};
+	char const *if_name = iface ? iface->props.name : if_indextoname(pkt_info->ipi6_ifindex, if_namebuf);
+	if (!if_name) {
+		if_name = "unknown interface";
+	}
+	dlog(LOG_DEBUG, 4, "%s received a packet", if_name);
+
 	/*
 	 * can this happen?
 	 */
@@ -87,15 +113,18 @@ void process(int sock, struct Interface *interfaces, unsigned char *msg, int len
 		return;
 	}
 
-	/* get iface by received if_index */
-	struct Interface *iface = find_iface_by_index(interfaces, pkt_info->ipi6_ifindex);
-
 	if (iface == NULL) {
 		dlog(LOG_WARNING, 4, "%s received icmpv6 RS/RA packet on an unknown interface with index %d", if_name,
 		     pkt_info->ipi6_ifindex);
 		return;
 	}
 
+	/* The copy that arrived on the interface's own socket is the one handled. */
+	if (shared && iface->props.sock >= 0) {
+		dlog(LOG_DEBUG, 5, "%s packet on the shared socket ignored, it has its own", if_name);
+		return;
+	}
+
 	if (!iface->state_info.ready && (0 != setup_iface(sock, iface))) {
 		flog(LOG_WARNING, "%s received RS or RA on %s but %s is not ready and setup_iface failed", if_name,
 		     iface->props.name, iface->props.name);
@@ -182,7 +211,7 @@ static void process_rs(int sock, struct Interface *iface, unsigned char *msg, in
 	}
 
 	struct timespec ts;
-	clock_gettime(CLOCK_MONOTONIC, &ts);
+	clock_now(&ts);
 
 	double const delay = (MAX_RA_DELAY_SECONDS * rand() / (RAND_MAX + 1.0));
 
@@ -193,9 +222,12 @@ static void process_rs(int sock, struct Interface *iface, unsigned char *msg, in
 		double next = iface->MinDelayBetweenRAs - (ts.tv_sec + ts.tv_nsec / 1000000000.0) +
 			      (iface->times.last_multicast.tv_sec + iface->times.last_multicast.tv_nsec / 1000000000.0) + delay;
 		dlog(LOG_DEBUG, 5, "%s: rate limiting RA's, rescheduling RA %f seconds from now", iface->props.name, next);
+		/* the rescheduled RA answers the RS, with all of the options */
+		iface->state_info.solicited = 1;
 		reschedule_iface(iface, next);
 	} else {
 		/* no RA sent in a while, send a multicast reply */
+		iface->state_info.solicited = 1;
 		send_ra_forall(sock, iface, NULL);
 		double next = rand_between(iface->MinRtrAdvInterval, iface->MaxRtrAdvInterval);
 		reschedule_iface(iface, next);
@@ -23,7 +23,6 @@
 #endif
 
 #include <libgen.h>
-#include <poll.h>
 #include <sys/file.h>
 
 #ifdef HAVE_GETOPT_LONG
@@ -31,19 +30,31 @@
 /* clang-format off */
 static char usage_str[] = {
 "\n"
+#ifdef HAVE_RECVMMSG
+"  -b, --recvbatch=NUM     Receive up to NUM packets per wakeup.  Default is 32.\n"
+#else
+"  -b, --recvbatch=NUM     Receive up to NUM packets per wakeup.  Only 1 is\n"
+"                          supported on this platform.\n"
+#endif
 "  -C, --config=PATH       Set the config file.  Default is /etc/radvd.d.\n"
 "  -c, --configtest        Parse the config file and exit.\n"
 "  -d, --debug=NUM         Set the debug level.  Values can be 1, 2, 3, 4 or 5.\n"
+"  -F, --prefilter         Reject invalid RSs and RAs in the kernel.\n"
 "  -f, --facility=NUM      Set the logging facility.\n"
 "  -h, --help              Show this help screen.\n"
+"  -i, --ifacesockets      Receive and send on a socket bound to each interface.\n"
 "  -l, --logfile=PATH      Set the log file.\n"
 "  -m, --logmethod=X       Set method to: syslog, stderr, stderr_syslog, logfile,\n"
 "                          stderr_clean, or none.\n"
 "  -n, --nodaemon          Prevent the daemonizing.\n"
 "  -p, --pidfile=PATH      Set the pid file.\n"
+"  -S, --timerslack=SECS   Let RAs go out up to SECS early to share wakeups.\n"
+"                          Default is 0.\n"
 "  -t, --chrootdir=PATH    Chroot to the specified path.\n"
 "  -u, --username=USER     Switch to the specified user.\n"
 "  -v, --version           Print the version and quit.\n"
+"  -w, --pacewindow=SECS   Spread the initial RAs of all interfaces over SECS\n"
+"                          at startup and reload.  Default is 0.\n"
 };
 
 static struct option prog_opt[] = {
@@ -53,10 +64,15 @@ static struct option prog_opt[] = {
 	{"debug", 1, 0, 'd'},
 	{"facility", 1, 0, 'f'},
 	{"help", 0, 0, 'h'},
+	{"ifacesockets", 0, 0, 'i'},
 	{"logfile", 1, 0, 'l'},
 	{"logmethod", 1, 0, 'm'},
 	{"nodaemon", 0, 0, 'n'},
+	{"pacewindow", 1, 0, 'w'},
 	{"pidfile", 1, 0, 'p'},
+	{"prefilter", 0, 0, 'F'},
+	{"recvbatch", 1, 0, 'b'},
+	{"timerslack", 1, 0, 'S'},
 	{"username", 1, 0, 'u'},
 	{"version", 0, 0, 'v'},
 	{NULL, 0, 0, 0}
@@ -65,8 +81,9 @@ static struct option prog_opt[] = {
 #else
 
 static char usage_str[] = {
-"[-hvcn] [-d level] [-C config_path] [-m log_method] [-l log_file]\n"
-"\t[-f facility] [-p pid_file] [-u username] [-t chrootdir]"
+"[-hvcniF] [-b recv_batch] [-d level] [-C config_path] [-m log_method] [-l log_file]\n"
+"\t[-f facility] [-p pid_file] [-u username] [-t chrootdir] [-w pace_window]\n"
+"\t[-S timer_slack]"
 
 };
 /* clang-format on */
@@ -77,6 +94,25 @@ static volatile int sighup_received = 0;
 static volatile int sigint_received = 0;
 static volatile int sigterm_received = 0;
 static volatile int sigusr1_received = 0;
+static volatile int sigusr2_received = 0;
+
+static int recv_batch = DFLT_RecvBatch;
+static double pace_window = DFLT_PaceWindow;
+static int iface_sockets = 0;
+/* The shared socket, which the interfaces with sockets of their own are set up on too. */
+static int shared_sock = -1;
+
+/* Spreads the initial RAs of setup_ifaces over pace_window seconds. */
+struct kickoff_pacing {
+	int sock;
+	int slot;
+	int slots;
+};
+
+struct main_loop_state {
+	int sock;
+	struct Interface *ifaces;
+};
 
 static int check_conffile_perm(const char *, const char *);
 static int open_and_lock_pid_file(char const *daemon_pid_file_ident);
@@ -87,21 +123,45 @@ static struct Interface *main_loop(int sock, struct Interface *ifaces, char cons
 static struct Interface *reload_config(int sock, struct Interface *ifaces, char const *conf_path);
 static void check_pid_file(char const *daemon_pid_file_ident);
 static void config_interface(struct Interface *iface);
-static void kickoff_adverts(int sock, struct Interface *iface);
+static void kickoff_adverts(struct kickoff_pacing *pacing, struct Interface *iface);
 static void reset_prefix_lifetimes(struct Interface *ifaces);
 static void reset_prefix_lifetimes_foo(struct Interface *iface, void *data);
 static void setup_iface_foo(struct Interface *iface, void *data);
+static void count_iface_foo(struct Interface *iface, void *data);
 static void setup_ifaces(int sock, struct Interface *ifaces);
 static void cleanup_ifaces(int sock, struct Interface *ifaces);
 static void sighup_handler(int sig);
 static void sigint_handler(int sig);
 static void sigterm_handler(int sig);
 static void sigusr1_handler(int sig);
+static void sigusr2_handler(int sig);
 static void stop_advert_foo(struct Interface *iface, void *data);
 static void stop_adverts(int sock, struct Interface *ifaces);
-static void timer_handler(int sock, struct Interface *iface);
+static void process_foo(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info, int hoplimit,
+			void *data);
+static void process_iface_foo(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info,
+			      int hoplimit, void *data);
+static void discard_foo(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info, int hoplimit,
+			void *data);
+static void receive(int sock,
+		    void (*foo)(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info,
+				int hoplimit, void *data),
+		    void *data);
+static void icmp_sock_handler(int sock, void *data);
+static void iface_sock_handler(int sock, void *data);
+static void unused_sock_handler(int sock, void *data);
+static void register_unused_sock_foo(int sock, void *data);
+static void register_iface_sock_foo(struct Interface *iface, void *data);
+static void register_iface_socks(int sock, struct Interface *ifaces);
+static void open_iface_socket_foo(struct Interface *iface, void *data);
+#ifdef HAVE_NETLINK
+static void netlink_sock_handler(int netlink_sock, void *data);
+#endif
 static void usage(char const *pname);
 static void version(void);
+static void reset_iface_rx_stats_foo(struct Interface *iface, void *data);
+static void log_iface_rx_stats_foo(struct Interface *iface, void *data);
+static void log_all_stats(struct Interface *ifaces);
 
 /* daemonize and write pid file.  The pid of the daemon child process
  * will be written to the pid file from the *parent* process.  This
@@ -197,7 +257,7 @@ int main(int argc, char *argv[])
 	char const *daemon_pid_file_ident = PATH_RADVD_PID;
 
 /* parse args */
-#define OPTIONS_STR "d:C:l:m:p:t:u:vhcn"
+#define OPTIONS_STR "b:d:C:l:m:p:t:u:w:S:vhcniF"
 #ifdef HAVE_GETOPT_LONG
 	int opt_idx;
 	while ((c = getopt_long(argc, argv, OPTIONS_STR, prog_opt, &opt_idx)) > 0)
@@ -206,9 +266,37 @@ int main(int argc, char *argv[])
 #endif
 	{
 		switch (c) {
+		case 'b':
+			recv_batch = atoi(optarg);
+			if (recv_batch < 1 || recv_batch > RECV_BATCH_MAX) {
+				fprintf(stderr, "%s: receive batch must be between 1 and %d\n", pname, RECV_BATCH_MAX);
+				exit(1);
+			}
+#ifndef HAVE_RECVMMSG
+			if (recv_batch > 1) {
+				fprintf(stderr, "%s: receive batches are not supported on this platform\n", pname);
+				exit(1);
+			}
+#endif
+			break;
 		case 'C':
 			conf_path = optarg;
 			break;
+		case 'w':
+			pace_window = atof(optarg);
+			if (pace_window < 0 || pace_window > MAX_INITIAL_RTR_ADVERT_INTERVAL) {
+				fprintf(stderr, "%s: pace window must be between 0 and %d seconds\n", pname,
+					MAX_INITIAL_RTR_ADVERT_INTERVAL);
+				exit(1);
+			}
+			break;
+		case 'S':
+			if (atof(optarg) < 0) {
+				fprintf(stderr, "%s: timer slack must not be negative\n", pname);
+				exit(1);
+			}
+			set_timer_slack(atof(optarg));
+			break;
 		case 'd':
 			set_debuglevel(atoi(optarg));
 			break;
@@ -254,6 +342,12 @@ int main(int argc, char *argv[])
 		case 'n':
 			daemonize = 0;
 			break;
+		case 'i':
+			iface_sockets = 1;
+			break;
+		case 'F':
+			set_icmpv6_prefilter(1);
+			break;
 		case 'h':
 			usage(pname);
 #ifdef HAVE_GETOPT_LONG
@@ -336,6 +430,9 @@ int main(int argc, char *argv[])
 		exit(0);
 	}
 
+	/* counted from before the socket can receive any of them */
+	for_each_iface(ifaces, reset_iface_rx_stats_foo, 0);
+
 	/* get a raw socket for sending and receiving ICMPv6 messages */
 	int sock = open_icmpv6_socket();
 	if (sock < 0) {
@@ -423,6 +520,10 @@ int main(int argc, char *argv[])
 	}
 #endif
 
+	/* binding to a device needs CAP_NET_RAW, so open these while we have it */
+	if (iface_sockets)
+		for_each_iface(ifaces, open_iface_socket_foo, 0);
+
 	if (username) {
 		if (drop_root_privileges(username) < 0) {
 			perror("drop_root_privileges");
@@ -434,8 +535,10 @@ int main(int argc, char *argv[])
 
 	setup_ifaces(sock, ifaces);
 	ifaces = main_loop(sock, ifaces, conf_path);
+	log_all_stats(ifaces);
 	stop_adverts(sock, ifaces);
 	cleanup_ifaces(sock, ifaces);
+	close_iface_sockets();
 	close(sock);
 
 	flog(LOG_INFO, "removing %s", daemon_pid_file_ident);
@@ -457,109 +560,146 @@ int main(int argc, char *argv[])
 	return 0;
 }
 
+static void process_foo(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info, int hoplimit,
+			void *data)
+{
+	struct main_loop_state *state = data;
+
+	process(state->sock, state->ifaces, msg, len, addr, pkt_info, hoplimit);
+}
+
+static void process_iface_foo(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info,
+			      int hoplimit, void *data)
+{
+	struct Interface *iface = data;
+
+	process_iface(shared_sock, iface, msg, len, addr, pkt_info, hoplimit);
+}
+
+static void discard_foo(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info, int hoplimit,
+			void *data)
+{
+	dlog(LOG_DEBUG, 5, "discarding a packet received for an interface no longer configured");
+}
+
+/* Receive one packet, or a batch of them, from sock and hand them to foo. */
+static void receive(int sock,
+		    void (*foo)(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info,
+				int hoplimit, void *data),
+		    void *data)
+{
+#ifdef HAVE_RECVMMSG
+	if (recv_batch > 1) {
+		/* Answers to the whole batch of RSs go out together. */
+		send_batch_begin();
+		recv_rs_ra_batch(sock, recv_batch, foo, data);
+		send_batch_end();
+		return;
+	}
+#endif
+
+	int len, hoplimit;
+	struct sockaddr_in6 rcv_addr;
+	struct in6_pktinfo *pkt_info = NULL;
+	unsigned char msg[MSG_SIZE_RECV];
+	unsigned char chdr[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
+
+	len = recv_rs_ra(sock, msg, &rcv_addr, &pkt_info, &hoplimit, chdr);
+	if (len > 0 && pkt_info) {
+		foo(msg, len, &rcv_addr, pkt_info, hoplimit, data);
+	} else if (!pkt_info) {
+		dlog(LOG_INFO, 4, "recv_rs_ra returned null pkt_info");
+	} else if (len <= 0) {
+		dlog(LOG_INFO, 4, "recv_rs_ra returned len <= 0: %d", len);
+	}
+}
+
+static void icmp_sock_handler(int sock, void *data) { receive(sock, process_foo, data); }
+static void iface_sock_handler(int sock, void *data) { receive(sock, process_iface_foo, data); }
+static void unused_sock_handler(int sock, void *data) { receive(sock, discard_foo, data); }
+
+static void register_unused_sock_foo(int sock, void *data) { event_add_fd(sock, unused_sock_handler, 0); }
+
+static void register_iface_sock_foo(struct Interface *iface, void *data)
+{
+	if (iface->props.sock >= 0)
+		event_add_fd(iface->props.sock, iface_sock_handler, iface);
+	else
+		*(int *)data = 1;
+}
+
+/*
+ * Point the per-interface sockets at the interfaces just (re)loaded.  The
+ * shared socket then only sends, unless some interface has no socket of
+ * its own.
+ */
+static void register_iface_socks(int sock, struct Interface *ifaces)
+{
+	if (!iface_sockets)
+		return;
+
+	for_each_iface_socket(register_unused_sock_foo, 0);
+
+	int shared = 0;
+	for_each_iface(ifaces, register_iface_sock_foo, &shared);
+	set_icmpv6_filter(sock, shared);
+}
+
+#ifdef HAVE_NETLINK
+static void netlink_sock_handler(int netlink_sock, void *data)
+{
+	struct main_loop_state *state = data;
+
+	process_netlink_msg(netlink_sock, state->ifaces, state->sock);
+}
+#endif
+
 static struct Interface *main_loop(int sock, struct Interface *ifaces, char const *conf_path)
 {
-	struct pollfd fds[2];
-	sigset_t sigmask;
-	sigset_t sigempty;
-	struct sigaction sa;
-
-	sigemptyset(&sigempty);
-
-	sigemptyset(&sigmask);
-	sigaddset(&sigmask, SIGHUP);
-	sigaddset(&sigmask, SIGTERM);
-	sigaddset(&sigmask, SIGINT);
-	sigaddset(&sigmask, SIGUSR1);
-	sigprocmask(SIG_BLOCK, &sigmask, NULL);
-
-	sa.sa_handler = sighup_handler;
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = 0;
-	sigaction(SIGHUP, &sa, 0);
-
-	sa.sa_handler = sigterm_handler;
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = 0;
-	sigaction(SIGTERM, &sa, 0);
-
-	sa.sa_handler = sigint_handler;
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = 0;
-	sigaction(SIGINT, &sa, 0);
-
-	sa.sa_handler = sigusr1_handler;
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = 0;
-	sigaction(SIGUSR1, &sa, 0);
-
-	memset(fds, 0, sizeof(fds));
-
-	fds[0].fd = sock;
-	fds[0].events = POLLIN;
-
-#if HAVE_NETLINK
-	fds[1].fd = netlink_socket();
-	fds[1].events = POLLIN;
-#else
-	fds[1].fd = -1;
+	struct main_loop_state state = {sock, ifaces};
+	shared_sock = sock;
+
+	event_init();
+
+	event_add_signal(SIGHUP, sighup_handler);
+	event_add_signal(SIGTERM, sigterm_handler);
+	event_add_signal(SIGINT, sigint_handler);
+	event_add_signal(SIGUSR1, sigusr1_handler);
+	event_add_signal(SIGUSR2, sigusr2_handler);
+
+	event_add_fd(sock, icmp_sock_handler, &state);
+	register_iface_socks(sock, ifaces);
+
+#ifdef HAVE_NETLINK
+	int netlink_sock = netlink_socket();
+	if (netlink_sock >= 0) {
+		event_add_fd(netlink_sock, netlink_sock_handler, &state);
+		/* subscribed first, so the notifications keep the dump up to date */
+		netlink_seed_addr_table();
+	}
 #endif
 
 	for (;;) {
-		struct timespec *tsp = 0;
+		struct timespec const *deadline = 0;
 
-		struct Interface *next_iface_to_expire = find_iface_by_time(ifaces);
+		struct Interface *next_iface_to_expire = find_iface_by_time();
 		if (next_iface_to_expire) {
-			static struct timespec ts;
-			int timeout = next_time_msec(next_iface_to_expire);
-			ts.tv_sec = timeout / 1000;
-			ts.tv_nsec = (timeout - 1000 * ts.tv_sec) * 1000000;
-			tsp = &ts;
-			dlog(LOG_DEBUG, 1, "polling for %g second(s), next iface is %s", timeout / 1000.0,
+			deadline = &next_iface_to_expire->times.next_multicast;
+			dlog(LOG_DEBUG, 1, "polling for %g second(s), next iface is %s", next_time_msec(next_iface_to_expire) / 1000.0,
 			     next_iface_to_expire->props.name);
 		} else {
 			dlog(LOG_DEBUG, 1, "no iface is next. Polling indefinitely");
 		}
-#ifdef HAVE_PPOLL
-		int rc = ppoll(fds, sizeof(fds) / sizeof(fds[0]), tsp, &sigempty);
-#else
-		// tsp could be NULL so check for this
-		int timeout_seconds = tsp != 0 ? 1000 * tsp->tv_sec : 0;
-		int rc = poll(fds, sizeof(fds) / sizeof(fds[0]), timeout_seconds);
-#endif
 
-		if (rc > 0) {
-#ifdef HAVE_NETLINK
-			if (fds[1].revents & POLLIN) {
-				process_netlink_msg(fds[1].fd, ifaces, sock);
-			} else if (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
-				flog(LOG_WARNING, "socket error on fds[1].fd");
-			}
-#endif
+		event_wait(deadline);
+		++stats.wakeups;
 
-			if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
-				flog(LOG_WARNING, "socket error on fds[0].fd");
-			} else if (fds[0].revents & POLLIN) {
-				int len, hoplimit;
-				struct sockaddr_in6 rcv_addr;
-				struct in6_pktinfo *pkt_info = NULL;
-				unsigned char msg[MSG_SIZE_RECV];
-				unsigned char chdr[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
-
-				len = recv_rs_ra(sock, msg, &rcv_addr, &pkt_info, &hoplimit, chdr);
-				if (len > 0 && pkt_info) {
-					process(sock, ifaces, msg, len, &rcv_addr, pkt_info, hoplimit);
-				} else if (!pkt_info) {
-					dlog(LOG_INFO, 4, "recv_rs_ra returned null pkt_info");
-				} else if (len <= 0) {
-					dlog(LOG_INFO, 4, "recv_rs_ra returned len <= 0: %d", len);
-				}
-			}
-		} else if (rc == 0) {
-			if (next_iface_to_expire)
-				timer_handler(sock, next_iface_to_expire);
-		} else if (rc == -1) {
-			dlog(LOG_INFO, 3, "poll returned early: %s", strerror(errno));
+		/* Run the expired timers after every wakeup, so a busy socket can't postpone them. */
+		send_batch_begin();
+		int expired = expire_ifaces(timer_handler, &sock, MAX_EXPIRED_IFACES_PER_WAKEUP);
+		send_batch_end();
+		if (expired == MAX_EXPIRED_IFACES_PER_WAKEUP) {
+			dlog(LOG_DEBUG, 2, "%d ifaces expired in one wakeup, deferring any others", expired);
 		}
 
 		if (sigint_received) {
@@ -574,18 +714,31 @@ static struct Interface *main_loop(int sock, struct Interface *ifaces, char cons
 
 		if (sighup_received) {
 			dlog(LOG_INFO, 3, "sig hup received");
-			ifaces = reload_config(sock, ifaces, conf_path);
+			state.ifaces = reload_config(sock, state.ifaces, conf_path);
+			register_iface_socks(sock, state.ifaces);
 			sighup_received = 0;
 		}
 
 		if (sigusr1_received) {
 			dlog(LOG_INFO, 3, "sig usr1 received");
-			reset_prefix_lifetimes(ifaces);
+			reset_prefix_lifetimes(state.ifaces);
 			sigusr1_received = 0;
 		}
+
+		if (sigusr2_received) {
+			dlog(LOG_INFO, 3, "sig usr2 received");
+			log_all_stats(state.ifaces);
+			sigusr2_received = 0;
+		}
 	}
 
-	return ifaces;
+#ifdef HAVE_NETLINK
+	if (netlink_sock >= 0)
+		close(netlink_sock);
+#endif
+	event_close();
+
+	return state.ifaces;
 }
 
 static pid_t do_daemonize(int log_method, char const *daemon_pid_file_ident)
@@ -697,19 +850,6 @@ static void check_pid_file(char const *daemon_pid_file_ident)
 	dlog(LOG_DEBUG, 4, "validated pid file, %s: %d", daemon_pid_file_ident, pid);
 }
 
-static void timer_handler(int sock, struct Interface *iface)
-{
-	dlog(LOG_DEBUG, 1, "timer_handler called for %s", iface->props.name);
-
-	if (send_ra_forall(sock, iface, NULL) != 0) {
-		dlog(LOG_DEBUG, 4, "send_ra_forall failed on interface %s", iface->props.name);
-	}
-
-	double next = rand_between(iface->MinRtrAdvInterval, iface->MaxRtrAdvInterval);
-
-	reschedule_iface(iface, next);
-}
-
 static void config_interface(struct Interface *iface)
 {
 	if (iface->AdvLinkMTU)
@@ -725,14 +865,21 @@ static void config_interface(struct Interface *iface)
 /*
  *      send initial advertisement and set timers
  */
-static void kickoff_adverts(int sock, struct Interface *iface)
+static void kickoff_adverts(struct kickoff_pacing *pacing, struct Interface *iface)
 {
-	clock_gettime(CLOCK_MONOTONIC, &iface->times.last_ra_time);
+	clock_now(&iface->times.last_ra_time);
 
 	if (iface->UnicastOnly)
 		return;
 
-	clock_gettime(CLOCK_MONOTONIC, &iface->times.last_multicast);
+	if (pace_window > 0) {
+		/* timer_handler sends it when the slot comes */
+		pace_iface(iface, pace_window, pacing->slot++, pacing->slots);
+		return;
+	}
+
+	int sock = pacing->sock;
+	clock_now(&iface->times.last_multicast);
 
 	/* send an initial advertisement */
 	if (send_ra_forall(sock, iface, NULL) != 0) {
@@ -749,6 +896,7 @@ static void stop_advert_foo(struct Interface *iface, void *data)
 		/* send a final advertisement with zero Router Lifetime */
 		dlog(LOG_DEBUG, 4, "stopping all adverts on %s", iface->props.name);
 		iface->state_info.cease_adv = 1;
+		invalidate_ra_cache(iface);
 		int sock = *(int *)data;
 		send_ra_forall(sock, iface, NULL);
 	}
@@ -763,9 +911,17 @@ static void stop_adverts(int sock, struct Interface *ifaces)
 	for_each_iface(ifaces, stop_advert_foo, &sock);
 }
 
+static void open_iface_socket_foo(struct Interface *iface, void *data) { open_iface_socket(iface->props.name); }
+
 static void setup_iface_foo(struct Interface *iface, void *data)
 {
-	int sock = *(int *)data;
+	struct kickoff_pacing *pacing = data;
+	int sock = pacing->sock;
+
+	iface_queue_add(iface);
+
+	if (iface_sockets)
+		iface->props.sock = open_iface_socket(iface->props.name);
 
 	int setup_iface_result = setup_iface(sock, iface);
 	if (setup_iface_result < 0) {
@@ -787,7 +943,7 @@ static void setup_iface_foo(struct Interface *iface, void *data)
 	}
 
 	config_interface(iface);
-	kickoff_adverts(sock, iface);
+	kickoff_adverts(pacing, iface);
 }
 
 static void cleanup_iface_foo(struct Interface *iface, void *data)
@@ -796,7 +952,18 @@ static void cleanup_iface_foo(struct Interface *iface, void *data)
 	cleanup_iface(sock, iface);
 }
 
-static void setup_ifaces(int sock, struct Interface *ifaces) { for_each_iface(ifaces, setup_iface_foo, &sock); }
+static void count_iface_foo(struct Interface *iface, void *data) { ++*(int *)data; }
+
+static void setup_ifaces(int sock, struct Interface *ifaces)
+{
+	struct kickoff_pacing pacing = {sock, 0, 0};
+
+	for_each_iface(ifaces, count_iface_foo, &pacing.slots);
+	if (pace_window > 0)
+		flog(LOG_INFO, "spreading the initial RAs of %d interface(s) over %g second(s)", pacing.slots, pace_window);
+
+	for_each_iface(ifaces, setup_iface_foo, &pacing);
+}
 static void cleanup_ifaces(int sock, struct Interface *ifaces) { for_each_iface(ifaces, cleanup_iface_foo, &sock); }
 
 static struct Interface *reload_config(int sock, struct Interface *ifaces, char const *conf_path)
@@ -812,6 +979,7 @@ static struct Interface *reload_config(int sock, struct Interface *ifaces, char
 		flog(LOG_ERR, "exiting, failed to read config file");
 		exit(1);
 	}
+	for_each_iface(ifaces, reset_iface_rx_stats_foo, 0);
 	setup_ifaces(sock, ifaces);
 
 	flog(LOG_INFO, "resuming normal operation");
@@ -841,6 +1009,8 @@ static void sigint_handler(int sig)
 
 static void sigusr1_handler(int sig) { sigusr1_received = 1; }
 
+static void sigusr2_handler(int sig) { sigusr2_received = 1; }
+
 static void reset_prefix_lifetimes_foo(struct Interface *iface, void *data)
 {
 	flog(LOG_INFO, "Resetting prefix lifetimes on %s", iface->props.name);
@@ -857,6 +1027,9 @@ static void reset_prefix_lifetimes_foo(struct Interface *iface, void *data)
 			prefix->curr_preferredlft = prefix->AdvPreferredLifetime;
 		}
 	}
+
+	/* The prefixes that had run out are advertised again. */
+	invalidate_ra_cache(iface);
 }
 
 static void reset_prefix_lifetimes(struct Interface *ifaces) { for_each_iface(ifaces, reset_prefix_lifetimes_foo, 0); }
@@ -917,3 +1090,20 @@ static void usage(char const *pname)
 	fprintf(stderr, "usage: %s %s\n", pname, usage_str);
 	exit(1);
 }
+
+static void reset_iface_rx_stats_foo(struct Interface *iface, void *data) { reset_iface_rx_stats(iface); }
+
+static void log_iface_rx_stats_foo(struct Interface *iface, void *data)
+{
+	int64_t missed = get_iface_rx_missed(iface);
+	if (missed > 0)
+		flog(LOG_INFO, "stats: %s: %" PRId64 " RS/RA packet(s) received by the kernel but not by radvd", iface->props.name,
+		     missed);
+}
+
+/* The counters, and the interfaces the kernel received RSs or RAs on that radvd didn't, as long as /proc is readable. */
+static void log_all_stats(struct Interface *ifaces)
+{
+	log_stats();
+	for_each_iface(ifaces, log_iface_rx_stats_foo, 0);
+}
@@ -24,31 +24,108 @@ extern int sock;
 
 extern int disableigmp6check;
 
+/* Counters logged on SIGUSR2 and at exit. */
+struct radvd_stats {
+	uint64_t rx_packets;
+	uint64_t rx_syscalls;
+	uint64_t tx_packets;
+	uint64_t tx_syscalls;
+	uint64_t tx_peak_rate; /* most RAs sent within one second */
+	uint64_t wakeups;
+	uint64_t timers_coalesced; /* run early to share another's wakeup */
+	uint64_t tx_errors;
+	uint64_t netlink_events; /* notifications read */
+	uint64_t iface_touches; /* of them, the ones that had an interface set up again */
+	uint64_t iface_touches_coalesced; /* of those, the ones a pending setup took care of */
+	uint64_t netlink_resyncs; /* dumps after notifications were lost */
+};
+
+extern struct radvd_stats stats;
+
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 
 struct AdvPrefix;
 struct NAT64Prefix;
 struct AutogenIgnorePrefix;
 struct Clients;
+struct arena_block;
+struct ifaddrs;
 
 #define HWADDR_MAX 16
 #define USER_HZ 100
 
+/* An address of an interface, with the length of the prefix it is in and its lifetimes */
+struct iface_addr {
+	struct in6_addr addr;
+	uint8_t prefixlen;
+	uint8_t has_lifetimes;	 /* the kernel told them */
+	int64_t valid_until;	 /* by clock_now, INT64_MAX if it doesn't expire */
+	int64_t preferred_until;
+};
+
 struct safe_buffer {
 	int should_free;
 	size_t allocated;
 	size_t used;
 	unsigned char *buffer;
+	struct safe_buffer_arena *arena; /* where the buffer comes from, NULL for the heap */
 };
 
 #define SAFE_BUFFER_INIT                                                                                                         \
-	(struct safe_buffer) { .should_free = 0, .allocated = 0, .used = 0, .buffer = 0 }
+	(struct safe_buffer) { .should_free = 0, .allocated = 0, .used = 0, .buffer = 0, .arena = 0 }
+
+/*
+ * A bump allocator for the buffers of a build that are all released
+ * together.  Its blocks are kept when it is reset, so a build that fits
+ * in what the earlier ones used takes nothing from the heap.
+ */
+struct safe_buffer_arena {
+	struct arena_block *blocks;  /* all of them, in the order they are used */
+	struct arena_block *current; /* the one being bumped */
+	size_t allocations;	     /* blocks taken from the heap so far */
+};
 
 struct safe_buffer_list {
 	struct safe_buffer *sb;
 	struct safe_buffer_list *next;
 };
 
+/* A cached RA, the header and the options it is made of, gathered by sendmsg. */
+struct ra_iov {
+	struct iovec *iov;
+	int iovlen;
+	size_t len;
+};
+
+/*
+ * An option of the cached RAs.  Those with a time-varying field, prefixes
+ * and NAT64 prefixes, are rewritten in place when their source changes.
+ */
+struct ra_option {
+	struct safe_buffer *option; /* the option, shared by the RA it is sent in */
+	int type;		    /* ND_OPT_PREFIX_INFORMATION, ND_OPT_MTU... */
+	void const *source;	    /* the configuration it is built from, an AdvPrefix, AdvRoute... */
+};
+
+/* When an option was last sent to a destination, for the RFC 7772 scheduling of the options. */
+struct option_schedule {
+	void const *source;
+	struct in6_addr prefix; /* of an auto prefix, several of which share their source */
+	int sent;
+	struct timespec last_sent;
+};
+
+struct dest_schedule {
+	struct dest_schedule *next;
+	struct in6_addr dest;
+	uint32_t sends;			 /* it gets all of the options in the first few RAs */
+	uint32_t generation;		 /* of the RA cache the options are in the order of */
+	struct option_schedule *options; /* one per option of the RA cache */
+	struct option_schedule *spare;	 /* to carry them over to the next RA cache */
+	size_t option_count;
+	size_t option_size;
+};
+
 struct Interface {
 	struct Interface *next;
 
@@ -62,14 +139,21 @@ struct Interface {
 	int UnicastOnly;
 	int UnrestrictedUnicast;
 	int AdvRASolicitedUnicast;
+	int AdvOptionScheduling;
 	char *AdvCaptivePortalAPI;
 	struct Clients *ClientList;
+	struct dest_schedule *schedules; /* of the destinations of the unsolicited RAs */
 
 	struct state_info {
 		int ready;   /* Info whether this interface has been initialized successfully */
 		int changed; /* Info whether this interface's settings have changed */
 		int cease_adv;
+		int solicited;	  /* an RS is answered by the next multicast RA */
+		int forwarding;	  /* the forwarding setting of the interface, -1 if not known */
+		int touches;	  /* changes noticed since the last setup, all handled by the next one */
 		uint32_t racount; // count of non-unicast initial router adv
+		int64_t rx_kernel_base; /* RSs and RAs the kernel had received on it when counting started, -1 if unknown */
+		uint64_t rx_packets;	/* the ones radvd received on it since */
 	} state_info;
 
 	struct properties {
@@ -80,6 +164,7 @@ struct Interface {
 		int addrs_count;
 		struct in6_addr *if_addr_rasrc; /* selected AdvRASrcAddress or NULL */
 		uint32_t max_ra_option_size;
+		int sock; /* socket bound to this interface, or -1 to use the shared one */
 	} props;
 
 	struct ra_header_info {
@@ -97,9 +182,23 @@ struct Interface {
 	struct times {
 		struct timespec last_multicast;
 		struct timespec next_multicast;
+		struct timespec earliest_multicast; /* when it may run early, to share a wakeup */
 		struct timespec last_ra_time;
+		size_t queue_pos; /* 1-based slot in the timer queue, 0 if not queued */
 	} times;
 
+	struct ra_cache {
+		struct ra_iov *ras;	   /* the assembled RAs, NULL until the next send builds them */
+		size_t ra_count;
+		struct ra_option *options; /* what they are made of, in the order they were built */
+		size_t option_count;
+		int cease_adv; /* what the router lifetime was built for */
+		int dynamic;   /* built from lifetimes that count down by themselves, not reused */
+		uint32_t generation; /* bumped each time they are assembled */
+		struct safe_buffer_arena arena;	  /* holds all of the above, and their building blocks */
+		struct safe_buffer_arena partial; /* the RAs of the options due, when not all of them are */
+	} ra_cache;
+
 	struct AdvPrefix *AdvPrefixList;
 	struct AdvRoute *AdvRouteList;
 	struct AdvRDNSS *AdvRDNSSList;
@@ -307,16 +406,30 @@ struct Interface *readin_config(char const *fname);
 
 /* radvd.c */
 
+/* event-epoll.c, event-poll.c */
+void event_init(void);
+void event_close(void);
+void event_add_fd(int fd, void (*handler)(int fd, void *data), void *data);
+void event_del_fd(int fd);
+void event_add_signal(int sig, void (*handler)(int sig));
+int event_wait(struct timespec const *deadline);
+
 /* timer.c */
 int expired(struct Interface const *iface);
 int64_t timespecdiff(struct timespec const *a, struct timespec const *b);
 struct timespec next_timespec(double next);
 uint64_t next_time_msec(struct Interface const *iface);
+void clock_now(struct timespec *ts);
+void set_clock_source(void (*source)(struct timespec *ts));
+void simulated_clock(struct timespec *ts);
+void set_simulated_clock(struct timespec const *ts);
 
 /* device.c */
 int check_device(int sock, struct Interface *);
 int check_ip6_forwarding(void);
+int set_ip6_forwarding(int value);
 int check_ip6_iface_forwarding(const char *iface);
+int64_t get_rs_ra_received(const char *iface);
 int get_v4addr(const char *, unsigned int *);
 int set_interface_curhlim(const char *, uint8_t);
 int set_interface_linkmtu(const char *, uint32_t);
@@ -330,41 +443,73 @@ int update_device_info(int sock, struct Interface *);
 int get_iface_addrs(char const *name, struct in6_addr *if_addr, /* the first link local addr */
 		    struct in6_addr **if_addrs			/* all the addrs */
 		    );
+int iface_has_addr(struct Interface const *iface, struct in6_addr const *addr);
+struct ifaddrs const *get_ifaddrs_snapshot(void);
+void drop_ifaddrs_snapshot(void);
+void note_address_change(struct in6_addr const *addr, int deleted);
 
 /* interface.c */
 int check_iface(struct Interface *);
 int setup_iface(int sock, struct Interface *iface);
 int cleanup_iface(int sock, struct Interface *iface);
+int expire_ifaces(void (*foo)(struct Interface *iface, void *), void *data, int max);
 struct Interface *find_iface_by_index(struct Interface *iface, int index);
 struct Interface *find_iface_by_name(struct Interface *iface, const char *name);
-struct Interface *find_iface_by_time(struct Interface *iface_list);
+struct Interface *find_iface_by_time(void);
 void dnssl_init_defaults(struct AdvDNSSL *, struct Interface *);
 void for_each_iface(struct Interface *ifaces, void (*foo)(struct Interface *iface, void *), void *data);
 void free_ifaces(struct Interface *ifaces);
+void iface_queue_add(struct Interface *iface);
+void iface_queue_remove(struct Interface *iface);
 void nat64prefix_init_defaults(struct NAT64Prefix *, struct Interface *);
 void iface_init_defaults(struct Interface *);
 void prefix_init_defaults(struct AdvPrefix *);
 void rdnss_init_defaults(struct AdvRDNSS *, struct Interface *);
 void reschedule_iface(struct Interface *iface, double next);
+void timer_handler(struct Interface *iface, void *data);
+void hasten_iface(struct Interface *iface);
+void pace_iface(struct Interface *iface, double window, int slot, int slots);
+void set_timer_slack(double slack);
 void route_init_defaults(struct AdvRoute *, struct Interface *);
 void touch_iface(struct Interface *iface);
+void reset_iface_rx_stats(struct Interface *iface);
+int64_t get_iface_rx_missed(struct Interface const *iface);
 
 /* socket.c */
 int open_icmpv6_socket(void);
+int set_icmpv6_filter(int sock, int pass);
+void set_icmpv6_prefilter(int enable);
+int open_iface_socket(char const *name);
+int check_iface_socket(char const *name, unsigned int if_index);
+void close_iface_socket(char const *name);
+void for_each_iface_socket(void (*foo)(int sock, void *), void *data);
+void close_iface_sockets(void);
 
 /* send.c */
 int send_ra_forall(int sock, struct Interface *iface, struct in6_addr *dest);
+void send_batch_begin(void);
+void send_batch_end(void);
+void set_send_transport(ssize_t (*transport)(int sock, struct msghdr const *mhdr, int flags));
+void invalidate_ra_cache(struct Interface *iface);
+void free_ra_cache(struct Interface *iface);
+void free_option_schedules(struct Interface *iface);
 
 /* process.c */
 void process(int sock, struct Interface *, unsigned char *, int, struct sockaddr_in6 *, struct in6_pktinfo *, int);
+void process_iface(int sock, struct Interface *, unsigned char *, int, struct sockaddr_in6 *, struct in6_pktinfo *, int);
 
 /* recv.c */
 int recv_rs_ra(int sock, unsigned char *, struct sockaddr_in6 *, struct in6_pktinfo **, int *, unsigned char *);
+int recv_rs_ra_batch(int sock, int max,
+		     void (*foo)(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info,
+				 int hoplimit, void *data),
+		     void *data);
 
 /* util.c */
 int countbits(int b);
 int count_mask(struct sockaddr_in6 *m);
 struct in6_addr get_prefix6(struct in6_addr const *addr, struct in6_addr const *mask);
+struct in6_addr prefixlen_mask(int prefixlen);
 char *strdupf(char const *format, ...) __attribute__((format(printf, 1, 2)));
 double rand_between(double, double);
 int check_dnssl_presence(struct AdvDNSSL *, const char *);
@@ -375,13 +520,19 @@ size_t safe_buffer_pad(struct safe_buffer *sb, size_t count);
 ssize_t readn(int fd, void *buf, size_t count);
 ssize_t writen(int fd, const void *buf, size_t count);
 struct safe_buffer *new_safe_buffer(void);
+struct safe_buffer *new_arena_safe_buffer(struct safe_buffer_arena *arena);
 void addrtostr(struct in6_addr const *, char *, size_t);
 void safe_buffer_free(struct safe_buffer *sb);
+void *safe_buffer_arena_alloc(struct safe_buffer_arena *arena, size_t size);
+void safe_buffer_arena_reset(struct safe_buffer_arena *arena);
+void safe_buffer_arena_free(struct safe_buffer_arena *arena);
 struct safe_buffer_list *new_safe_buffer_list(void);
+struct safe_buffer_list *new_arena_safe_buffer_list(struct safe_buffer_arena *arena);
 void safe_buffer_list_free(struct safe_buffer_list *sbl);
 struct safe_buffer_list *safe_buffer_list_append(struct safe_buffer_list *sbl);
 void safe_buffer_list_to_safe_buffer(struct safe_buffer_list *sbl, struct safe_buffer *sb);
 int drop_root_privileges(const char *);
+void log_stats(void);
 
 /* privsep.c */
 int privsep_interface_curhlim(const char *iface, uint32_t hlim);
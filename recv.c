@@ -17,6 +17,12 @@
 #include "includes.h"
 #include "radvd.h"
 
+#ifdef UNIT_TEST
+#include "test/recv.c"
+#endif
+
+static int parse_rs_ra_cmsgs(struct msghdr *mhdr, struct in6_pktinfo **pkt_info, int *hoplimit);
+
 int recv_rs_ra(int sock, unsigned char *msg, struct sockaddr_in6 *addr, struct in6_pktinfo **pkt_info, int *hoplimit,
 	       unsigned char *chdr)
 {
@@ -34,6 +40,7 @@ int recv_rs_ra(int sock, unsigned char *msg, struct sockaddr_in6 *addr, struct i
 	mhdr.msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int));
 
 	int len = recvmsg(sock, &mhdr, 0);
+	++stats.rx_syscalls;
 
 	if (len < 0) {
 		if (errno != EINTR)
@@ -42,9 +49,97 @@ int recv_rs_ra(int sock, unsigned char *msg, struct sockaddr_in6 *addr, struct i
 		return len;
 	}
 
+	++stats.rx_packets;
+
+	if (parse_rs_ra_cmsgs(&mhdr, pkt_info, hoplimit) < 0)
+		return -1;
+
+	/* if_indextoname opens a socket to ask, which isn't worth it for every packet */
+	if (get_debuglevel() >= 5) {
+		char if_namebuf[IF_NAMESIZE] = {""};
+		char *if_name = 0;
+		if (pkt_info && *pkt_info) {
+			if_name = if_indextoname((*pkt_info)->ipi6_ifindex, if_namebuf);
+		}
+		if (!if_name) {
+			if_name = "unknown interface";
+		}
+		dlog(LOG_DEBUG, 5, "%s recvmsg len=%d", if_name, len);
+	}
+
+	return len;
+}
+
+#ifdef HAVE_RECVMMSG
+/*
+ * Receive up to max (at most RECV_BATCH_MAX) waiting packets with a single
+ * recvmmsg call and hand each one to foo.  Returns the number of packets
+ * received, or -1 if none could be.
+ */
+int recv_rs_ra_batch(int sock, int max,
+		     void (*foo)(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info,
+				 int hoplimit, void *data),
+		     void *data)
+{
+	static unsigned char msgs[RECV_BATCH_MAX][MSG_SIZE_RECV];
+	static unsigned char chdrs[RECV_BATCH_MAX][CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
+	static struct sockaddr_in6 addrs[RECV_BATCH_MAX];
+	static struct iovec iovs[RECV_BATCH_MAX];
+	static struct mmsghdr mmsgs[RECV_BATCH_MAX];
+
+	if (max > RECV_BATCH_MAX)
+		max = RECV_BATCH_MAX;
+
+	for (int i = 0; i < max; ++i) {
+		iovs[i].iov_base = (caddr_t)msgs[i];
+		iovs[i].iov_len = MSG_SIZE_RECV;
+
+		memset(&mmsgs[i], 0, sizeof(mmsgs[i]));
+		mmsgs[i].msg_hdr.msg_name = (caddr_t)&addrs[i];
+		mmsgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		mmsgs[i].msg_hdr.msg_iov = &iovs[i];
+		mmsgs[i].msg_hdr.msg_iovlen = 1;
+		mmsgs[i].msg_hdr.msg_control = (void *)chdrs[i];
+		mmsgs[i].msg_hdr.msg_controllen = sizeof(chdrs[i]);
+	}
+
+	int count = recvmmsg(sock, mmsgs, max, MSG_DONTWAIT, 0);
+	++stats.rx_syscalls;
+
+	if (count < 0) {
+		if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+			flog(LOG_ERR, "recvmmsg: %s", strerror(errno));
+
+		return -1;
+	}
+
+	stats.rx_packets += count;
+	dlog(LOG_DEBUG, 5, "recvmmsg received %d packet(s)", count);
+
+	for (int i = 0; i < count; ++i) {
+		struct in6_pktinfo *pkt_info = NULL;
+		int hoplimit;
+
+		if (parse_rs_ra_cmsgs(&mmsgs[i].msg_hdr, &pkt_info, &hoplimit) < 0)
+			continue;
+
+		if (!pkt_info) {
+			dlog(LOG_INFO, 4, "recvmmsg returned null pkt_info");
+			continue;
+		}
+
+		foo(msgs[i], mmsgs[i].msg_len, &addrs[i], pkt_info, hoplimit, data);
+	}
+
+	return count;
+}
+#endif
+
+static int parse_rs_ra_cmsgs(struct msghdr *mhdr, struct in6_pktinfo **pkt_info, int *hoplimit)
+{
 	*hoplimit = 255;
 
-	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mhdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&mhdr, cmsg)) {
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(mhdr); cmsg != NULL; cmsg = CMSG_NXTHDR(mhdr, cmsg)) {
 		if (cmsg->cmsg_level != IPPROTO_IPV6)
 			continue;
 
@@ -74,15 +169,5 @@ int recv_rs_ra(int sock, unsigned char *msg, struct sockaddr_in6 *addr, struct i
 		}
 	}
 
-	char if_namebuf[IF_NAMESIZE] = {""};
-	char *if_name = 0;
-	if (pkt_info && *pkt_info) {
-		if_name = if_indextoname((*pkt_info)->ipi6_ifindex, if_namebuf);
-	}
-	if (!if_name) {
-		if_name = "unknown interface";
-	}
-	dlog(LOG_DEBUG, 5, "%s recvmsg len=%d", if_name, len);
-
-	return len;
+	return 0;
 }
@@ -18,18 +18,36 @@
 #include "radvd.h"
 #include "netlink.h"
 
-static int really_send(int sock, struct in6_addr const *dest, struct properties const *props, struct safe_buffer const *sb);
+static int really_send(int sock, struct in6_addr const *dest, struct Interface const *iface, struct iovec *iov, int iovlen);
+static void send_batch_flush(void);
+static void send_batch_release(struct Interface const *iface);
+static int send_batch_holds(struct Interface const *iface);
+static void count_sent(int count);
+static void log_send_error(int IgnoreIfMissing, char const *if_name);
 static int send_ra(int sock, struct Interface *iface, struct in6_addr const *dest);
-static struct safe_buffer_list *build_ra_options(struct Interface const *iface, struct in6_addr const *dest);
+static void refresh_ra_cache(struct Interface *iface);
+static int send_cached_ra(int sock, struct Interface *iface, struct in6_addr const *dest);
+static void assemble_ras(struct Interface const *iface, struct in6_addr const *dest, int cease_adv, struct ra_cache *cache);
+static size_t pack_ras(struct Interface const *iface, struct iovec const *hdr, struct ra_option const *options, size_t count,
+		       unsigned char const *due, struct safe_buffer_arena *arena, struct ra_iov **ras);
+static size_t plan_ras(size_t const *sizes, size_t count, size_t room, size_t *ra_of, struct safe_buffer_arena *arena);
+static int cmp_plan_items(void const *a, void const *b);
+static void record_option(struct safe_buffer *option, int type, void const *source);
+static int patch_ra_cache(struct Interface *iface, int cease_adv);
+static int send_ra_forall_batched(int sock, struct Interface *iface, struct in6_addr *dest);
+static struct safe_buffer_list *build_ra_options(struct Interface const *iface, struct in6_addr const *dest,
+						  struct safe_buffer_arena *arena);
 
 static int ensure_iface_setup(int sock, struct Interface *iface);
 static void decrement_lifetime(const time_t secs, uint32_t *lifetime);
-static void update_iface_times(struct Interface *iface);
+static int update_iface_times(struct Interface *iface);
 
 // Option helpers
 static size_t serialize_domain_names(struct safe_buffer *safe_buffer, struct AdvDNSSL const *dnssl);
 static int get_prefix_lifetimes(struct AdvPrefix const *prefix, unsigned int *valid_lft, unsigned int *preferred_lft);
 static void limit_prefix_lifetimes(struct AdvPrefix *prefix);
+static void prefix_lifetimes(struct AdvPrefix const *prefix, int cease_adv, uint32_t *validlft, uint32_t *preferredlft);
+static uint16_t nat64_lifetime_preflen(uint32_t validlft, uint8_t prefix_length_code);
 
 // Options that only need a single block
 static void add_ra_header(struct safe_buffer *sb, struct ra_header_info const *ra_header_info, int cease_adv);
@@ -55,18 +73,122 @@ static struct safe_buffer_list *add_ra_options_dnssl(struct safe_buffer_list *sb
 						     struct AdvDNSSL const *dnssl, int cease_adv, struct in6_addr const *dest);
 
 // Scheduling of options per RFC7772
-static int schedule_helper(struct in6_addr const *dest, struct Interface const *iface, int option_lifetime);
-static int schedule_option_prefix(struct in6_addr const *dest, struct Interface const *iface, struct AdvPrefix const *prefix);
-static int schedule_option_route(struct in6_addr const *dest, struct Interface const *iface, struct AdvRoute const *route);
-static int schedule_option_rdnss(struct in6_addr const *dest, struct Interface const *iface, struct AdvRDNSS const *rdnss);
-static int schedule_option_dnssl(struct in6_addr const *dest, struct Interface const *iface, struct AdvDNSSL const *dnssl);
-static int schedule_option_mtu(struct in6_addr const *dest, struct Interface const *iface);
-static int schedule_option_sllao(struct in6_addr const *dest, struct Interface const *iface);
-static int schedule_option_mipv6_rtr_adv_interval(struct in6_addr const *dest, struct Interface const *iface);
-static int schedule_option_mipv6_home_agent_info(struct in6_addr const *dest, struct Interface const *iface);
-static int schedule_option_lowpanco(struct in6_addr const *dest, struct Interface const *iface);
-static int schedule_option_abro(struct in6_addr const *dest, struct Interface const *iface);
-static int schedule_option_capport(struct in6_addr const *dest, struct Interface const *iface);
+static size_t schedule_ras(struct Interface *iface, struct in6_addr const *dest, struct ra_iov **ras);
+static struct dest_schedule *find_dest_schedule(struct Interface *iface, struct in6_addr const *dest, int create);
+static void remap_dest_schedule(struct dest_schedule *schedule, struct ra_cache const *cache);
+static void option_schedule_key(struct ra_option const *option, struct in6_addr *prefix);
+static int schedule_option(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option);
+static int schedule_helper(struct option_schedule const *schedule, struct Interface const *iface, uint32_t option_lifetime);
+static int schedule_option_prefix(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option);
+static int schedule_option_nat64prefix(struct option_schedule const *schedule, struct Interface const *iface,
+				       struct ra_option const *option);
+static int schedule_option_route(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option);
+static int schedule_option_rdnss(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option);
+static int schedule_option_dnssl(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option);
+static int schedule_option_router_lifetime(struct option_schedule const *schedule, struct Interface const *iface,
+					   struct ra_option const *option);
+static int schedule_option_mipv6_home_agent_info(struct option_schedule const *schedule, struct Interface const *iface,
+						 struct ra_option const *option);
+static int schedule_option_lowpanco(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option);
+static int schedule_option_abro(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option);
+
+// The option descriptors, what build_ra_options, the sizes and the scheduling go through
+static int has_prefixes(struct Interface const *iface);
+static int has_nat64prefixes(struct Interface const *iface);
+static int has_routes(struct Interface const *iface);
+static int has_rdnss(struct Interface const *iface);
+static int has_dnssl(struct Interface const *iface);
+static int has_mtu(struct Interface const *iface);
+static int has_sllao(struct Interface const *iface);
+static int has_mipv6_rtr_adv_interval(struct Interface const *iface);
+static int has_mipv6_home_agent_info(struct Interface const *iface);
+static int has_lowpanco(struct Interface const *iface);
+static int has_abro(struct Interface const *iface);
+static int has_capport(struct Interface const *iface);
+static struct safe_buffer_list *encode_prefixes(struct safe_buffer_list *sbl, struct Interface const *iface,
+						struct in6_addr const *dest);
+static struct safe_buffer_list *encode_nat64prefixes(struct safe_buffer_list *sbl, struct Interface const *iface,
+						     struct in6_addr const *dest);
+static struct safe_buffer_list *encode_routes(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest);
+static struct safe_buffer_list *encode_rdnss(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest);
+static struct safe_buffer_list *encode_dnssl(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest);
+static struct safe_buffer_list *encode_mtu(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest);
+static struct safe_buffer_list *encode_sllao(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest);
+static struct safe_buffer_list *encode_mipv6_rtr_adv_interval(struct safe_buffer_list *sbl, struct Interface const *iface,
+							      struct in6_addr const *dest);
+static struct safe_buffer_list *encode_mipv6_home_agent_info(struct safe_buffer_list *sbl, struct Interface const *iface,
+							     struct in6_addr const *dest);
+static struct safe_buffer_list *encode_lowpanco(struct safe_buffer_list *sbl, struct Interface const *iface,
+						struct in6_addr const *dest);
+static struct safe_buffer_list *encode_abro(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest);
+static struct safe_buffer_list *encode_capport(struct safe_buffer_list *sbl, struct Interface const *iface,
+					       struct in6_addr const *dest);
+static size_t route_option_bytes(struct AdvRoute const *route);
+static size_t sllao_option_bytes(struct sllao const *sllao);
+static size_t capport_option_bytes(char const *captive_portal);
+static struct ra_option_desc const *find_option_desc(int type);
+
+/*
+ * The RA options, in the order they are built.  present tells whether iface
+ * has any, encode appends them to the list, each recorded with
+ * record_option, and schedule whether one of them is due (see
+ * schedule_ras).
+ */
+struct ra_option_desc {
+	int type;
+	int (*present)(struct Interface const *iface);
+	struct safe_buffer_list *(*encode)(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest);
+	int (*schedule)(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option);
+};
+
+static struct ra_option_desc const ra_option_descs[] = {
+    {ND_OPT_PREFIX_INFORMATION, has_prefixes, encode_prefixes, schedule_option_prefix},
+    {ND_OPT_PREF64, has_nat64prefixes, encode_nat64prefixes, schedule_option_nat64prefix},
+    {ND_OPT_ROUTE_INFORMATION, has_routes, encode_routes, schedule_option_route},
+    {ND_OPT_RDNSS_INFORMATION, has_rdnss, encode_rdnss, schedule_option_rdnss},
+    {ND_OPT_DNSSL_INFORMATION, has_dnssl, encode_dnssl, schedule_option_dnssl},
+    {ND_OPT_MTU, has_mtu, encode_mtu, schedule_option_router_lifetime},
+    {ND_OPT_SOURCE_LINKADDR, has_sllao, encode_sllao, schedule_option_router_lifetime},
+    {ND_OPT_RTR_ADV_INTERVAL, has_mipv6_rtr_adv_interval, encode_mipv6_rtr_adv_interval, schedule_option_router_lifetime},
+    {ND_OPT_HOME_AGENT_INFO, has_mipv6_home_agent_info, encode_mipv6_home_agent_info, schedule_option_mipv6_home_agent_info},
+    {ND_OPT_6CO, has_lowpanco, encode_lowpanco, schedule_option_lowpanco},
+    {ND_OPT_ABRO, has_abro, encode_abro, schedule_option_abro},
+    {ND_OPT_CAPTIVE_PORTAL, has_capport, encode_capport, schedule_option_router_lifetime},
+};
+
+/*
+ * While a batch is open, really_send queues the RAs here instead of sending
+ * them, and they all go out with sendmmsg when the outermost batch ends.
+ * The packets are not copied, they point into the RA cache of iface, which
+ * sends them with send_batch_release before it changes.
+ */
+struct send_batch_entry {
+	struct msghdr mhdr;
+	struct sockaddr_in6 addr;
+	char __attribute__((aligned(8))) chdr[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+	struct Interface const *iface;
+	int IgnoreIfMissing;
+	char if_name[IFNAMSIZ];
+};
+
+static struct send_batch_entry send_batch[SEND_BATCH_MAX];
+static int send_batch_len = 0;
+static int send_batch_depth = 0;
+static int send_batch_sock = -1;
+
+/* Replaces sendmsg, to capture the RAs instead of sending them; NULL sends them. */
+static ssize_t (*send_transport)(int sock, struct msghdr const *mhdr, int flags) = NULL;
+
+/* Set while the RA options are built from data that changes by itself, so they can't be cached. */
+static int ra_options_dynamic = 0;
+
+/* Set while the RAs being sent answer an RS, so they carry all of the options. */
+static int ra_solicited = 0;
+
+/* The options built, in build order, for assemble_ras to keep in the cache with the RAs. */
+static struct ra_option *built_options = NULL;
+static size_t built_option_count = 0;
+static size_t built_option_size = 0;
 
 #ifdef UNIT_TEST
 #include "test/send.c"
@@ -81,6 +203,21 @@ static int schedule_option_capport(struct in6_addr const *dest, struct Interface
  *
  */
 int send_ra_forall(int sock, struct Interface *iface, struct in6_addr *dest)
+{
+	/* An RS is answered with all of the options, unicast or by the next multicast RA. */
+	ra_solicited = dest != NULL || iface->state_info.solicited;
+	if (dest == NULL)
+		iface->state_info.solicited = 0;
+
+	send_batch_begin();
+	int rc = send_ra_forall_batched(sock, iface, dest);
+	send_batch_end();
+	ra_solicited = 0;
+
+	return rc;
+}
+
+static int send_ra_forall_batched(int sock, struct Interface *iface, struct in6_addr *dest)
 {
 	/* when netlink is not available (disabled or BSD), ensure_iface_setup is necessary. */
 	if (ensure_iface_setup(sock, iface) < 0) {
@@ -88,6 +225,10 @@ int send_ra_forall(int sock, struct Interface *iface, struct in6_addr *dest)
 		return -1;
 	}
 
+	/* Set up on the shared socket, the RAs go out on the interface's own if it still has one. */
+	if (iface->props.sock >= 0)
+		sock = iface->props.sock;
+
 	// Ignore unicast request/response - otherwise rapid unicast
 	// requests during startup can cause multicast/broadcast RAs to *NOT* be
 	// sent on the desired schedule.
@@ -105,6 +246,14 @@ int send_ra_forall(int sock, struct Interface *iface, struct in6_addr *dest)
 		return send_ra(sock, iface, dest);
 	}
 
+	if (!iface->AdvSendAdvert) {
+		dlog(LOG_DEBUG, 2, "AdvSendAdvert is off for %s", iface->props.name);
+		return 0;
+	}
+
+	/* The RA is the same for all of the clients, bring it up to date once for this tick, not once for each. */
+	refresh_ra_cache(iface);
+
 	/* If clients are configured, send the advertisement to all of them via unicast */
 	for (struct Clients *current = iface->ClientList; current; current = current->next) {
 		/* If a non-authorized client sent a solicitation, ignore it (logging later) */
@@ -120,7 +269,7 @@ int send_ra_forall(int sock, struct Interface *iface, struct in6_addr *dest)
 			continue;
 		}
 
-		send_ra(sock, iface, &(current->Address));
+		send_cached_ra(sock, iface, &(current->Address));
 
 		/* If we should only send the RA to a specific address, we are done */
 		if (dest != NULL)
@@ -132,7 +281,7 @@ int send_ra_forall(int sock, struct Interface *iface, struct in6_addr *dest)
 
 	/* Reply with advertisement to unlisted clients */
 	if (iface->UnrestrictedUnicast) {
-		return send_ra(sock, iface, dest);
+		return send_cached_ra(sock, iface, dest);
 	}
 
 	/* If we refused a client's solicitation, log it if debugging is high enough */
@@ -170,26 +319,40 @@ static void decrement_lifetime(const time_t secs, uint32_t *lifetime)
 	}
 }
 
-static void update_iface_times(struct Interface *iface)
+/*
+ * Returns 1 if a decremented prefix lifetime changed, and with it the RA.
+ * Only whole seconds are taken off the lifetimes, last_ra_time moves on by
+ * as many, so that the fraction left over counts towards the next RA
+ * instead of being lost each time and the lifetimes lagging behind.
+ */
+static int update_iface_times(struct Interface *iface)
 {
-	struct timespec last_time = iface->times.last_ra_time;
-	clock_gettime(CLOCK_MONOTONIC, &iface->times.last_ra_time);
-	time_t secs_since_last_ra = timespecdiff(&iface->times.last_ra_time, &last_time) / 1000;
+	int changed = 0;
+	struct timespec now;
+	clock_now(&now);
+	time_t secs_since_last_ra = timespecdiff(&now, &iface->times.last_ra_time) / 1000;
 
 	if (secs_since_last_ra < 0) {
 		secs_since_last_ra = 0;
+		iface->times.last_ra_time = now;
 		flog(LOG_WARNING, "clock_gettime(CLOCK_MONOTONIC) went backwards!");
 	}
+	iface->times.last_ra_time.tv_sec += secs_since_last_ra;
 
 	struct AdvPrefix *prefix = iface->AdvPrefixList;
 	while (prefix) {
 		if (!prefix->DecrementLifetimesFlag || prefix->curr_preferredlft > 0) {
 			if (!(iface->state_info.cease_adv && prefix->DeprecatePrefixFlag)) {
 				if (prefix->DecrementLifetimesFlag) {
+					uint32_t validlft = prefix->curr_validlft;
+					uint32_t preferredlft = prefix->curr_preferredlft;
 
 					decrement_lifetime(secs_since_last_ra, &prefix->curr_validlft);
 					decrement_lifetime(secs_since_last_ra, &prefix->curr_preferredlft);
 
+					if (prefix->curr_validlft != validlft || prefix->curr_preferredlft != preferredlft)
+						changed = 1;
+
 					if (prefix->curr_preferredlft == 0) {
 						char pfx_str[INET6_ADDRSTRLEN];
 						addrtostr(&prefix->Prefix, pfx_str, sizeof(pfx_str));
@@ -201,6 +364,8 @@ static void update_iface_times(struct Interface *iface)
 		}
 		prefix = prefix->next;
 	}
+
+	return changed;
 }
 
 /********************************************************************************
@@ -248,22 +413,31 @@ static void add_ra_option_prefix(struct safe_buffer *sb, struct AdvPrefix const
 	pinfo.nd_opt_pi_flags_reserved |= (prefix->AdvRouterAddr) ? ND_OPT_PI_FLAG_RADDR : 0;
 	pinfo.nd_opt_pi_flags_reserved |= (prefix->AdvDHCPv6PDPreferredFlag) ? ND_OPT_PI_FLAG_DHCPv6_PD_PREF : 0;
 
+	uint32_t validlft, preferredlft;
+	prefix_lifetimes(prefix, cease_adv, &validlft, &preferredlft);
+	pinfo.nd_opt_pi_valid_time = htonl(validlft);
+	pinfo.nd_opt_pi_preferred_time = htonl(preferredlft);
+
+	memcpy(&pinfo.nd_opt_pi_prefix, &prefix->Prefix, sizeof(struct in6_addr));
+
+	safe_buffer_append(sb, &pinfo, sizeof(pinfo));
+}
+
+/* The lifetimes advertised for prefix. */
+static void prefix_lifetimes(struct AdvPrefix const *prefix, int cease_adv, uint32_t *validlft, uint32_t *preferredlft)
+{
 	if (cease_adv && prefix->DeprecatePrefixFlag) {
 		/* RFC4862, 5.5.3, step e) */
 		if (prefix->curr_validlft < MIN_AdvValidLifetime) {
-			pinfo.nd_opt_pi_valid_time = htonl(prefix->curr_validlft);
+			*validlft = prefix->curr_validlft;
 		} else {
-			pinfo.nd_opt_pi_valid_time = htonl(MIN_AdvValidLifetime);
+			*validlft = MIN_AdvValidLifetime;
 		}
-		pinfo.nd_opt_pi_preferred_time = 0;
+		*preferredlft = 0;
 	} else {
-		pinfo.nd_opt_pi_valid_time = htonl(prefix->curr_validlft);
-		pinfo.nd_opt_pi_preferred_time = htonl(prefix->curr_preferredlft);
+		*validlft = prefix->curr_validlft;
+		*preferredlft = prefix->curr_preferredlft;
 	}
-
-	memcpy(&pinfo.nd_opt_pi_prefix, &prefix->Prefix, sizeof(struct in6_addr));
-
-	safe_buffer_append(sb, &pinfo, sizeof(pinfo));
 }
 
 static int get_prefix_lifetimes (struct AdvPrefix const *prefix, unsigned int *valid_lft, unsigned int *preferred_lft) {
@@ -288,6 +462,12 @@ static void limit_prefix_lifetimes(struct AdvPrefix *prefix) {
   if(ret) {
     prefix->curr_validlft = min(valid, prefix->curr_validlft);
     prefix->curr_preferredlft = min(preferred, prefix->curr_preferredlft);
+    /*
+     * finite kernel lifetimes count down without an event to tell, an
+     * address changing is told by RTM_NEWADDR, which drops the cached RAs
+     */
+    if (valid != UINT32_MAX || preferred != UINT32_MAX)
+      ra_options_dynamic = 1;
   }
 }
 
@@ -345,9 +525,7 @@ static void add_ra_option_nat64prefix(struct safe_buffer *sb, struct NAT64Prefix
          step ensures that lifetimes under 8 seconds are encoded as a nonzero
          Scaled Lifetime.
 	*/
-	pinfo.nd_opt_pi_lifetime_preflen = htons(
-		((prefix->curr_validlft + 7) & 0xFFF8) |
-		(prefix_length_code & 0x7));
+	pinfo.nd_opt_pi_lifetime_preflen = htons(nat64_lifetime_preflen(prefix->curr_validlft, prefix_length_code));
 
 	/* Only copy 96 bits of the prefix */
 	memcpy(&pinfo.nd_opt_pi_nat64prefix, &prefix->Prefix, 12);
@@ -355,6 +533,11 @@ static void add_ra_option_nat64prefix(struct safe_buffer *sb, struct NAT64Prefix
 	safe_buffer_append(sb, &pinfo, sizeof(pinfo));
 }
 
+static uint16_t nat64_lifetime_preflen(uint32_t validlft, uint8_t prefix_length_code)
+{
+	return ((validlft + 7) & 0xFFF8) | (prefix_length_code & 0x7);
+}
+
 static struct safe_buffer_list *add_auto_prefixes_6to4(struct safe_buffer_list *sbl, struct Interface const *iface,
 						       char const *ifname, struct AdvPrefix const *prefix, int cease_adv,
 						       struct in6_addr const *dest)
@@ -363,6 +546,9 @@ static struct safe_buffer_list *add_auto_prefixes_6to4(struct safe_buffer_list *
 	struct AdvPrefix xprefix = *prefix;
 	unsigned int dst;
 
+	/* the IPv4 address is not watched for changes */
+	ra_options_dynamic = 1;
+
 	if (get_v4addr(prefix->if6to4, &dst) < 0) {
 		flog(LOG_ERR, "Base6to4interface %s has no IPv4 addresses", prefix->if6to4);
 	} else {
@@ -379,26 +565,71 @@ static struct safe_buffer_list *add_auto_prefixes_6to4(struct safe_buffer_list *
 		// TODO: audit clobbers of prefixes based on original config?
 		limit_prefix_lifetimes(&xprefix);
 
-		if (cease_adv || schedule_option_prefix(dest, iface, &xprefix)) {
-			sbl = safe_buffer_list_append(sbl);
-			add_ra_option_prefix(sbl->sb, &xprefix, cease_adv);
-		}
+		sbl = safe_buffer_list_append(sbl);
+		add_ra_option_prefix(sbl->sb, &xprefix, cease_adv);
+		record_option(sbl->sb, ND_OPT_PREFIX_INFORMATION, prefix);
 	}
 #endif
 	return sbl;
 }
 
+/* The prefix of addr/mask, unless it is one of the prefixes to ignore. */
+static struct safe_buffer_list *add_auto_prefix(struct safe_buffer_list *sbl, struct Interface const *iface, char const *ifname,
+						struct AdvPrefix const *prefix, int cease_adv, struct in6_addr const *addr,
+						struct in6_addr const *mask, int prefixlen)
+{
+	if (IN6_IS_ADDR_LINKLOCAL(addr))
+		return sbl;
+
+	struct in6_addr prefix6 = get_prefix6(addr, mask);
+
+	for (struct AutogenIgnorePrefix *current = iface->IgnorePrefixList; current; current = current->next) {
+		struct in6_addr candidatePrefix6 = get_prefix6(&current->Prefix, &current->Mask);
+
+		if (memcmp(&prefix6, &candidatePrefix6, sizeof(struct in6_addr)) == 0 &&
+		    memcmp(mask, &current->Mask, sizeof(struct in6_addr)) == 0)
+			return sbl;
+	}
+
+	struct AdvPrefix xprefix = *prefix;
+	xprefix.Prefix = prefix6;
+	xprefix.PrefixLen = prefixlen;
+
+	char pfx_str[INET6_ADDRSTRLEN];
+	addrtostr(&xprefix.Prefix, pfx_str, sizeof(pfx_str));
+	dlog(LOG_DEBUG, 3, "auto-selected prefix %s/%d on interface %s", pfx_str, xprefix.PrefixLen, ifname);
+
+	/** We want to get the lowest value out of the configured lifetime (from /etc/radvd.conf) and the maximum lifetime on
+	 *  any address that is part of that prefix in the kernel to avoid advertising a prefix that might expire too soon */
+	// TODO: audit clobbers of prefixes based on original config?
+	limit_prefix_lifetimes(&xprefix);
+
+	sbl = safe_buffer_list_append(sbl);
+	add_ra_option_prefix(sbl->sb, &xprefix, cease_adv);
+	record_option(sbl->sb, ND_OPT_PREFIX_INFORMATION, prefix);
+
+	return sbl;
+}
+
 static struct safe_buffer_list *add_auto_prefixes(struct safe_buffer_list *sbl, struct Interface const *iface, char const *ifname,
 						  struct AdvPrefix const *prefix, int cease_adv, struct in6_addr const *dest)
 {
-#ifdef HAVE_IFADDRS_H
-	struct AdvPrefix xprefix;
-	struct ifaddrs *ifap = 0, *ifa = 0;
-
-	if (getifaddrs(&ifap) != 0)
-		flog(LOG_ERR, "getifaddrs failed: %s", strerror(errno));
+#ifdef HAVE_NETLINK
+	/* the addresses netlink keeps, looked up by index for the interface itself */
+	struct iface_addr const *addrs;
+	int ifindex = strcmp(ifname, iface->props.name) ? 0 : iface->props.if_index;
+	int count = netlink_iface_addrs(ifindex, ifname, &addrs);
+	if (count >= 0) {
+		for (int i = 0; i < count; ++i) {
+			struct in6_addr mask = prefixlen_mask(addrs[i].prefixlen);
+			sbl = add_auto_prefix(sbl, iface, ifname, prefix, cease_adv, &addrs[i].addr, &mask, addrs[i].prefixlen);
+		}
+		return sbl;
+	}
+#endif
 
-	for (ifa = ifap; ifa; ifa = ifa->ifa_next) {
+#ifdef HAVE_IFADDRS_H
+	for (struct ifaddrs const *ifa = get_ifaddrs_snapshot(); ifa; ifa = ifa->ifa_next) {
 
 		if (strncmp(ifa->ifa_name, ifname, IFNAMSIZ))
 			continue;
@@ -414,46 +645,15 @@ static struct safe_buffer_list *add_auto_prefixes(struct safe_buffer_list *sbl,
 		struct sockaddr_in6 *s6 = (struct sockaddr_in6 *)ifa->ifa_addr;
 		struct sockaddr_in6 *mask = (struct sockaddr_in6 *)ifa->ifa_netmask;
 
-		if (IN6_IS_ADDR_LINKLOCAL(&s6->sin6_addr))
-			continue;
-
-		struct in6_addr prefix6 = get_prefix6(&s6->sin6_addr, &mask->sin6_addr);
-
-		int ignore = 0;
-		for (struct AutogenIgnorePrefix *current = iface->IgnorePrefixList; current; current = current->next) {
-			struct in6_addr candidatePrefix6 = get_prefix6(&current->Prefix, &current->Mask);
-
-			if (memcmp(&prefix6, &candidatePrefix6, sizeof(struct in6_addr)) == 0 &&
-			    memcmp(&mask->sin6_addr, &current->Mask, sizeof(struct in6_addr)) == 0) {
-				ignore = 1;
-				break;
-			}
-		}
-
-		if (ignore)
-			continue;
-
-		xprefix = *prefix;
-		xprefix.Prefix = prefix6;
-		xprefix.PrefixLen = count_mask(mask);
-
-		char pfx_str[INET6_ADDRSTRLEN];
-		addrtostr(&xprefix.Prefix, pfx_str, sizeof(pfx_str));
-		dlog(LOG_DEBUG, 3, "auto-selected prefix %s/%d on interface %s", pfx_str, xprefix.PrefixLen, ifname);
-
-		/** We want to get the lowest value out of the configured lifetime (from /etc/radvd.conf) and the maximum lifetime on
-		 *  any address that is part of that prefix in the kernel to avoid advertising a prefix that might expire too soon */
-		// TODO: audit clobbers of prefixes based on original config?
-		limit_prefix_lifetimes(&xprefix);
-
-		if (cease_adv || schedule_option_prefix(dest, iface, &xprefix)) {
-			sbl = safe_buffer_list_append(sbl);
-			add_ra_option_prefix(sbl->sb, &xprefix, cease_adv);
-		}
+		sbl = add_auto_prefix(sbl, iface, ifname, prefix, cease_adv, &s6->sin6_addr, &mask->sin6_addr, count_mask(mask));
 	}
 
-	if (ifap)
-		freeifaddrs(ifap);
+#ifndef HAVE_NETLINK
+	/* nothing tells when the addresses change, setup_iface sees those of the interface itself */
+	drop_ifaddrs_snapshot();
+	if (strcmp(ifname, iface->props.name))
+		ra_options_dynamic = 1;
+#endif
 #endif
 	return sbl;
 }
@@ -463,6 +663,7 @@ static struct safe_buffer_list *add_ra_options_nat64prefix(struct safe_buffer_li
 	while (prefix) {
 		sbl = safe_buffer_list_append(sbl);
 		add_ra_option_nat64prefix(sbl->sb, prefix);
+		record_option(sbl->sb, ND_OPT_PREF64, prefix);
 
 		prefix = prefix->next;
 	}
@@ -491,16 +692,15 @@ static struct safe_buffer_list *add_ra_options_prefix(struct safe_buffer_list *s
 					sbl = add_auto_prefixes(sbl, iface, iface->props.name, prefix, cease_adv, dest);
 				}
 			} else {
-				if (cease_adv || schedule_option_prefix(dest, iface, prefix)) {
-					sbl = safe_buffer_list_append(sbl);
-
-		            /** We want to get the lowest value out of the configured lifetime (from /etc/radvd.conf) and the maximum lifetime on
-		             *  any address that is part of that prefix in the kernel to avoid advertising a prefix that might expire too soon */
-					// TODO: audit clobbers of prefixes based on original config?
-					struct AdvPrefix xprefix = *prefix;
-					limit_prefix_lifetimes(&xprefix);
-					add_ra_option_prefix(sbl->sb, &xprefix, cease_adv);
-				}
+				sbl = safe_buffer_list_append(sbl);
+
+		        /** We want to get the lowest value out of the configured lifetime (from /etc/radvd.conf) and the maximum lifetime on
+		         *  any address that is part of that prefix in the kernel to avoid advertising a prefix that might expire too soon */
+				// TODO: audit clobbers of prefixes based on original config?
+				struct AdvPrefix xprefix = *prefix;
+				limit_prefix_lifetimes(&xprefix);
+				add_ra_option_prefix(sbl->sb, &xprefix, cease_adv);
+				record_option(sbl->sb, ND_OPT_PREFIX_INFORMATION, prefix);
 			}
 		}
 
@@ -570,21 +770,10 @@ static struct safe_buffer_list *add_ra_options_route(struct safe_buffer_list *sb
 	while (route) {
 		struct nd_opt_route_info_local rinfo;
 
-		if (!cease_adv && !schedule_option_route(dest, iface, route)) {
-			route = route->next;
-			continue;
-		}
-
 		memset(&rinfo, 0, sizeof(rinfo));
 
 		rinfo.nd_opt_ri_type = ND_OPT_ROUTE_INFORMATION;
-		if (route->PrefixLen == 0) {
-			rinfo.nd_opt_ri_len = 1;
-		} else if (route->PrefixLen > 0 && route->PrefixLen <= 64) {
-			rinfo.nd_opt_ri_len = 2;
-		} else if (route->PrefixLen > 64 && route->PrefixLen <= 128) {
-			rinfo.nd_opt_ri_len = 3;
-		}
+		rinfo.nd_opt_ri_len = route_option_bytes(route) / 8;
 		rinfo.nd_opt_ri_prefix_len = route->PrefixLen;
 
 		rinfo.nd_opt_ri_flags_reserved = (route->AdvRoutePreference << ND_OPT_RI_PRF_SHIFT) & ND_OPT_RI_PRF_MASK;
@@ -598,6 +787,7 @@ static struct safe_buffer_list *add_ra_options_route(struct safe_buffer_list *sb
 
 		sbl = safe_buffer_list_append(sbl);
 		safe_buffer_append(sbl->sb, &rinfo, rinfo.nd_opt_ri_len * 8);
+		record_option(sbl->sb, ND_OPT_ROUTE_INFORMATION, route);
 
 		route = route->next;
 	}
@@ -609,10 +799,6 @@ static struct safe_buffer_list *add_ra_options_rdnss(struct safe_buffer_list *sb
 {
 	while (rdnss) {
 		struct nd_opt_rdnss_info_local rdnssinfo;
-		if (!cease_adv && !schedule_option_rdnss(dest, iface, rdnss)) {
-			rdnss = rdnss->next;
-			continue;
-		}
 
 		memset(&rdnssinfo, 0, sizeof(rdnssinfo));
 
@@ -646,6 +832,7 @@ static struct safe_buffer_list *add_ra_options_rdnss(struct safe_buffer_list *sb
 			safe_buffer_append(sbl->sb, &rdnss->AdvRDNSSAddr[i], sizeof(struct in6_addr));
 		}
 		// padding is only required for DNSSL
+		record_option(sbl->sb, ND_OPT_RDNSS_INFORMATION, rdnss);
 
 		rdnss = rdnss->next;
 	}
@@ -656,16 +843,11 @@ static struct safe_buffer_list *add_ra_options_rdnss(struct safe_buffer_list *sb
 static struct safe_buffer_list *add_ra_options_dnssl(struct safe_buffer_list *sbl, struct Interface const *iface,
 						     struct AdvDNSSL const *dnssl, int cease_adv, struct in6_addr const *dest)
 {
-	struct safe_buffer *serialized_domains = new_safe_buffer();
+	struct safe_buffer *serialized_domains = new_arena_safe_buffer(sbl->sb->arena);
 	while (dnssl) {
 
 		struct nd_opt_dnssl_info_local dnsslinfo;
 
-		if (!cease_adv && !schedule_option_dnssl(dest, iface, dnssl)) {
-			dnssl = dnssl->next;
-			continue;
-		}
-
 		memset(&dnsslinfo, 0, sizeof(dnsslinfo));
 
 		serialized_domains->used = 0;
@@ -701,6 +883,7 @@ static struct safe_buffer_list *add_ra_options_dnssl(struct safe_buffer_list *sb
 		safe_buffer_append(sbl->sb, &dnsslinfo, sizeof(dnsslinfo));
 		safe_buffer_append(sbl->sb, serialized_domains->buffer, serialized_domains->used);
 		safe_buffer_pad(sbl->sb, padding);
+		record_option(sbl->sb, ND_OPT_DNSSL_INFORMATION, dnssl);
 		// abort();
 
 		dnssl = dnssl->next;
@@ -716,7 +899,7 @@ static void add_ra_option_sllao(struct safe_buffer *sb, struct sllao const *slla
 {
 	/* +2 for the ND_OPT_SOURCE_LINKADDR and the length (each occupy one byte) */
 	size_t const sllao_bytes = (sllao->if_hwaddr_len / 8) + 2;
-	size_t const sllao_len = (sllao_bytes + 7) / 8;
+	size_t const sllao_len = sllao_option_bytes(sllao) / 8;
 
 	uint8_t buff[2] = {ND_OPT_SOURCE_LINKADDR, (uint8_t)sllao_len};
 	safe_buffer_append(sb, buff, sizeof(buff));
@@ -826,7 +1009,7 @@ static void add_ra_option_capport(struct safe_buffer *sb, const char *captive_po
 	/* +2 for the ND_OPT_CAPTIVE_PORTAL and the length (each occupy one byte) */
 	size_t const capport_strlen = strlen(captive_portal);
 	size_t const capport_bytes = capport_strlen + 2;
-	size_t const capport_len = (capport_bytes + 7) / 8;
+	size_t const capport_len = capport_option_bytes(captive_portal) / 8;
 
 	uint8_t buff[2] = {ND_OPT_CAPTIVE_PORTAL, (uint8_t)capport_len};
 	safe_buffer_append(sb, buff, sizeof(buff));
@@ -835,77 +1018,159 @@ static void add_ra_option_capport(struct safe_buffer *sb, const char *captive_po
 	safe_buffer_pad(sb, (capport_len * 8) - capport_bytes);
 }
 
-static struct safe_buffer_list *build_ra_options(struct Interface const *iface, struct in6_addr const *dest)
+/* The route length is in units of 8 octets, as much of the prefix as its length needs. */
+static size_t route_option_bytes(struct AdvRoute const *route)
+{
+	if (route->PrefixLen == 0)
+		return 8;
+	if (route->PrefixLen <= 64)
+		return 16;
+	if (route->PrefixLen <= 128)
+		return 24;
+	return 0;
+}
+
+static size_t sllao_option_bytes(struct sllao const *sllao) { return ((sllao->if_hwaddr_len / 8) + 2 + 7) / 8 * 8; }
+
+static size_t capport_option_bytes(char const *captive_portal) { return (strlen(captive_portal) + 2 + 7) / 8 * 8; }
+
+static struct safe_buffer_list *build_ra_options(struct Interface const *iface, struct in6_addr const *dest,
+						  struct safe_buffer_arena *arena)
 {
-	struct safe_buffer_list *sbl = new_safe_buffer_list();
+	struct safe_buffer_list *sbl = new_arena_safe_buffer_list(arena);
 	struct safe_buffer_list *cur = sbl;
 
-	if (iface->AdvPrefixList) {
-		cur =
-		    add_ra_options_prefix(cur, iface, iface->props.name, iface->AdvPrefixList, iface->state_info.cease_adv, dest);
+	for (size_t i = 0; i < sizeof(ra_option_descs) / sizeof(ra_option_descs[0]); ++i) {
+		if (ra_option_descs[i].present(iface))
+			cur = ra_option_descs[i].encode(cur, iface, dest);
 	}
 
-	if (iface->NAT64PrefixList) {
-		cur = add_ra_options_nat64prefix(cur, iface->NAT64PrefixList);
-	}
+	// Return the root of the list
+	return sbl;
+}
 
-	if (iface->AdvRouteList) {
-		cur = add_ra_options_route(cur, iface, iface->AdvRouteList, iface->state_info.cease_adv, dest);
+static struct ra_option_desc const *find_option_desc(int type)
+{
+	for (size_t i = 0; i < sizeof(ra_option_descs) / sizeof(ra_option_descs[0]); ++i) {
+		if (ra_option_descs[i].type == type)
+			return &ra_option_descs[i];
 	}
+	return NULL;
+}
 
-	if (iface->AdvRDNSSList) {
-		cur = add_ra_options_rdnss(cur, iface, iface->AdvRDNSSList, iface->state_info.cease_adv, dest);
-	}
+static int has_prefixes(struct Interface const *iface) { return iface->AdvPrefixList != NULL; }
 
-	if (iface->AdvDNSSLList) {
-		cur = add_ra_options_dnssl(cur, iface, iface->AdvDNSSLList, iface->state_info.cease_adv, dest);
-	}
+static int has_nat64prefixes(struct Interface const *iface) { return iface->NAT64PrefixList != NULL; }
 
-	if (iface->AdvLinkMTU != 0 && schedule_option_mtu(dest, iface)) {
-		cur->next = new_safe_buffer_list();
-		cur = cur->next;
-		add_ra_option_mtu(cur->sb, iface->AdvLinkMTU);
-	}
+static int has_routes(struct Interface const *iface) { return iface->AdvRouteList != NULL; }
 
-	if (iface->AdvSourceLLAddress && iface->sllao.if_hwaddr_len > 0 && schedule_option_sllao(dest, iface)) {
-		cur->next = new_safe_buffer_list();
-		cur = cur->next;
-		add_ra_option_sllao(cur->sb, &iface->sllao);
-	}
+static int has_rdnss(struct Interface const *iface) { return iface->AdvRDNSSList != NULL; }
 
-	if (iface->mipv6.AdvIntervalOpt && schedule_option_mipv6_rtr_adv_interval(dest, iface)) {
-		cur->next = new_safe_buffer_list();
-		cur = cur->next;
-		add_ra_option_mipv6_rtr_adv_interval(cur->sb, iface->MaxRtrAdvInterval);
-	}
+static int has_dnssl(struct Interface const *iface) { return iface->AdvDNSSLList != NULL; }
 
-	if (iface->mipv6.AdvHomeAgentInfo && schedule_option_mipv6_home_agent_info(dest, iface) &&
-	    (iface->mipv6.AdvMobRtrSupportFlag || iface->mipv6.HomeAgentPreference != 0 ||
-	     iface->mipv6.HomeAgentLifetime != iface->ra_header_info.AdvDefaultLifetime)) {
-		cur->next = new_safe_buffer_list();
-		cur = cur->next;
-		add_ra_option_mipv6_home_agent_info(cur->sb, &iface->mipv6);
-	}
+static int has_mtu(struct Interface const *iface) { return iface->AdvLinkMTU != 0; }
 
-	if (iface->AdvLowpanCoList && schedule_option_lowpanco(dest, iface)) {
-		cur->next = new_safe_buffer_list();
-		cur = cur->next;
-		add_ra_option_lowpanco(cur->sb, iface->AdvLowpanCoList);
-	}
+static int has_sllao(struct Interface const *iface) { return iface->AdvSourceLLAddress && iface->sllao.if_hwaddr_len > 0; }
 
-	if (iface->AdvAbroList && schedule_option_abro(dest, iface)) {
-		cur->next = new_safe_buffer_list();
-		cur = cur->next;
-		add_ra_option_abro(cur->sb, iface->AdvAbroList);
-	}
+static int has_mipv6_rtr_adv_interval(struct Interface const *iface) { return iface->mipv6.AdvIntervalOpt; }
 
-	if (iface->AdvCaptivePortalAPI != NULL && schedule_option_capport(dest, iface)) {
-		cur->next = new_safe_buffer_list();
-		cur = cur->next;
-		add_ra_option_capport(cur->sb, iface->AdvCaptivePortalAPI);
-	}
+static int has_mipv6_home_agent_info(struct Interface const *iface)
+{
+	return iface->mipv6.AdvHomeAgentInfo &&
+	       (iface->mipv6.AdvMobRtrSupportFlag || iface->mipv6.HomeAgentPreference != 0 ||
+		iface->mipv6.HomeAgentLifetime != iface->ra_header_info.AdvDefaultLifetime);
+}
 
-	// Return the root of the list
+static int has_lowpanco(struct Interface const *iface) { return iface->AdvLowpanCoList != NULL; }
+
+static int has_abro(struct Interface const *iface) { return iface->AdvAbroList != NULL; }
+
+static int has_capport(struct Interface const *iface) { return iface->AdvCaptivePortalAPI != NULL; }
+
+static struct safe_buffer_list *encode_prefixes(struct safe_buffer_list *sbl, struct Interface const *iface,
+						struct in6_addr const *dest)
+{
+	return add_ra_options_prefix(sbl, iface, iface->props.name, iface->AdvPrefixList, iface->state_info.cease_adv, dest);
+}
+
+static struct safe_buffer_list *encode_nat64prefixes(struct safe_buffer_list *sbl, struct Interface const *iface,
+						     struct in6_addr const *dest)
+{
+	return add_ra_options_nat64prefix(sbl, iface->NAT64PrefixList);
+}
+
+static struct safe_buffer_list *encode_routes(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest)
+{
+	return add_ra_options_route(sbl, iface, iface->AdvRouteList, iface->state_info.cease_adv, dest);
+}
+
+static struct safe_buffer_list *encode_rdnss(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest)
+{
+	return add_ra_options_rdnss(sbl, iface, iface->AdvRDNSSList, iface->state_info.cease_adv, dest);
+}
+
+static struct safe_buffer_list *encode_dnssl(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest)
+{
+	return add_ra_options_dnssl(sbl, iface, iface->AdvDNSSLList, iface->state_info.cease_adv, dest);
+}
+
+static struct safe_buffer_list *encode_mtu(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest)
+{
+	sbl = safe_buffer_list_append(sbl);
+	add_ra_option_mtu(sbl->sb, iface->AdvLinkMTU);
+	record_option(sbl->sb, ND_OPT_MTU, &iface->AdvLinkMTU);
+	return sbl;
+}
+
+static struct safe_buffer_list *encode_sllao(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest)
+{
+	sbl = safe_buffer_list_append(sbl);
+	add_ra_option_sllao(sbl->sb, &iface->sllao);
+	record_option(sbl->sb, ND_OPT_SOURCE_LINKADDR, &iface->sllao);
+	return sbl;
+}
+
+static struct safe_buffer_list *encode_mipv6_rtr_adv_interval(struct safe_buffer_list *sbl, struct Interface const *iface,
+							      struct in6_addr const *dest)
+{
+	sbl = safe_buffer_list_append(sbl);
+	add_ra_option_mipv6_rtr_adv_interval(sbl->sb, iface->MaxRtrAdvInterval);
+	record_option(sbl->sb, ND_OPT_RTR_ADV_INTERVAL, &iface->MaxRtrAdvInterval);
+	return sbl;
+}
+
+static struct safe_buffer_list *encode_mipv6_home_agent_info(struct safe_buffer_list *sbl, struct Interface const *iface,
+							     struct in6_addr const *dest)
+{
+	sbl = safe_buffer_list_append(sbl);
+	add_ra_option_mipv6_home_agent_info(sbl->sb, &iface->mipv6);
+	record_option(sbl->sb, ND_OPT_HOME_AGENT_INFO, &iface->mipv6);
+	return sbl;
+}
+
+static struct safe_buffer_list *encode_lowpanco(struct safe_buffer_list *sbl, struct Interface const *iface,
+						struct in6_addr const *dest)
+{
+	sbl = safe_buffer_list_append(sbl);
+	add_ra_option_lowpanco(sbl->sb, iface->AdvLowpanCoList);
+	record_option(sbl->sb, ND_OPT_6CO, iface->AdvLowpanCoList);
+	return sbl;
+}
+
+static struct safe_buffer_list *encode_abro(struct safe_buffer_list *sbl, struct Interface const *iface, struct in6_addr const *dest)
+{
+	sbl = safe_buffer_list_append(sbl);
+	add_ra_option_abro(sbl->sb, iface->AdvAbroList);
+	record_option(sbl->sb, ND_OPT_ABRO, iface->AdvAbroList);
+	return sbl;
+}
+
+static struct safe_buffer_list *encode_capport(struct safe_buffer_list *sbl, struct Interface const *iface,
+					       struct in6_addr const *dest)
+{
+	sbl = safe_buffer_list_append(sbl);
+	add_ra_option_capport(sbl->sb, iface->AdvCaptivePortalAPI);
+	record_option(sbl->sb, ND_OPT_CAPTIVE_PORTAL, iface->AdvCaptivePortalAPI);
 	return sbl;
 }
 
@@ -919,114 +1184,343 @@ static int send_ra(int sock, struct Interface *iface, struct in6_addr const *des
 	if (dest == NULL) {
 		static uint8_t const all_hosts_addr[] = {0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
 		dest = (struct in6_addr const *)all_hosts_addr;
-		clock_gettime(CLOCK_MONOTONIC, &iface->times.last_multicast);
+		clock_now(&iface->times.last_multicast);
 	}
 
-	update_iface_times(iface);
+	refresh_ra_cache(iface);
+	return send_cached_ra(sock, iface, dest);
+}
 
-	char dest_text[INET6_ADDRSTRLEN] = {""};
-	char src_text[INET6_ADDRSTRLEN] = {""};
-	addrtostr(dest, dest_text, INET6_ADDRSTRLEN);
-	addrtostr(iface->props.if_addr_rasrc, src_text, INET6_ADDRSTRLEN);
+/* Bring the cached RAs of iface up to date for the RAs sent now, building them if need be. */
+static void refresh_ra_cache(struct Interface *iface)
+{
+	int lifetimes_changed = update_iface_times(iface);
 
-	// Build RA header
-	struct safe_buffer *ra_hdr = new_safe_buffer();
 	// if forwarding is disabled, send zero router lifetime
 	// the check_ip6 function is hoisted here to enable testing of add_ra_header
 	int cease_adv = iface->state_info.cease_adv || check_ip6_forwarding();
-	add_ra_header(ra_hdr, &iface->ra_header_info, cease_adv);
-	// Build RA option list
-	struct safe_buffer_list *ra_opts = build_ra_options(iface, dest);
-
-	// Send out one or more RAs, all in the form of (hdr+options),
-	// such that none of the RAs exceed the link MTU
-	// (max size is pre-computed in iface->props.max_ra_option_size)
-
-	struct safe_buffer_list *cur = ra_opts;
-	struct safe_buffer *sb = new_safe_buffer();
-	do {
-		unsigned long int option_count = 0;
-		sb->used = 0;
-		// Duplicate the RA header
-		safe_buffer_append(sb, ra_hdr->buffer, ra_hdr->used);
-		// Copy in as many RA options as we can fit.
-		while (NULL != cur) {
-			if (sb->used == 0) {
-				dlog(LOG_DEBUG, 5, "send_ra: Saw empty buffer!");
-				cur = cur->next;
-				continue;
-			}
-			// Not enough room for the next option in our buffer, just send the buffer now.
-			if (sb->used + cur->sb->used > iface->props.max_ra_option_size) {
-				// But make sure we send at least one option in each RA
-				// TODO: a future improvement would be to optimize packing of
-				// the options in the minimal number of RAs, such that each one
-				// does not exceed the MTU where possible.
-				if (option_count > 0)
-					break;
-			}
-			// It's possible that a single option is larger than the MTU, so
-			// fragmentation will always happen in that case.
-			// One known case is a very long DNSSL, which is documented in
-			// RFC6106 errata #4864
-			// In this case, the RA will contain a single option, consisting of
-			// ONLY the DNSSL, without other options. RFC6980-conforming nodes
-			// should then ignore the DNSSL.
-			if (cur->sb->used > iface->props.max_ra_option_size) {
-				flog(LOG_WARNING,
-				     "send_ra: RA option (type=%hhd) length %lu exceeds max RA option size %u, fragmenting anyway (violates RFC6980 section 2)",
-				     (unsigned char)(cur->sb->buffer[0]), cur->sb->used, iface->props.max_ra_option_size);
-			}
-			// Add this option to the buffer.
-			safe_buffer_append(sb, cur->sb->buffer, cur->sb->used);
-			option_count++;
-			/*
-			if(cur->sb->used > 0 && (unsigned char)(cur->sb->buffer[0]) == ND_OPT_DNSSL_INFORMATION) {
-				abort();
-			}
-			*/
-			cur = cur->next;
-		}
+	if (iface->ra_cache.ras && iface->ra_cache.dynamic)
+		invalidate_ra_cache(iface);
 
-		// RA built, now send it.
-		dlog(LOG_DEBUG, 5, "sending RA to %s on %s (%s), %lu options (using %zd/%u bytes)", dest_text, iface->props.name,
-		     src_text, option_count, sb->used, iface->props.max_ra_option_size);
-		int err = really_send(sock, dest, &iface->props, sb);
+	if (iface->ra_cache.ras && (lifetimes_changed || iface->ra_cache.cease_adv != cease_adv) &&
+	    patch_ra_cache(iface, cease_adv) < 0)
+		invalidate_ra_cache(iface);
+
+	if (!iface->ra_cache.ras)
+		assemble_ras(iface, NULL, cease_adv, &iface->ra_cache);
+}
+
+/* Send the cached RAs of iface, as refresh_ra_cache left them, to dest. */
+static int send_cached_ra(int sock, struct Interface *iface, struct in6_addr const *dest)
+{
+	char dest_text[INET6_ADDRSTRLEN] = {""};
+	char src_text[INET6_ADDRSTRLEN] = {""};
+	if (get_debuglevel() >= 5) {
+		addrtostr(dest, dest_text, INET6_ADDRSTRLEN);
+		addrtostr(iface->props.if_addr_rasrc, src_text, INET6_ADDRSTRLEN);
+	}
+
+	struct ra_iov *ras = iface->ra_cache.ras;
+	size_t ra_count = iface->ra_cache.ra_count;
+	if (iface->AdvOptionScheduling)
+		ra_count = schedule_ras(iface, dest, &ras);
+
+	for (size_t i = 0; i < ra_count; ++i) {
+		struct ra_iov *ra = &ras[i];
+		dlog(LOG_DEBUG, 5, "sending RA to %s on %s (%s), using %zu/%u bytes", dest_text, iface->props.name, src_text,
+		     ra->len, iface->props.max_ra_option_size);
+		int err = really_send(sock, dest, iface, ra->iov, ra->iovlen);
 		if (err < 0) {
-			if (!iface->IgnoreIfMissing || !(errno == EINVAL || errno == ENODEV))
-				flog(LOG_WARNING, "sendmsg: %s", strerror(errno));
-			else
-				dlog(LOG_DEBUG, 3, "sendmsg: %s", strerror(errno));
-			safe_buffer_free(sb);
-			safe_buffer_list_free(ra_opts);
-			safe_buffer_free(ra_hdr);
+			log_send_error(iface->IgnoreIfMissing, iface->props.name);
 			return -1;
 		}
+	}
 
-	} while (NULL != cur);
+	return 0;
+}
+
+/*
+ * Build the RA header and options of iface and pack them into as few RAs
+ * as plan_ras can, all in the form of (hdr+options), such that none of the
+ * RAs exceed the link MTU (max size is pre-computed in
+ * iface->props.max_ra_option_size).  All of the options are built, the
+ * scheduling of the options leaves some out of each send when it's on.
+ */
+static void assemble_ras(struct Interface const *iface, struct in6_addr const *dest, int cease_adv, struct ra_cache *cache)
+{
+	ra_options_dynamic = 0;
+	built_option_count = 0;
 
-	safe_buffer_free(sb);
-	safe_buffer_list_free(ra_opts);
-	safe_buffer_free(ra_hdr);
+	/* Everything, down to the options the RAs are assembled from, is in the arena of the cache. */
+	struct safe_buffer_arena *arena = &cache->arena;
+
+	// Build RA header
+	struct safe_buffer *ra_hdr = new_arena_safe_buffer(arena);
+	add_ra_header(ra_hdr, &iface->ra_header_info, cease_adv);
+	// Build RA options, recorded in built_options as they are
+	build_ra_options(iface, dest, arena);
+
+	struct ra_option *options = safe_buffer_arena_alloc(arena, (built_option_count + 1) * sizeof(struct ra_option));
+	memcpy(options, built_options, built_option_count * sizeof(struct ra_option));
+
+	for (size_t i = 0; i < built_option_count; ++i) {
+		struct safe_buffer const *sb = options[i].option;
+		// It's possible that a single option is larger than the MTU, so
+		// fragmentation will always happen in that case.
+		// One known case is a very long DNSSL, which is documented in
+		// RFC6106 errata #4864
+		// In this case, the RA will contain a single option, consisting of
+		// ONLY the DNSSL, without other options. RFC6980-conforming nodes
+		// should then ignore the DNSSL.
+		if (sb->used > iface->props.max_ra_option_size) {
+			flog(LOG_WARNING,
+			     "send_ra: RA option (type=%hhd) length %lu exceeds max RA option size %u, fragmenting anyway (violates RFC6980 section 2)",
+			     (unsigned char)(sb->buffer[0]), sb->used, iface->props.max_ra_option_size);
+		}
+	}
+
+	struct iovec hdr = {ra_hdr->buffer, ra_hdr->used};
+	cache->ra_count = pack_ras(iface, &hdr, options, built_option_count, NULL, arena, &cache->ras);
+	cache->options = options;
+	cache->option_count = built_option_count;
+	cache->cease_adv = cease_adv;
+	cache->dynamic = ra_options_dynamic;
+	++cache->generation;
+}
+
+/*
+ * Pack the options marked in due, or all of them if it's NULL, into RAs.
+ * The RAs are not copied together, each is a range of iovecs from arena
+ * pointing at hdr, which they share, and at the options it is made of, in
+ * the order they were built.  Returns them in ras, and how many there are.
+ */
+static size_t pack_ras(struct Interface const *iface, struct iovec const *hdr, struct ra_option const *options, size_t count,
+		       unsigned char const *due, struct safe_buffer_arena *arena, struct ra_iov **ras)
+{
+	struct safe_buffer **packed = safe_buffer_arena_alloc(arena, (count + 1) * sizeof(struct safe_buffer *));
+	size_t *sizes = safe_buffer_arena_alloc(arena, (count + 1) * sizeof(size_t));
+	size_t *ra_of = safe_buffer_arena_alloc(arena, (count + 1) * sizeof(size_t));
+
+	size_t option_count = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (due && !due[i])
+			continue;
+		packed[option_count] = options[i].option;
+		sizes[option_count++] = options[i].option->used;
+	}
+
+	size_t room = iface->props.max_ra_option_size > hdr->iov_len ? iface->props.max_ra_option_size - hdr->iov_len : 0;
+	size_t ra_count = plan_ras(sizes, option_count, room, ra_of, arena);
+	if (ra_count == 0) {
+		/* No options, the RA is the header alone. */
+		ra_count = 1;
+	}
+
+	struct ra_iov *ra = safe_buffer_arena_alloc(arena, ra_count * sizeof(struct ra_iov));
+	struct iovec *iov = safe_buffer_arena_alloc(arena, (ra_count + option_count) * sizeof(struct iovec));
+
+	/* Lay the RAs out one after the other in iov, each starting with the header... */
+	for (size_t i = 0; i < ra_count; ++i) {
+		ra[i].iovlen = 1;
+	}
+	for (size_t i = 0; i < option_count; ++i) {
+		++ra[ra_of[i]].iovlen;
+	}
+	for (size_t i = 0; i < ra_count; ++i) {
+		ra[i].iov = iov;
+		iov += ra[i].iovlen;
+		ra[i].iov[0] = *hdr;
+		ra[i].iovlen = 1;
+		ra[i].len = hdr->iov_len;
+	}
+	/* ...then point each at the options planned for it. */
+	for (size_t i = 0; i < option_count; ++i) {
+		struct ra_iov *r = &ra[ra_of[i]];
+		r->iov[r->iovlen].iov_base = packed[i]->buffer;
+		r->iov[r->iovlen++].iov_len = packed[i]->used;
+		r->len += packed[i]->used;
+	}
+
+	for (size_t i = 0; i < ra_count; ++i) {
+		dlog(LOG_DEBUG, 5, "built RA for %s, %d options (using %zu/%u bytes)", iface->props.name, ra[i].iovlen - 1,
+		     ra[i].len, iface->props.max_ra_option_size);
+	}
+
+	*ras = ra;
+	return ra_count;
+}
+
+struct plan_item {
+	size_t size;
+	size_t index;
+};
+
+/* Larger options first, those of a size in the order they were built. */
+static int cmp_plan_items(void const *a, void const *b)
+{
+	struct plan_item const *item_a = a;
+	struct plan_item const *item_b = b;
+
+	if (item_a->size != item_b->size)
+		return item_a->size > item_b->size ? -1 : 1;
+	return item_a->index < item_b->index ? -1 : item_a->index > item_b->index;
+}
+
+/*
+ * Plan the packing of count options of the given sizes into RAs with room
+ * bytes for options each.  Sets the RA of each option in ra_of, the RAs
+ * numbered from 0, and returns how many RAs there are.  An option larger
+ * than room is sent in an RA of its own.
+ *
+ * The options are packed first-fit decreasing: from the largest down,
+ * each goes into the first RA it fits in, or opens a new one.  That is
+ * close to the fewest RAs, but not always better than packing them in the
+ * order they were built, so the plan in that order is kept when it's as
+ * good.  The scratch space is from arena.
+ */
+static size_t plan_ras(size_t const *sizes, size_t count, size_t room, size_t *ra_of, struct safe_buffer_arena *arena)
+{
+	/* In order, an RA is sent as soon as the next option doesn't fit. */
+	size_t in_order_count = 0;
+	size_t left = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (in_order_count == 0 || sizes[i] > left) {
+			++in_order_count;
+			left = room;
+		}
+		left = sizes[i] > left ? 0 : left - sizes[i];
+		ra_of[i] = in_order_count - 1;
+	}
+
+	/* Nothing to gain from another plan when it all fits in one RA. */
+	if (in_order_count <= 1)
+		return in_order_count;
+
+	struct plan_item *items = safe_buffer_arena_alloc(arena, (count + 1) * sizeof(struct plan_item));
+	size_t *ra_left = safe_buffer_arena_alloc(arena, (count + 1) * sizeof(size_t));
+	size_t *ffd_ra_of = safe_buffer_arena_alloc(arena, (count + 1) * sizeof(size_t));
+
+	for (size_t i = 0; i < count; ++i) {
+		items[i].size = sizes[i];
+		items[i].index = i;
+	}
+	qsort(items, count, sizeof(struct plan_item), cmp_plan_items);
+
+	size_t ffd_count = 0;
+	for (size_t i = 0; i < count && ffd_count < in_order_count; ++i) {
+		size_t size = items[i].size;
+		size_t ra = 0;
+		while (ra < ffd_count && ra_left[ra] < size)
+			++ra;
+		if (ra == ffd_count)
+			ra_left[ffd_count++] = size > room ? 0 : room;
+		if (size <= ra_left[ra])
+			ra_left[ra] -= size;
+		ffd_ra_of[items[i].index] = ra;
+	}
+
+	if (ffd_count >= in_order_count)
+		return in_order_count;
+
+	memcpy(ra_of, ffd_ra_of, count * sizeof(size_t));
+	return ffd_count;
+}
+
+/* Note that option, just built, is of type and taken from source. */
+static void record_option(struct safe_buffer *option, int type, void const *source)
+{
+	if (built_option_count == built_option_size) {
+		built_option_size = built_option_size ? 2 * built_option_size : 16;
+		built_options = realloc(built_options, built_option_size * sizeof(*built_options));
+		if (!built_options) {
+			flog(LOG_ERR, "unable to grow the RA option table to %zu options", built_option_size);
+			exit(1);
+		}
+	}
+
+	struct ra_option *built = &built_options[built_option_count++];
+	built->option = option;
+	built->type = type;
+	built->source = source;
+}
+
+/*
+ * Rewrite the lifetimes in the cached RAs of iface from their sources,
+ * and the router lifetime in their headers for cease_adv.  Returns -1 if
+ * the RAs can't be patched, when an option they hold must now be left out.
+ */
+static int patch_ra_cache(struct Interface *iface, int cease_adv)
+{
+	struct ra_cache *cache = &iface->ra_cache;
+	send_batch_release(iface);
+
+	for (size_t i = 0; i < cache->option_count; ++i) {
+		struct ra_option const *patch = &cache->options[i];
+		unsigned char *option = patch->option->buffer;
+
+		if (patch->type == ND_OPT_PREFIX_INFORMATION) {
+			struct AdvPrefix const *prefix = patch->source;
+			/* add_ra_options_prefix leaves out the prefixes past their preferred lifetime */
+			if (prefix->DecrementLifetimesFlag && prefix->curr_preferredlft == 0)
+				return -1;
+
+			uint32_t validlft, preferredlft;
+			prefix_lifetimes(prefix, iface->state_info.cease_adv, &validlft, &preferredlft);
+			validlft = htonl(validlft);
+			preferredlft = htonl(preferredlft);
+			memcpy(option + offsetof(struct nd_opt_prefix_info, nd_opt_pi_valid_time), &validlft, sizeof(validlft));
+			memcpy(option + offsetof(struct nd_opt_prefix_info, nd_opt_pi_preferred_time), &preferredlft,
+			       sizeof(preferredlft));
+		} else if (patch->type == ND_OPT_PREF64) {
+			struct NAT64Prefix const *prefix = patch->source;
+			uint16_t lifetime_preflen;
+			memcpy(&lifetime_preflen, option + offsetof(struct nd_opt_nat64prefix_info, nd_opt_pi_lifetime_preflen),
+			       sizeof(lifetime_preflen));
+			lifetime_preflen = htons(nat64_lifetime_preflen(prefix->curr_validlft, ntohs(lifetime_preflen) & 0x7));
+			memcpy(option + offsetof(struct nd_opt_nat64prefix_info, nd_opt_pi_lifetime_preflen), &lifetime_preflen,
+			       sizeof(lifetime_preflen));
+		}
+	}
+
+	/* Every RA starts with the same header, the router lifetime needs no recorded offset. */
+	uint16_t router_lifetime = cease_adv ? 0 : htons(iface->ra_header_info.AdvDefaultLifetime);
+	memcpy((unsigned char *)cache->ras[0].iov[0].iov_base + offsetof(struct nd_router_advert, nd_ra_router_lifetime),
+	       &router_lifetime, sizeof(router_lifetime));
+	cache->cease_adv = cease_adv;
 
 	return 0;
 }
 
-static int really_send(int sock, struct in6_addr const *dest, struct properties const *props, struct safe_buffer const *sb)
+/* Drop the RAs cached for iface, they are assembled again on the next send, in the same memory. */
+void invalidate_ra_cache(struct Interface *iface)
 {
-	struct sockaddr_in6 addr;
-	memset((void *)&addr, 0, sizeof(addr));
-	addr.sin6_family = AF_INET6;
-	addr.sin6_port = htons(IPPROTO_ICMPV6);
-	memcpy(&addr.sin6_addr, dest, sizeof(struct in6_addr));
+	send_batch_release(iface);
+	iface->ra_cache.ras = NULL;
+	iface->ra_cache.ra_count = 0;
+	iface->ra_cache.options = NULL;
+	iface->ra_cache.option_count = 0;
+	safe_buffer_arena_reset(&iface->ra_cache.arena);
+	safe_buffer_arena_reset(&iface->ra_cache.partial);
+}
 
-	struct iovec iov;
-	iov.iov_len = sb->used;
-	iov.iov_base = (caddr_t)sb->buffer;
+void free_ra_cache(struct Interface *iface)
+{
+	invalidate_ra_cache(iface);
+	safe_buffer_arena_free(&iface->ra_cache.arena);
+	safe_buffer_arena_free(&iface->ra_cache.partial);
+}
 
-	char __attribute__((aligned(8))) chdr[CMSG_SPACE(sizeof(struct in6_pktinfo))];
-	memset(chdr, 0, sizeof(chdr));
-	struct cmsghdr *cmsg = (struct cmsghdr *)chdr;
+static void prepare_msghdr(struct send_batch_entry *entry, struct in6_addr const *dest, struct properties const *props,
+			   struct iovec *iov, int iovlen)
+{
+	struct sockaddr_in6 *addr = &entry->addr;
+	memset((void *)addr, 0, sizeof(*addr));
+	addr->sin6_family = AF_INET6;
+	addr->sin6_port = htons(IPPROTO_ICMPV6);
+	memcpy(&addr->sin6_addr, dest, sizeof(struct in6_addr));
+
+	memset(entry->chdr, 0, sizeof(entry->chdr));
+	struct cmsghdr *cmsg = (struct cmsghdr *)entry->chdr;
 
 	cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
 	cmsg->cmsg_level = IPPROTO_IPV6;
@@ -1037,89 +1531,368 @@ static int really_send(int sock, struct in6_addr const *dest, struct properties
 	memcpy(&pkt_info->ipi6_addr, props->if_addr_rasrc, sizeof(struct in6_addr));
 
 #ifdef HAVE_SIN6_SCOPE_ID
-	if (IN6_IS_ADDR_LINKLOCAL(&addr.sin6_addr) || IN6_IS_ADDR_MC_LINKLOCAL(&addr.sin6_addr))
-		addr.sin6_scope_id = props->if_index;
+	if (IN6_IS_ADDR_LINKLOCAL(&addr->sin6_addr) || IN6_IS_ADDR_MC_LINKLOCAL(&addr->sin6_addr))
+		addr->sin6_scope_id = props->if_index;
 #endif
 
-	struct msghdr mhdr;
-	memset(&mhdr, 0, sizeof(mhdr));
-	mhdr.msg_name = (caddr_t)&addr;
-	mhdr.msg_namelen = sizeof(struct sockaddr_in6);
-	mhdr.msg_iov = &iov;
-	mhdr.msg_iovlen = 1;
-	mhdr.msg_control = (void *)cmsg;
-	mhdr.msg_controllen = sizeof(chdr);
+	struct msghdr *mhdr = &entry->mhdr;
+	memset(mhdr, 0, sizeof(*mhdr));
+	mhdr->msg_name = (caddr_t)addr;
+	mhdr->msg_namelen = sizeof(struct sockaddr_in6);
+	mhdr->msg_iov = iov;
+	mhdr->msg_iovlen = iovlen;
+	mhdr->msg_control = (void *)cmsg;
+	mhdr->msg_controllen = sizeof(entry->chdr);
+}
+
+static void log_send_error(int IgnoreIfMissing, char const *if_name)
+{
+	++stats.tx_errors;
+
+	if (!IgnoreIfMissing || !(errno == EINVAL || errno == ENODEV))
+		flog(LOG_WARNING, "sendmsg on %s: %s", if_name, strerror(errno));
+	else
+		dlog(LOG_DEBUG, 3, "sendmsg on %s: %s", if_name, strerror(errno));
+}
+
+static int really_send(int sock, struct in6_addr const *dest, struct Interface const *iface, struct iovec *iov, int iovlen)
+{
+	if (send_batch_depth > 0) {
+		if (send_batch_len == SEND_BATCH_MAX || (send_batch_len > 0 && send_batch_sock != sock))
+			send_batch_flush();
+
+		struct send_batch_entry *entry = &send_batch[send_batch_len++];
+		send_batch_sock = sock;
+		prepare_msghdr(entry, dest, &iface->props, iov, iovlen);
+		entry->iface = iface;
+		entry->IgnoreIfMissing = iface->IgnoreIfMissing;
+		strlcpy(entry->if_name, iface->props.name, sizeof(entry->if_name));
+		return 0;
+	}
+
+	struct send_batch_entry entry;
+	prepare_msghdr(&entry, dest, &iface->props, iov, iovlen);
 
-	return sendmsg(sock, &mhdr, 0);
+	int rc = send_transport ? send_transport(sock, &entry.mhdr, 0) : sendmsg(sock, &entry.mhdr, 0);
+	++stats.tx_syscalls;
+	if (rc >= 0)
+		count_sent(1);
+
+	return rc;
 }
 
-static int schedule_option_prefix(struct in6_addr const *dest, struct Interface const *iface, struct AdvPrefix const *prefix)
+/* Account for count RAs just sent, and for the rate they are sent at. */
+static void count_sent(int count)
 {
-	return schedule_helper(dest, iface, prefix->curr_preferredlft);
+	static time_t second = 0;
+	static uint64_t sent_in_second = 0;
+
+	struct timespec now;
+	clock_now(&now);
+	if (now.tv_sec != second) {
+		second = now.tv_sec;
+		sent_in_second = 0;
+	}
+
+	sent_in_second += count;
+	if (sent_in_second > stats.tx_peak_rate)
+		stats.tx_peak_rate = sent_in_second;
+
+	stats.tx_packets += count;
 }
 
-static int schedule_option_route(struct in6_addr const *dest, struct Interface const *iface, struct AdvRoute const *route)
+/* Sends the queued RAs, reporting a failure for each entry that could not be sent. */
+static void send_batch_flush(void)
 {
-	return schedule_helper(dest, iface, route->AdvRouteLifetime);
+#ifdef HAVE_SENDMMSG
+	static struct mmsghdr mmsgs[SEND_BATCH_MAX];
+	for (int i = 0; i < send_batch_len; ++i) {
+		mmsgs[i].msg_hdr = send_batch[i].mhdr;
+		mmsgs[i].msg_len = 0;
+	}
+#endif
+
+	int i = 0;
+	while (i < send_batch_len) {
+		int rc;
+		if (send_transport) {
+			rc = send_transport(send_batch_sock, &send_batch[i].mhdr, 0) < 0 ? -1 : 1;
+		} else {
+#ifdef HAVE_SENDMMSG
+			rc = sendmmsg(send_batch_sock, &mmsgs[i], send_batch_len - i, 0);
+#else
+			rc = sendmsg(send_batch_sock, &send_batch[i].mhdr, 0) < 0 ? -1 : 1;
+#endif
+		}
+		++stats.tx_syscalls;
+
+		if (rc < 0) {
+			/* The entry at i failed, carry on with the ones after it. */
+			log_send_error(send_batch[i].IgnoreIfMissing, send_batch[i].if_name);
+			++i;
+			continue;
+		}
+
+		count_sent(rc);
+		i += rc;
+	}
+
+	dlog(LOG_DEBUG, 5, "flushed %d RA(s)", send_batch_len);
+	send_batch_len = 0;
 }
 
-static int schedule_option_rdnss(struct in6_addr const *dest, struct Interface const *iface, struct AdvRDNSS const *rdnss)
+/* Whether some of the queued RAs point into the RA cache of iface. */
+static int send_batch_holds(struct Interface const *iface)
 {
-	return schedule_helper(dest, iface, rdnss->AdvRDNSSLifetime);
+	for (int i = 0; i < send_batch_len; ++i) {
+		if (send_batch[i].iface == iface)
+			return 1;
+	}
+	return 0;
 }
 
-static int schedule_option_dnssl(struct in6_addr const *dest, struct Interface const *iface, struct AdvDNSSL const *dnssl)
+/* Send the queued RAs now if some of them point into the RA cache of iface, which is about to change. */
+static void send_batch_release(struct Interface const *iface)
 {
-	return schedule_helper(dest, iface, dnssl->AdvDNSSLLifetime);
+	if (send_batch_holds(iface))
+		send_batch_flush();
 }
 
-static int schedule_option_mtu(struct in6_addr const *dest, struct Interface const *iface)
+void set_send_transport(ssize_t (*transport)(int sock, struct msghdr const *mhdr, int flags)) { send_transport = transport; }
+
+/*
+ * Queue the RAs sent until the matching send_batch_end, so they can go out
+ * together.  Batches nest; only the outermost one sends.
+ */
+void send_batch_begin(void) { ++send_batch_depth; }
+
+void send_batch_end(void)
 {
-	return schedule_helper(dest, iface, iface->ra_header_info.AdvDefaultLifetime);
+	if (--send_batch_depth == 0 && send_batch_len > 0)
+		send_batch_flush();
 }
 
-static int schedule_option_sllao(struct in6_addr const *dest, struct Interface const *iface)
+/*
+ * Pick the options of the cached RAs of iface that are due for dest and
+ * pack them into RAs of their own, in ras.  Returns how many RAs there
+ * are; ras is left alone when all of the options are due.  The options
+ * picked are taken as sent, a send error only delays them until the next
+ * time they are due, well within their lifetime.
+ */
+static size_t schedule_ras(struct Interface *iface, struct in6_addr const *dest, struct ra_iov **ras)
 {
-	return schedule_helper(dest, iface, iface->ra_header_info.AdvDefaultLifetime);
+	struct ra_cache *cache = &iface->ra_cache;
+
+	/* Every host sending an RS is answered with all of the options, only the destinations of the unsolicited RAs are kept. */
+	struct dest_schedule *schedule = find_dest_schedule(iface, dest, !ra_solicited || IN6_IS_ADDR_MULTICAST(dest));
+	if (!schedule)
+		return cache->ra_count;
+	if (schedule->generation != cache->generation || schedule->option_count != cache->option_count)
+		remap_dest_schedule(schedule, cache);
+
+	// 1.
+	// Cases to schedule a complete RA blast:
+	// - Server received a RS
+	// - We're in the initial-RAs phase of startup
+	// - The (unicast) destination was first seen very recently, and probably
+	//   has NOT got a full set of RAs yet.
+	// - We're ceasing, the zeroed lifetimes must all go out
+	int blast = ra_solicited || cache->cease_adv || schedule->sends < MAX_INITIAL_RTR_ADVERTISEMENTS;
+	if (schedule->sends < MAX_INITIAL_RTR_ADVERTISEMENTS)
+		++schedule->sends;
+
+	/* The RAs queued in a batch may point into the partial RAs of the earlier sends. */
+	if (!send_batch_holds(iface))
+		safe_buffer_arena_reset(&cache->partial);
+	unsigned char *due = safe_buffer_arena_alloc(&cache->partial, cache->option_count + 1);
+
+	struct timespec now;
+	clock_now(&now);
+	size_t due_count = 0;
+	for (size_t i = 0; i < cache->option_count; ++i) {
+		due[i] = blast || schedule_option(&schedule->options[i], iface, &cache->options[i]);
+		if (due[i]) {
+			schedule->options[i].sent = 1;
+			schedule->options[i].last_sent = now;
+			++due_count;
+		}
+	}
+
+	if (due_count == cache->option_count)
+		return cache->ra_count;
+
+	dlog(LOG_DEBUG, 5, "%zu of %zu options due on %s", due_count, cache->option_count, iface->props.name);
+	return pack_ras(iface, &cache->ras[0].iov[0], cache->options, cache->option_count, due, &cache->partial, ras);
 }
 
-static int schedule_option_mipv6_rtr_adv_interval(struct in6_addr const *dest, struct Interface const *iface)
+/* The schedule of the options sent to dest on iface, created if asked to. */
+static struct dest_schedule *find_dest_schedule(struct Interface *iface, struct in6_addr const *dest, int create)
 {
-	return schedule_helper(dest, iface, iface->ra_header_info.AdvDefaultLifetime);
+	for (struct dest_schedule *schedule = iface->schedules; schedule; schedule = schedule->next) {
+		if (IN6_ARE_ADDR_EQUAL(&schedule->dest, dest))
+			return schedule;
+	}
+
+	if (!create)
+		return NULL;
+
+	struct dest_schedule *schedule = calloc(1, sizeof(struct dest_schedule));
+	if (!schedule) {
+		flog(LOG_ERR, "unable to allocate the option schedule of a destination on %s", iface->props.name);
+		return NULL;
+	}
+	schedule->dest = *dest;
+	schedule->next = iface->schedules;
+	iface->schedules = schedule;
+
+	return schedule;
 }
 
-static int schedule_option_mipv6_home_agent_info(struct in6_addr const *dest, struct Interface const *iface)
+/*
+ * Put the option schedules in the order of the options of cache, which was
+ * rebuilt since they were last used.  An option keeps its schedule if it
+ * is still there, and starts without one if it's new.
+ */
+static void remap_dest_schedule(struct dest_schedule *schedule, struct ra_cache const *cache)
 {
-	return schedule_helper(dest, iface, iface->mipv6.HomeAgentLifetime);
+	if (schedule->option_size < cache->option_count) {
+		size_t size = cache->option_count;
+		struct option_schedule *options = realloc(schedule->options, size * sizeof(struct option_schedule));
+		struct option_schedule *spare = options ? realloc(schedule->spare, size * sizeof(struct option_schedule)) : NULL;
+		if (!options || !spare) {
+			flog(LOG_ERR, "unable to grow the option schedule to %zu options", size);
+			exit(1);
+		}
+		schedule->options = options;
+		schedule->spare = spare;
+		schedule->option_size = size;
+	}
+
+	/* The options mostly keep their order, look where they were first. */
+	for (size_t i = 0; i < cache->option_count; ++i) {
+		struct option_schedule *option = &schedule->spare[i];
+		memset(option, 0, sizeof(*option));
+		option->source = cache->options[i].source;
+		option_schedule_key(&cache->options[i], &option->prefix);
+
+		for (size_t k = 0; k < schedule->option_count; ++k) {
+			struct option_schedule const *old = &schedule->options[(i + k) % schedule->option_count];
+			if (old->source == option->source && IN6_ARE_ADDR_EQUAL(&old->prefix, &option->prefix)) {
+				option->sent = old->sent;
+				option->last_sent = old->last_sent;
+				break;
+			}
+		}
+	}
+
+	struct option_schedule *options = schedule->options;
+	schedule->options = schedule->spare;
+	schedule->spare = options;
+	schedule->option_count = cache->option_count;
+	schedule->generation = cache->generation;
 }
 
-static int schedule_option_lowpanco(struct in6_addr const *dest, struct Interface const *iface)
+/* The prefix of a prefix option, which tells the auto prefixes of a source apart, zero for the others. */
+static void option_schedule_key(struct ra_option const *option, struct in6_addr *prefix)
 {
-	return schedule_helper(dest, iface, iface->AdvLowpanCoList->AdvLifeTime);
+	memset(prefix, 0, sizeof(*prefix));
+	if (option->type == ND_OPT_PREFIX_INFORMATION)
+		memcpy(prefix, option->option->buffer + offsetof(struct nd_opt_prefix_info, nd_opt_pi_prefix), sizeof(*prefix));
 }
 
-static int schedule_option_abro(struct in6_addr const *dest, struct Interface const *iface)
+void free_option_schedules(struct Interface *iface)
 {
-	return schedule_helper(dest, iface, iface->AdvAbroList->ValidLifeTime);
+	while (iface->schedules) {
+		struct dest_schedule *next = iface->schedules->next;
+		free(iface->schedules->options);
+		free(iface->schedules->spare);
+		free(iface->schedules);
+		iface->schedules = next;
+	}
 }
 
-static int schedule_option_capport(struct in6_addr const *dest, struct Interface const *iface)
+static int schedule_option(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option)
 {
-	return schedule_helper(dest, iface, iface->ra_header_info.AdvDefaultLifetime);
+	struct ra_option_desc const *desc = find_option_desc(option->type);
+	return desc ? desc->schedule(schedule, iface, option) : 1;
 }
 
-static int schedule_helper(struct in6_addr const *dest, struct Interface const *iface, int option_lifetime)
+/* The auto prefixes have their lifetimes limited to the kernel's, what counts is in the option. */
+static int schedule_option_prefix(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option)
 {
-	return 1;
-	// 1.
-	// Cases to schedule a complete RA blast:
-	// - Server received a RS
-	// - We're in the initial-RAs phase of startup
-	// - The (unicast) destination was first seen very recently, and probably
-	//   has NOT got a full set of RAs yet.
+	uint32_t preferredlft;
+	memcpy(&preferredlft, option->option->buffer + offsetof(struct nd_opt_prefix_info, nd_opt_pi_preferred_time),
+	       sizeof(preferredlft));
+	return schedule_helper(schedule, iface, ntohl(preferredlft));
+}
+
+static int schedule_option_nat64prefix(struct option_schedule const *schedule, struct Interface const *iface,
+				       struct ra_option const *option)
+{
+	struct NAT64Prefix const *prefix = option->source;
+	return schedule_helper(schedule, iface, prefix->curr_validlft);
+}
+
+static int schedule_option_route(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option)
+{
+	struct AdvRoute const *route = option->source;
+	return schedule_helper(schedule, iface, route->AdvRouteLifetime);
+}
+
+static int schedule_option_rdnss(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option)
+{
+	struct AdvRDNSS const *rdnss = option->source;
+	return schedule_helper(schedule, iface, rdnss->AdvRDNSSLifetime);
+}
+
+static int schedule_option_dnssl(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option)
+{
+	struct AdvDNSSL const *dnssl = option->source;
+	return schedule_helper(schedule, iface, dnssl->AdvDNSSLLifetime);
+}
+
+/* The options without a lifetime of their own hold as long as the router does. */
+static int schedule_option_router_lifetime(struct option_schedule const *schedule, struct Interface const *iface,
+					   struct ra_option const *option)
+{
+	return schedule_helper(schedule, iface, iface->ra_header_info.AdvDefaultLifetime);
+}
+
+static int schedule_option_mipv6_home_agent_info(struct option_schedule const *schedule, struct Interface const *iface,
+						 struct ra_option const *option)
+{
+	return schedule_helper(schedule, iface, iface->mipv6.HomeAgentLifetime);
+}
+
+static int schedule_option_lowpanco(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option)
+{
+	return schedule_helper(schedule, iface, iface->AdvLowpanCoList->AdvLifeTime);
+}
+
+static int schedule_option_abro(struct option_schedule const *schedule, struct Interface const *iface, struct ra_option const *option)
+{
+	return schedule_helper(schedule, iface, iface->AdvAbroList->ValidLifeTime);
+}
+
+/*
+ * Whether an option of option_lifetime, last sent to the destination as
+ * in schedule, is due in the RA being sent to it.  The complete blasts are
+ * up to schedule_ras.
+ */
+static int schedule_helper(struct option_schedule const *schedule, struct Interface const *iface, uint32_t option_lifetime)
+{
+	/* Never sent, or counted out, as a deprecated prefix is: until it's gone, always there. */
+	if (!schedule->sent || option_lifetime == 0)
+		return 1;
 
 	// 2.
 	// If the dest has existed for a while
 	// (unicast destination): spread RAs out to at least 1/N of the option lifetime
 	// (multicast destination): spread RAs out to at least 1/N of the option lifetime
-};
+	// The next RA may be as far as MaxRtrAdvInterval away, so the option is due
+	// in this one if waiting for the next would leave it over 1/N.
+	struct timespec now;
+	clock_now(&now);
+	double since = timespecdiff(&now, &schedule->last_sent) / 1000.0;
+	return since + iface->MaxRtrAdvInterval >= (double)option_lifetime / MIN_OPTION_REFRESHES;
+}
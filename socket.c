@@ -26,10 +26,63 @@
 #define IPV6_RECVPKTINFO IPV6_PKTINFO
 #endif
 
+/*
+ * Sockets bound to one interface each, kept by name for the life of the
+ * process: they're opened before the privileges are dropped and have to
+ * survive the config reloads.
+ */
+struct iface_socket {
+	struct iface_socket *next;
+	char name[IFNAMSIZ];
+	unsigned int if_index;
+	int sock;
+};
+
+static struct iface_socket *iface_sockets = NULL;
+
+static int prefilter = 0;
+
+#ifdef HAVE_LINUX_FILTER_H
+/*
+ * The sanity checks of process() as a classic BPF program, run by the
+ * kernel before a packet is queued to the socket, so invalid RSs and RAs
+ * never cost a copy to userspace.  The program starts at the ICMPv6
+ * header; the IPv6 header is reached through SKF_NET_OFF.
+ */
+static struct sock_filter icmpv6_prefilter[] = {
+    /* 0: type and code, only RS and RA with code 0 pass */
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ND_ROUTER_SOLICIT << 8, 2, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ND_ROUTER_ADVERT << 8, 3, 0),
+    BPF_STMT(BPF_RET | BPF_K, 0),
+    /* 4: RS, not truncated */
+    BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, sizeof(struct nd_router_solicit), 5, 8),
+    /* 6: RA, not truncated and from a link-local source */
+    BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, sizeof(struct nd_router_advert), 0, 6),
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, SKF_NET_OFF + (int)offsetof(struct ip6_hdr, ip6_src)),
+    BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xffc0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xfe80, 0, 3),
+    /* 11: hop limit 255 */
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF + (int)offsetof(struct ip6_hdr, ip6_hlim)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 255, 0, 1),
+    BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+    /* 14: drop */
+    BPF_STMT(BPF_RET | BPF_K, 0),
+};
+#endif
+
+static struct iface_socket *find_iface_socket(char const *name);
+static int attach_icmpv6_prefilter(int sock);
+
+#ifdef UNIT_TEST
+#include "test/socket.c"
+#endif
+
 int open_icmpv6_socket(void)
 {
 	int sock;
-	struct icmp6_filter filter;
 	int err;
 
 	sock = socket(AF_INET6, SOCK_RAW, IPPROTO_ICMPV6);
@@ -84,15 +137,173 @@ int open_icmpv6_socket(void)
 	 * setup ICMP filter
 	 */
 
+	if (set_icmpv6_filter(sock, 1) < 0) {
+		return -1;
+	}
+
+	if (prefilter && attach_icmpv6_prefilter(sock) < 0) {
+		return -1;
+	}
+
+	return sock;
+}
+
+/* Have the sockets opened from now on reject invalid RSs and RAs in the kernel. */
+void set_icmpv6_prefilter(int enable) { prefilter = enable; }
+
+static int attach_icmpv6_prefilter(int sock)
+{
+#ifdef HAVE_LINUX_FILTER_H
+	struct sock_fprog prog = {
+	    .len = sizeof(icmpv6_prefilter) / sizeof(icmpv6_prefilter[0]), .filter = icmpv6_prefilter,
+	};
+
+	if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+		flog(LOG_ERR, "setsockopt(SO_ATTACH_FILTER): %s", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+#else
+	flog(LOG_ERR, "the socket prefilter is not supported on this platform");
+	return -1;
+#endif
+}
+
+/* Pass RSs and RAs to the socket if pass is set, or nothing if it is only used to send. */
+int set_icmpv6_filter(int sock, int pass)
+{
+	struct icmp6_filter filter;
+
 	ICMP6_FILTER_SETBLOCKALL(&filter);
-	ICMP6_FILTER_SETPASS(ND_ROUTER_SOLICIT, &filter);
-	ICMP6_FILTER_SETPASS(ND_ROUTER_ADVERT, &filter);
+	if (pass) {
+		ICMP6_FILTER_SETPASS(ND_ROUTER_SOLICIT, &filter);
+		ICMP6_FILTER_SETPASS(ND_ROUTER_ADVERT, &filter);
+	}
 
-	err = setsockopt(sock, IPPROTO_ICMPV6, ICMP6_FILTER, &filter, sizeof(filter));
+	int err = setsockopt(sock, IPPROTO_ICMPV6, ICMP6_FILTER, &filter, sizeof(filter));
 	if (err < 0) {
 		flog(LOG_ERR, "setsockopt(ICMPV6_FILTER): %s", strerror(errno));
 		return -1;
 	}
 
+	return 0;
+}
+
+static struct iface_socket *find_iface_socket(char const *name)
+{
+	for (struct iface_socket *is = iface_sockets; is; is = is->next) {
+		if (!strcmp(is->name, name))
+			return is;
+	}
+
+	return 0;
+}
+
+/*
+ * Returns the socket bound to the named interface, opening it if there's
+ * none yet, or -1 if it can't be opened.
+ */
+int open_iface_socket(char const *name)
+{
+	struct iface_socket *is = find_iface_socket(name);
+	if (is)
+		return is->sock;
+
+#ifdef SO_BINDTODEVICE
+	unsigned int if_index = if_nametoindex(name);
+	if (!if_index) {
+		dlog(LOG_DEBUG, 3, "%s does not exist, not opening its socket", name);
+		return -1;
+	}
+
+	int sock = open_icmpv6_socket();
+	if (sock < 0)
+		return -1;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_BINDTODEVICE, name, strlen(name) + 1) < 0) {
+		flog(LOG_ERR, "setsockopt(SO_BINDTODEVICE, %s): %s", name, strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	is = malloc(sizeof(struct iface_socket));
+	if (!is) {
+		flog(LOG_ERR, "malloc failed: %s", strerror(errno));
+		close(sock);
+		return -1;
+	}
+	memset(is, 0, sizeof(struct iface_socket));
+	strlcpy(is->name, name, sizeof(is->name));
+	is->if_index = if_index;
+	is->sock = sock;
+	is->next = iface_sockets;
+	iface_sockets = is;
+
+	dlog(LOG_DEBUG, 3, "opened socket %d bound to %s", sock, name);
+
 	return sock;
+#else
+	flog(LOG_ERR, "per-interface sockets are not supported on this platform");
+	return -1;
+#endif
+}
+
+/*
+ * Check that the socket of the named interface is still bound to if_index,
+ * which changes when the interface is recreated, rebinding it if we are
+ * still allowed to.  Returns 0 if the socket is usable, -1 otherwise.
+ */
+int check_iface_socket(char const *name, unsigned int if_index)
+{
+	struct iface_socket *is = find_iface_socket(name);
+	if (!is)
+		return -1;
+
+	if (is->if_index == if_index)
+		return 0;
+
+#ifdef SO_BINDTODEVICE
+	if (setsockopt(is->sock, SOL_SOCKET, SO_BINDTODEVICE, name, strlen(name) + 1) < 0) {
+		flog(LOG_WARNING, "unable to rebind the socket of %s: %s", name, strerror(errno));
+		return -1;
+	}
+#endif
+
+	is->if_index = if_index;
+
+	return 0;
+}
+
+/* Close the socket of the named interface, which the event loop must no longer wait on. */
+void close_iface_socket(char const *name)
+{
+	for (struct iface_socket **is = &iface_sockets; *is; is = &(*is)->next) {
+		if (!strcmp((*is)->name, name)) {
+			struct iface_socket *next = (*is)->next;
+			dlog(LOG_DEBUG, 3, "closing socket %d bound to %s", (*is)->sock, name);
+			close((*is)->sock);
+			free(*is);
+			*is = next;
+			return;
+		}
+	}
+}
+
+void for_each_iface_socket(void (*foo)(int sock, void *), void *data)
+{
+	for (struct iface_socket *is = iface_sockets; is; is = is->next)
+		foo(is->sock, data);
+}
+
+void close_iface_sockets(void)
+{
+	struct iface_socket *is = iface_sockets;
+	while (is) {
+		struct iface_socket *next = is->next;
+		close(is->sock);
+		free(is);
+		is = next;
+	}
+	iface_sockets = 0;
 }
@@ -0,0 +1,337 @@
+
+#include "config.h"
+#include "defaults.h"
+#include "includes.h"
+#include "radvd.h"
+
+#include <check.h>
+#include <dlfcn.h>
+
+#ifdef HAVE_NETLINK
+#include "netlink.h"
+#include <linux/netconf.h>
+#include <linux/rtnetlink.h>
+#endif
+
+/*
+ * The steady state of radvd: its interfaces are set up and nothing changes,
+ * it receives RSs and answers them, sends the RAs of its timers and hears
+ * netlink notifications that change nothing.  None of that may allocate
+ * memory or open a socket, which malloc and socket are interposed here to
+ * count.
+ */
+
+#define STEADY_ROUNDS 100
+
+/* the RSs of a round: one received alone, and one in a batch */
+#ifdef HAVE_RECVMMSG
+#define STEADY_RSS 2
+#else
+#define STEADY_RSS 1
+#endif
+
+static int counting;
+static unsigned long allocs;
+static unsigned long sockets;
+
+#ifdef __GLIBC__
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+	allocs += counting;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	allocs += counting;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	allocs += counting;
+	return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) { __libc_free(ptr); }
+
+int socket(int domain, int type, int protocol)
+{
+	static int (*libc_socket)(int domain, int type, int protocol);
+	if (!libc_socket)
+		libc_socket = (int (*)(int, int, int))dlsym(RTLD_NEXT, "socket");
+	sockets += counting;
+	return libc_socket(domain, type, protocol);
+}
+
+/* glibc opens the sockets of these itself, out of the reach of socket above */
+char *if_indextoname(unsigned int ifindex, char *ifname)
+{
+	static char *(*libc_if_indextoname)(unsigned int ifindex, char *ifname);
+	if (!libc_if_indextoname)
+		libc_if_indextoname = (char *(*)(unsigned int, char *))dlsym(RTLD_NEXT, "if_indextoname");
+	sockets += counting;
+	return libc_if_indextoname(ifindex, ifname);
+}
+
+unsigned int if_nametoindex(char const *ifname)
+{
+	static unsigned int (*libc_if_nametoindex)(char const *ifname);
+	if (!libc_if_nametoindex)
+		libc_if_nametoindex = (unsigned int (*)(char const *))dlsym(RTLD_NEXT, "if_nametoindex");
+	sockets += counting;
+	return libc_if_nametoindex(ifname);
+}
+#endif
+
+static struct Interface steady_iface;
+static struct in6_addr steady_addr;
+static int steady_sock = -1;
+static int steady_ras;
+
+/* The RSs come over UDP on ::1, with the packet info and hop limit an ICMPv6 socket has, so the test needs no privileges. */
+static int rs_recv_sock = -1;
+static int rs_send_sock = -1;
+static struct sockaddr_in6 rs_addr;
+
+static ssize_t steady_transport(int sock, struct msghdr const *mhdr, int flags)
+{
+	ssize_t len = 0;
+	for (size_t i = 0; i < mhdr->msg_iovlen; ++i)
+		len += mhdr->msg_iov[i].iov_len;
+	++steady_ras;
+	return len;
+}
+
+static void steady_setup(void)
+{
+	steady_sock = socket(AF_INET6, SOCK_DGRAM, 0);
+	ck_assert_int_ge(steady_sock, 0);
+
+	rs_recv_sock = socket(AF_INET6, SOCK_DGRAM, 0);
+	ck_assert_int_ge(rs_recv_sock, 0);
+	rs_send_sock = socket(AF_INET6, SOCK_DGRAM, 0);
+	ck_assert_int_ge(rs_send_sock, 0);
+	int one = 1;
+	int hops = 255;
+	ck_assert_int_eq(0, setsockopt(rs_recv_sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, &one, sizeof(one)));
+	ck_assert_int_eq(0, setsockopt(rs_recv_sock, IPPROTO_IPV6, IPV6_RECVHOPLIMIT, &one, sizeof(one)));
+	ck_assert_int_eq(0, setsockopt(rs_send_sock, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &hops, sizeof(hops)));
+	memset(&rs_addr, 0, sizeof(rs_addr));
+	rs_addr.sin6_family = AF_INET6;
+	rs_addr.sin6_addr = in6addr_loopback;
+	ck_assert_int_eq(0, bind(rs_recv_sock, (struct sockaddr *)&rs_addr, sizeof(rs_addr)));
+	socklen_t len = sizeof(rs_addr);
+	ck_assert_int_eq(0, getsockname(rs_recv_sock, (struct sockaddr *)&rs_addr, &len));
+
+	struct Interface *iface = &steady_iface;
+	iface_init_defaults(iface);
+	strlcpy(iface->props.name, "lo", sizeof(iface->props.name));
+	iface->props.if_index = if_nametoindex("lo");
+	iface->props.max_ra_option_size = RFC2460_MIN_MTU;
+	iface->AdvSendAdvert = 1;
+	iface->MinRtrAdvInterval = DFLT_MinRtrAdvInterval(iface);
+	iface->ra_header_info.AdvDefaultLifetime = DFLT_AdvDefaultLifetime(iface);
+	iface->state_info.changed = 0;
+	iface->state_info.ready = 1;
+	iface->state_info.racount = MAX_INITIAL_RTR_ADVERTISEMENTS;
+
+	/* the netlink notifications are of an address lo has for real */
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "::1", &steady_addr));
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "fe80::1", &iface->props.if_addr));
+	iface->props.if_addrs = calloc(2, sizeof(struct in6_addr));
+	ck_assert_ptr_ne(0, iface->props.if_addrs);
+	iface->props.if_addrs[0] = steady_addr;
+	iface->props.addrs_count = 1;
+	iface->props.if_addr_rasrc = &iface->props.if_addr;
+
+	/*
+	 * A configured prefix, one taken from the addresses of the interface,
+	 * and a 6to4 one, which has the RAs built anew each time.
+	 */
+	static struct AdvPrefix prefixes[3];
+	for (int i = 0; i < 3; ++i) {
+		prefix_init_defaults(&prefixes[i]);
+		prefixes[i].PrefixLen = 64;
+		prefixes[i].curr_validlft = prefixes[i].AdvValidLifetime;
+		prefixes[i].curr_preferredlft = prefixes[i].AdvPreferredLifetime;
+	}
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8::", &prefixes[0].Prefix));
+	prefixes[0].next = &prefixes[1];
+	prefixes[1].next = &prefixes[2];
+	strlcpy(prefixes[2].if6to4, "lo", sizeof(prefixes[2].if6to4));
+	iface->AdvPrefixList = prefixes;
+
+	set_send_transport(steady_transport);
+	set_ip6_forwarding(1);
+
+#ifdef HAVE_NETLINK
+	/* as radvd does, so the addresses and lifetimes are looked up in the table */
+	ck_assert_int_eq(0, netlink_seed_addr_table());
+#endif
+}
+
+static void steady_teardown(void)
+{
+	set_send_transport(NULL);
+	iface_queue_remove(&steady_iface);
+	free_ra_cache(&steady_iface);
+	free(steady_iface.props.if_addrs);
+	close(steady_sock);
+	close(rs_recv_sock);
+	close(rs_send_sock);
+}
+
+static void steady_send_rs(void)
+{
+	struct nd_router_solicit rs = {.nd_rs_type = ND_ROUTER_SOLICIT};
+	ck_assert_int_eq(sizeof(rs), sendto(rs_send_sock, &rs, sizeof(rs), 0, (struct sockaddr *)&rs_addr, sizeof(rs_addr)));
+}
+
+#ifdef HAVE_RECVMMSG
+static void steady_rs_foo(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info, int hoplimit,
+			  void *data)
+{
+	process(steady_sock, &steady_iface, msg, len, addr, pkt_info, hoplimit);
+}
+#endif
+
+/* An RS received one at a time, and one in a batch where recvmmsg is, as the main loop does. */
+static void steady_rs(void)
+{
+	steady_send_rs();
+	unsigned char msg[MSG_SIZE_RECV];
+	unsigned char chdr[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
+	struct sockaddr_in6 addr;
+	struct in6_pktinfo *pkt_info = NULL;
+	int hoplimit;
+	int len = recv_rs_ra(rs_recv_sock, msg, &addr, &pkt_info, &hoplimit, chdr);
+	ck_assert_int_eq(sizeof(struct nd_router_solicit), len);
+	ck_assert_ptr_ne(0, pkt_info);
+	process(steady_sock, &steady_iface, msg, len, &addr, pkt_info, hoplimit);
+
+#ifdef HAVE_RECVMMSG
+	steady_send_rs();
+	ck_assert_int_eq(1, recv_rs_ra_batch(rs_recv_sock, RECV_BATCH_MAX, steady_rs_foo, NULL));
+#endif
+}
+
+#ifdef HAVE_NETLINK
+static int netlink_fds[2] = {-1, -1};
+
+static void steady_netlink_attr(struct nlmsghdr *nh, unsigned short type, void const *data, size_t len)
+{
+	struct rtattr *rta = (struct rtattr *)((char *)nh + NLMSG_ALIGN(nh->nlmsg_len));
+	rta->rta_type = type;
+	rta->rta_len = RTA_LENGTH(len);
+	memcpy(RTA_DATA(rta), data, len);
+	nh->nlmsg_len = NLMSG_ALIGN(nh->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+}
+
+/* Notifications of a known address, of a link not advertised on and of forwarding as it is. */
+static void steady_netlink(void)
+{
+	union {
+		struct nlmsghdr n;
+		char buf[256];
+	} msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.n.nlmsg_type = RTM_NEWADDR;
+	msg.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+	struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(&msg.n);
+	ifa->ifa_family = AF_INET6;
+	ifa->ifa_index = steady_iface.props.if_index;
+	steady_netlink_attr(&msg.n, IFA_ADDRESS, &steady_addr, sizeof(struct in6_addr));
+	send(netlink_fds[1], msg.buf, msg.n.nlmsg_len, 0);
+	process_netlink_msg(netlink_fds[0], &steady_iface, steady_sock);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.n.nlmsg_type = RTM_NEWLINK;
+	msg.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+	struct ifinfomsg *ifi = (struct ifinfomsg *)NLMSG_DATA(&msg.n);
+	ifi->ifi_index = steady_iface.props.if_index + 1000;
+	ifi->ifi_flags = IFF_UP | IFF_RUNNING;
+	steady_netlink_attr(&msg.n, IFLA_IFNAME, "steady0", sizeof("steady0"));
+	send(netlink_fds[1], msg.buf, msg.n.nlmsg_len, 0);
+	process_netlink_msg(netlink_fds[0], &steady_iface, steady_sock);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.n.nlmsg_type = RTM_NEWNETCONF;
+	msg.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct netconfmsg));
+	((struct netconfmsg *)NLMSG_DATA(&msg.n))->ncm_family = AF_INET6;
+	int32_t const ifindex = NETCONFA_IFINDEX_ALL;
+	int32_t const forwarding = 1;
+	steady_netlink_attr(&msg.n, NETCONFA_IFINDEX, &ifindex, sizeof(ifindex));
+	steady_netlink_attr(&msg.n, NETCONFA_FORWARDING, &forwarding, sizeof(forwarding));
+	send(netlink_fds[1], msg.buf, msg.n.nlmsg_len, 0);
+	process_netlink_msg(netlink_fds[0], &steady_iface, steady_sock);
+}
+#endif
+
+static void steady_round(void)
+{
+	steady_rs();
+	timer_handler(&steady_iface, &steady_sock);
+#ifdef HAVE_NETLINK
+	steady_netlink();
+#endif
+}
+
+START_TEST(test_steady_state)
+{
+#ifdef HAVE_NETLINK
+	ck_assert_int_eq(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, netlink_fds));
+#endif
+
+	/* The first round sets up what the others reuse. */
+	steady_round();
+	steady_ras = 0;
+
+	counting = 1;
+	for (int i = 0; i < STEADY_ROUNDS; ++i)
+		steady_round();
+	counting = 0;
+
+	ck_assert_int_eq(0, allocs);
+	ck_assert_int_eq(0, sockets);
+	/* the unicast answers to the RSs and the RAs of the timer */
+	ck_assert_int_eq((STEADY_RSS + 1) * STEADY_ROUNDS, steady_ras);
+
+#ifdef HAVE_NETLINK
+	close(netlink_fds[0]);
+	close(netlink_fds[1]);
+#endif
+}
+END_TEST
+
+static Suite *alloc_suite(void)
+{
+	TCase *tc_steady = tcase_create("steady");
+	tcase_add_checked_fixture(tc_steady, steady_setup, steady_teardown);
+	tcase_add_test(tc_steady, test_steady_state);
+
+	Suite *s = suite_create("alloc");
+	suite_add_tcase(s, tc_steady);
+
+	return s;
+}
+
+int main(void)
+{
+#ifndef __GLIBC__
+	/* malloc can't be interposed portably, the test is skipped */
+	return 77;
+#endif
+	SRunner *sr = srunner_create(alloc_suite());
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
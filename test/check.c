@@ -15,6 +15,14 @@ static void usage(char const *pname);
 static void version(void);
 Suite *util_suite();
 Suite *send_suite();
+Suite *interface_suite();
+Suite *event_suite();
+Suite *recv_suite();
+Suite *socket_suite();
+Suite *timer_suite();
+#ifdef HAVE_NETLINK
+Suite *netlink_suite();
+#endif
 
 #ifdef HAVE_GETOPT_LONG
 
@@ -127,6 +135,14 @@ int main(int argc, char *argv[])
 
 	SRunner *sr = srunner_create(util_suite());
 	srunner_add_suite(sr, send_suite());
+	srunner_add_suite(sr, interface_suite());
+	srunner_add_suite(sr, event_suite());
+	srunner_add_suite(sr, recv_suite());
+	srunner_add_suite(sr, socket_suite());
+	srunner_add_suite(sr, timer_suite());
+#ifdef HAVE_NETLINK
+	srunner_add_suite(sr, netlink_suite());
+#endif
 	srunner_run(sr, options.suite, options.test, options.mode);
 	int number_failed = srunner_ntests_failed(sr);
 	srunner_free(sr);
@@ -0,0 +1,114 @@
+
+#include "config.h"
+#include "includes.h"
+#include "radvd.h"
+#include <check.h>
+
+/*
+ * Exercises whichever event backend, event-epoll.c or event-poll.c, the
+ * build selected.
+ */
+
+Suite *event_suite(void);
+
+static int event_count;
+static int event_signal;
+
+static void event_count_handler(int fd, void *data)
+{
+	char c;
+	ck_assert_int_eq(1, read(fd, &c, 1));
+	ck_assert_ptr_eq(&event_count, data);
+	++event_count;
+}
+
+static void event_signal_handler(int sig) { event_signal = sig; }
+
+static void event_setup(void)
+{
+	event_count = 0;
+	event_signal = 0;
+	event_init();
+}
+
+static void event_teardown(void) { event_close(); }
+
+START_TEST(test_event_fd)
+{
+	int pipe_ends[2];
+	ck_assert_int_eq(0, pipe(pipe_ends));
+
+	event_add_fd(pipe_ends[0], event_count_handler, &event_count);
+	ck_assert_int_eq(1, write(pipe_ends[1], "x", 1));
+	ck_assert_int_eq(1, event_wait(0));
+	ck_assert_int_eq(1, event_count);
+
+	/* A removed descriptor is no longer handled. */
+	event_del_fd(pipe_ends[0]);
+	ck_assert_int_eq(1, write(pipe_ends[1], "x", 1));
+	struct timespec deadline = next_timespec(0.01);
+	event_wait(&deadline);
+	ck_assert_int_eq(1, event_count);
+
+	close(pipe_ends[0]);
+	close(pipe_ends[1]);
+}
+END_TEST
+
+START_TEST(test_event_deadline)
+{
+	for (int i = 0; i < 10; ++i) {
+		struct timespec deadline = next_timespec(0.0025);
+		struct timespec now;
+		do {
+			event_wait(&deadline);
+			clock_gettime(CLOCK_MONOTONIC, &now);
+		} while (timespecdiff(&deadline, &now) > 0);
+
+		/* Never early, and not rounded to a whole millisecond or worse. */
+		int64_t late_nsec =
+		    ((int64_t)now.tv_sec - deadline.tv_sec) * 1000000000LL + ((int64_t)now.tv_nsec - deadline.tv_nsec);
+		ck_assert(late_nsec >= 0);
+		ck_assert(late_nsec < 50 * 1000000LL);
+	}
+}
+END_TEST
+
+START_TEST(test_event_past_deadline)
+{
+	struct timespec deadline = {0, 0};
+	struct timespec before, after;
+
+	clock_gettime(CLOCK_MONOTONIC, &before);
+	event_wait(&deadline);
+	clock_gettime(CLOCK_MONOTONIC, &after);
+
+	ck_assert(timespecdiff(&after, &before) < 50);
+}
+END_TEST
+
+START_TEST(test_event_signal)
+{
+	event_add_signal(SIGUSR2, event_signal_handler);
+	raise(SIGUSR2);
+
+	struct timespec deadline = next_timespec(1);
+	event_wait(&deadline);
+	ck_assert_int_eq(SIGUSR2, event_signal);
+}
+END_TEST
+
+Suite *event_suite(void)
+{
+	TCase *tc_event = tcase_create("event");
+	tcase_add_checked_fixture(tc_event, event_setup, event_teardown);
+	tcase_add_test(tc_event, test_event_fd);
+	tcase_add_test(tc_event, test_event_deadline);
+	tcase_add_test(tc_event, test_event_past_deadline);
+	tcase_add_test(tc_event, test_event_signal);
+
+	Suite *s = suite_create("event");
+	suite_add_tcase(s, tc_event);
+
+	return s;
+}
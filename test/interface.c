@@ -0,0 +1,503 @@
+
+#include <check.h>
+
+#define TEST_QUEUE_IFACES 10000
+
+static struct Interface *queue_ifaces;
+
+static void queue_setup(void)
+{
+	queue_ifaces = calloc(TEST_QUEUE_IFACES, sizeof(struct Interface));
+	ck_assert_ptr_ne(0, queue_ifaces);
+	for (int i = 0; i < TEST_QUEUE_IFACES; ++i) {
+		iface_init_defaults(&queue_ifaces[i]);
+		queue_ifaces[i].times.next_multicast.tv_sec = rand() % 100000;
+		queue_ifaces[i].times.next_multicast.tv_nsec = rand() % 1000000000;
+		iface_queue_add(&queue_ifaces[i]);
+	}
+}
+
+static void queue_teardown(void)
+{
+	for (int i = 0; i < TEST_QUEUE_IFACES; ++i) {
+		iface_queue_remove(&queue_ifaces[i]);
+	}
+	free(queue_ifaces);
+}
+
+static int64_t queue_key(struct Interface const *iface)
+{
+	return (int64_t)iface->times.next_multicast.tv_sec * 1000000000LL + iface->times.next_multicast.tv_nsec;
+}
+
+START_TEST(test_iface_queue_order)
+{
+	int64_t last = INT64_MIN;
+	for (int i = 0; i < TEST_QUEUE_IFACES; ++i) {
+		struct Interface *iface = find_iface_by_time();
+		ck_assert_ptr_ne(0, iface);
+		ck_assert(queue_key(iface) >= last);
+		last = queue_key(iface);
+		iface_queue_remove(iface);
+	}
+	ck_assert_ptr_eq(0, find_iface_by_time());
+}
+END_TEST
+
+START_TEST(test_iface_queue_reschedule)
+{
+	/* Move random interfaces to random deadlines, as reschedule_iface does. */
+	for (int i = 0; i < TEST_QUEUE_IFACES; ++i) {
+		struct Interface *iface = &queue_ifaces[rand() % TEST_QUEUE_IFACES];
+		reschedule_iface(iface, rand() % 1000);
+	}
+
+	/* And remove some from the middle of the queue. */
+	for (int i = 0; i < TEST_QUEUE_IFACES; i += 3) {
+		iface_queue_remove(&queue_ifaces[i]);
+	}
+
+	int64_t last = INT64_MIN;
+	int count = 0;
+	struct Interface *iface;
+	while ((iface = find_iface_by_time())) {
+		ck_assert(queue_key(iface) >= last);
+		last = queue_key(iface);
+		iface_queue_remove(iface);
+		++count;
+	}
+	ck_assert_int_eq(count, TEST_QUEUE_IFACES - (TEST_QUEUE_IFACES + 2) / 3);
+}
+END_TEST
+
+static void queue_set_deadline(struct Interface *iface, struct timespec const *ts, int offset)
+{
+	iface_queue_remove(iface);
+	iface->times.next_multicast = *ts;
+	iface->times.next_multicast.tv_sec += offset;
+	iface_queue_add(iface);
+}
+
+static void expire_count(struct Interface *iface, void *data)
+{
+	++*(int *)data;
+	reschedule_iface(iface, 1000);
+}
+
+START_TEST(test_expire_ifaces_budget)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	/* Half of the interfaces are overdue, the other half far in the future. */
+	for (int i = 0; i < TEST_QUEUE_IFACES; ++i) {
+		queue_set_deadline(&queue_ifaces[i], &now, (i % 2) ? 1000 : -1);
+	}
+
+	int handled = 0;
+	int wakeups = 0;
+	while (expire_ifaces(expire_count, &handled, 64) > 0) {
+		++wakeups;
+	}
+	ck_assert_int_eq(handled, TEST_QUEUE_IFACES / 2);
+	ck_assert_int_eq(wakeups, (TEST_QUEUE_IFACES / 2 + 63) / 64);
+}
+END_TEST
+
+START_TEST(test_expire_ifaces_not_early)
+{
+	struct timespec now = {1000, 0};
+	set_simulated_clock(&now);
+	set_clock_source(simulated_clock);
+	for (int i = 0; i < TEST_QUEUE_IFACES; ++i) {
+		queue_set_deadline(&queue_ifaces[i], &now, 1000);
+	}
+
+	/* A deadline less than a millisecond away hasn't expired yet. */
+	struct timespec deadline = {1000, 500000};
+	queue_set_deadline(&queue_ifaces[0], &deadline, 0);
+	int handled = 0;
+	ck_assert_int_eq(0, expire_ifaces(expire_count, &handled, 64));
+	set_simulated_clock(&deadline);
+	ck_assert_int_eq(1, expire_ifaces(expire_count, &handled, 64));
+	ck_assert_int_eq(1, handled);
+
+	set_clock_source(NULL);
+}
+END_TEST
+
+static void expire_record(struct Interface *iface, void *data)
+{
+	struct timespec *fired = data;
+	clock_now(fired);
+	reschedule_iface(iface, 1000);
+}
+
+/* An RS taking a millisecond to answer, with another one waiting behind it. */
+static void rs_flood_handler(int sock, void *data)
+{
+	char rs[8];
+	ck_assert_int_eq(sizeof(rs), recv(sock, rs, sizeof(rs), 0));
+	ck_assert_int_eq(sizeof(rs), send(((int *)data)[1], rs, sizeof(rs), 0));
+	++((int *)data)[2];
+
+	struct timespec now;
+	clock_now(&now);
+	now.tv_nsec += 1000000;
+	if (now.tv_nsec >= 1000000000) {
+		++now.tv_sec;
+		now.tv_nsec -= 1000000000;
+	}
+	set_simulated_clock(&now);
+}
+
+START_TEST(test_expire_ifaces_rs_flood)
+{
+	/*
+	 * The main loop while the ICMPv6 socket is constantly readable: every
+	 * wakeup handles an RS and comes back to the loop without the wait ever
+	 * timing out.  The multicast RA must still go out on time.
+	 */
+	struct timespec now = {1000, 0};
+	set_simulated_clock(&now);
+	set_clock_source(simulated_clock);
+	for (int i = 0; i < TEST_QUEUE_IFACES; ++i) {
+		queue_set_deadline(&queue_ifaces[i], &now, 1000);
+	}
+
+	struct Interface *iface = &queue_ifaces[0];
+	iface->state_info.racount = MAX_INITIAL_RTR_ADVERTISEMENTS;
+	reschedule_iface(iface, 0.05);
+	struct timespec deadline = iface->times.next_multicast;
+
+	int flood[3] = {-1, -1, 0}; /* the socket pair, and the RSs handled */
+	ck_assert_int_eq(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, flood));
+	ck_assert_int_eq(8, send(flood[1], "solicit", 8, 0));
+	event_init();
+	event_add_fd(flood[0], rs_flood_handler, flood);
+
+	struct timespec fired = {0, 0};
+	int wakeups = 0;
+	while (!fired.tv_sec && !fired.tv_nsec) {
+		event_wait(&find_iface_by_time()->times.next_multicast);
+		++wakeups;
+		expire_ifaces(expire_record, &fired, MAX_EXPIRED_IFACES_PER_WAKEUP);
+	}
+
+	event_close();
+	close(flood[0]);
+	close(flood[1]);
+	set_clock_source(NULL);
+
+	/* Every wakeup was an RS, the one due went out at the first after its deadline. */
+	ck_assert_int_eq(wakeups, flood[2]);
+	ck_assert_int_eq(50, flood[2]);
+	ck_assert_int_eq(0, timespecdiff(&fired, &deadline));
+}
+END_TEST
+
+#define TEST_PACE_IFACES 1000
+#define TEST_PACE_WINDOW 0.25
+#define TEST_PACE_BUCKETS 25
+
+struct pace_result {
+	struct timespec start;
+	int fired;
+	int buckets[TEST_PACE_BUCKETS + 1];
+};
+
+static void pace_record(struct Interface *iface, void *data)
+{
+	struct pace_result *result = data;
+	struct timespec now;
+	clock_now(&now);
+
+	int64_t msec = timespecdiff(&now, &result->start);
+	ck_assert_int_ge(msec, 0);
+	ck_assert_int_lt(msec, TEST_PACE_WINDOW * 1000);
+	++result->buckets[min(msec * TEST_PACE_BUCKETS / (int64_t)(TEST_PACE_WINDOW * 1000), TEST_PACE_BUCKETS)];
+	++result->fired;
+
+	/* As timer_handler does: the RAs after the paced one keep the initial interval. */
+	++iface->state_info.racount;
+	reschedule_iface(iface, rand_between(iface->MinRtrAdvInterval, iface->MaxRtrAdvInterval));
+	ck_assert_int_le(timespecdiff(&iface->times.next_multicast, &now), MAX_INITIAL_RTR_ADVERT_INTERVAL * 1000 + 1);
+}
+
+START_TEST(test_pace_iface)
+{
+	struct Interface *ifaces = calloc(TEST_PACE_IFACES, sizeof(struct Interface));
+	ck_assert_ptr_ne(0, ifaces);
+
+	struct pace_result result;
+	memset(&result, 0, sizeof(result));
+	result.start.tv_sec = 1000;
+	set_simulated_clock(&result.start);
+	set_clock_source(simulated_clock);
+
+	for (int i = 0; i < TEST_PACE_IFACES; ++i) {
+		iface_init_defaults(&ifaces[i]);
+		ifaces[i].state_info.ready = 1;
+		iface_queue_add(&ifaces[i]);
+		pace_iface(&ifaces[i], TEST_PACE_WINDOW, i, TEST_PACE_IFACES);
+	}
+
+	/* The clock goes straight to each deadline, as the wait of the main loop would. */
+	while (result.fired < TEST_PACE_IFACES) {
+		set_simulated_clock(&find_iface_by_time()->times.next_multicast);
+		expire_ifaces(pace_record, &result, 64);
+	}
+
+	/* Evenly spread instead of all at once: every bucket gets its share, give or take one at its edges. */
+	for (int i = 0; i < TEST_PACE_BUCKETS; ++i) {
+		ck_assert_int_ge(result.buckets[i], TEST_PACE_IFACES / TEST_PACE_BUCKETS - 1);
+		ck_assert_int_le(result.buckets[i], TEST_PACE_IFACES / TEST_PACE_BUCKETS + 1);
+	}
+	ck_assert_int_eq(0, result.buckets[TEST_PACE_BUCKETS]);
+
+	for (int i = 0; i < TEST_PACE_IFACES; ++i) {
+		iface_queue_remove(&ifaces[i]);
+	}
+	free(ifaces);
+	set_clock_source(NULL);
+}
+END_TEST
+
+START_TEST(test_pace_iface_short_interval)
+{
+	struct Interface iface;
+	iface_init_defaults(&iface);
+	iface.MaxRtrAdvInterval = 4;
+	iface_queue_add(&iface);
+
+	/* The first RA is never later than it would have been unpaced. */
+	struct timespec now = {1000, 0};
+	set_simulated_clock(&now);
+	set_clock_source(simulated_clock);
+	pace_iface(&iface, MAX_INITIAL_RTR_ADVERT_INTERVAL, 9, 10);
+	ck_assert_int_eq(4 * 1000, timespecdiff(&iface.times.next_multicast, &now));
+
+	iface_queue_remove(&iface);
+	set_clock_source(NULL);
+}
+END_TEST
+
+#define TEST_SLACK_IFACES 100
+#define TEST_SLACK_MIN 0.05
+#define TEST_SLACK_MAX 0.15
+#define TEST_SLACK_SECONDS 10
+
+struct slack_result {
+	struct Interface *ifaces;
+	struct timespec *last;
+	int fired;
+};
+
+static void slack_record(struct Interface *iface, void *data)
+{
+	struct slack_result *result = data;
+	struct timespec *last = &result->last[iface - result->ifaces];
+	struct timespec now;
+	clock_now(&now);
+
+	/* Coalesced or not, every interval stays within [MinRtrAdvInterval, MaxRtrAdvInterval], but for the rounding to ns. */
+	int64_t interval = ((int64_t)now.tv_sec - last->tv_sec) * 1000000000LL + ((int64_t)now.tv_nsec - last->tv_nsec);
+	ck_assert(interval >= TEST_SLACK_MIN * 1000000000LL - 1);
+	ck_assert(interval <= TEST_SLACK_MAX * 1000000000LL + 1);
+
+	*last = now;
+	++result->fired;
+	reschedule_iface(iface, rand_between(iface->MinRtrAdvInterval, iface->MaxRtrAdvInterval));
+}
+
+/* Runs the ifaces through the main loop for a while, returning the number of wakeups. */
+static int slack_run(double slack)
+{
+	struct slack_result result;
+	result.ifaces = calloc(TEST_SLACK_IFACES, sizeof(struct Interface));
+	result.last = calloc(TEST_SLACK_IFACES, sizeof(struct timespec));
+	result.fired = 0;
+	ck_assert_ptr_ne(0, result.ifaces);
+	ck_assert_ptr_ne(0, result.last);
+
+	set_timer_slack(slack);
+
+	struct timespec now = {1000, 0};
+	set_simulated_clock(&now);
+	set_clock_source(simulated_clock);
+	for (int i = 0; i < TEST_SLACK_IFACES; ++i) {
+		struct Interface *iface = &result.ifaces[i];
+		iface_init_defaults(iface);
+		iface->MinRtrAdvInterval = TEST_SLACK_MIN;
+		iface->MaxRtrAdvInterval = TEST_SLACK_MAX;
+		iface->state_info.ready = 1;
+		iface->state_info.racount = MAX_INITIAL_RTR_ADVERTISEMENTS;
+		result.last[i] = now;
+		reschedule_iface(iface, rand_between(iface->MinRtrAdvInterval, iface->MaxRtrAdvInterval));
+	}
+
+	struct timespec end = next_timespec(TEST_SLACK_SECONDS);
+	int wakeups = 0;
+	do {
+		/* the wait of the main loop, which wakes up right at the deadline */
+		now = find_iface_by_time()->times.next_multicast;
+		set_simulated_clock(&now);
+		++wakeups;
+		expire_ifaces(slack_record, &result, MAX_EXPIRED_IFACES_PER_WAKEUP);
+	} while (timespecdiff(&end, &now) > 0);
+
+	ck_assert_int_ge(result.fired, TEST_SLACK_SECONDS / TEST_SLACK_MAX * TEST_SLACK_IFACES);
+
+	set_timer_slack(0);
+	for (int i = 0; i < TEST_SLACK_IFACES; ++i) {
+		iface_queue_remove(&result.ifaces[i]);
+	}
+	free(result.ifaces);
+	free(result.last);
+	set_clock_source(NULL);
+
+	return wakeups;
+}
+
+START_TEST(test_timer_slack)
+{
+	int wakeups = slack_run(0);
+	int coalesced_wakeups = slack_run((TEST_SLACK_MAX - TEST_SLACK_MIN) / 2);
+
+	ck_assert_int_lt(3 * coalesced_wakeups, wakeups);
+}
+END_TEST
+
+START_TEST(test_touch_iface_coalesced)
+{
+	struct timespec now = {1000, 0};
+	set_simulated_clock(&now);
+	set_clock_source(simulated_clock);
+	memset(&stats, 0, sizeof(stats));
+
+	struct Interface iface;
+	iface_init_defaults(&iface);
+	strlcpy(iface.props.name, "radvdtest9", sizeof(iface.props.name));
+	iface.IgnoreIfMissing = 1;
+	iface.MaxRtrAdvInterval = DFLT_MaxRtrAdvInterval;
+	iface.state_info.changed = 0;
+	iface.state_info.ready = 1;
+	iface.state_info.racount = MAX_INITIAL_RTR_ADVERTISEMENTS;
+
+	/* The first change sets the setup going, the ones that come before it runs wait for it. */
+	touch_iface(&iface);
+	ck_assert_int_eq(0, iface.state_info.racount);
+	struct timespec setup = iface.times.next_multicast;
+	now.tv_nsec = 500000000;
+	set_simulated_clock(&now);
+	for (int i = 0; i < 99; ++i) {
+		iface.state_info.racount = 1;
+		touch_iface(&iface);
+		ck_assert_int_eq(1, iface.state_info.racount);
+	}
+	ck_assert_int_eq(setup.tv_sec, iface.times.next_multicast.tv_sec);
+	ck_assert_int_eq(setup.tv_nsec, iface.times.next_multicast.tv_nsec);
+	ck_assert_int_eq(100, stats.iface_touches);
+	ck_assert_int_eq(99, stats.iface_touches_coalesced);
+
+	/* Once set up, the next change waits for another. */
+	setup_iface(-1, &iface);
+	ck_assert_int_eq(0, iface.state_info.touches);
+	touch_iface(&iface);
+	ck_assert_int_eq(0, iface.state_info.racount);
+#ifdef HAVE_NETLINK
+	ck_assert_int_eq(1000 + IFACE_SETUP_DELAY, iface.times.next_multicast.tv_sec);
+	ck_assert_int_eq(500000000, iface.times.next_multicast.tv_nsec);
+#endif
+	ck_assert_int_eq(99, stats.iface_touches_coalesced);
+
+	iface_queue_remove(&iface);
+	free_ra_cache(&iface);
+	set_clock_source(NULL);
+}
+END_TEST
+
+START_TEST(test_setup_iface_unchanged)
+{
+	struct Interface iface;
+	iface_init_defaults(&iface);
+	strlcpy(iface.props.name, "radvdtest9", sizeof(iface.props.name));
+	iface.IgnoreIfMissing = 1;
+	struct ra_iov ra;
+	iface.ra_cache.ras = &ra;
+	iface.ra_cache.ra_count = 1;
+
+	/* Nothing about the interface changed, whatever was built for it still holds. */
+	ck_assert_int_eq(-1, setup_iface(-1, &iface));
+	ck_assert_ptr_eq(&ra, iface.ra_cache.ras);
+
+	/* An interface that is no longer ready has to build them again. */
+	iface.state_info.ready = 1;
+	ck_assert_int_eq(-1, setup_iface(-1, &iface));
+	ck_assert_ptr_eq(NULL, iface.ra_cache.ras);
+
+	free_ra_cache(&iface);
+}
+END_TEST
+
+START_TEST(test_iface_rx_missed)
+{
+	struct Interface iface;
+	iface_init_defaults(&iface);
+	strlcpy(iface.props.name, "radvdtest9", sizeof(iface.props.name));
+
+	/* Nothing is counted for an interface the kernel has no counters of. */
+	reset_iface_rx_stats(&iface);
+	ck_assert_int_eq(-1, get_iface_rx_missed(&iface));
+
+#ifdef __linux__
+	strlcpy(iface.props.name, "lo", sizeof(iface.props.name));
+	reset_iface_rx_stats(&iface);
+	ck_assert_int_ge(iface.state_info.rx_kernel_base, 0);
+	ck_assert_int_eq(0, get_iface_rx_missed(&iface));
+
+	/* Three received by the kernel, of which radvd got one. */
+	iface.state_info.rx_kernel_base -= 3;
+	iface.state_info.rx_packets = 1;
+	ck_assert_int_eq(2, get_iface_rx_missed(&iface));
+#endif
+}
+END_TEST
+
+Suite *interface_suite(void)
+{
+	TCase *tc_queue = tcase_create("queue");
+	tcase_add_checked_fixture(tc_queue, queue_setup, queue_teardown);
+	tcase_add_test(tc_queue, test_iface_queue_order);
+	tcase_add_test(tc_queue, test_iface_queue_reschedule);
+
+	TCase *tc_expire = tcase_create("expire");
+	tcase_add_checked_fixture(tc_expire, queue_setup, queue_teardown);
+	tcase_add_test(tc_expire, test_expire_ifaces_budget);
+	tcase_add_test(tc_expire, test_expire_ifaces_rs_flood);
+	tcase_add_test(tc_expire, test_expire_ifaces_not_early);
+
+	TCase *tc_pace = tcase_create("pace");
+	tcase_add_test(tc_pace, test_pace_iface);
+	tcase_add_test(tc_pace, test_pace_iface_short_interval);
+
+	TCase *tc_slack = tcase_create("slack");
+	tcase_add_test(tc_slack, test_timer_slack);
+
+	TCase *tc_touch = tcase_create("touch");
+	tcase_add_test(tc_touch, test_touch_iface_coalesced);
+	tcase_add_test(tc_touch, test_setup_iface_unchanged);
+
+	TCase *tc_rx = tcase_create("rx");
+	tcase_add_test(tc_rx, test_iface_rx_missed);
+
+	Suite *s = suite_create("interface");
+	suite_add_tcase(s, tc_queue);
+	suite_add_tcase(s, tc_expire);
+	suite_add_tcase(s, tc_pace);
+	suite_add_tcase(s, tc_slack);
+	suite_add_tcase(s, tc_touch);
+	suite_add_tcase(s, tc_rx);
+
+	return s;
+}
@@ -0,0 +1,548 @@
+
+#include <check.h>
+
+/* The RAs of notify_iface are sent to notify_sent rather than to ::1. */
+static int notify_sock = -1;
+static struct Interface notify_iface;
+static struct in6_addr notify_src;
+static struct safe_buffer notify_sent = SAFE_BUFFER_INIT;
+
+static ssize_t notify_transport(int sock, struct msghdr const *mhdr, int flags)
+{
+	notify_sent.used = 0;
+	for (size_t i = 0; i < mhdr->msg_iovlen; ++i)
+		safe_buffer_append(&notify_sent, mhdr->msg_iov[i].iov_base, mhdr->msg_iov[i].iov_len);
+	return notify_sent.used;
+}
+
+static void notify_setup(void)
+{
+	notify_sock = socket(AF_INET6, SOCK_DGRAM, 0);
+	ck_assert_int_ge(notify_sock, 0);
+
+	iface_init_defaults(&notify_iface);
+	strlcpy(notify_iface.props.name, "lo", sizeof(notify_iface.props.name));
+	notify_src = in6addr_any;
+	notify_iface.props.if_addr_rasrc = &notify_src;
+	notify_iface.AdvSendAdvert = 1;
+	notify_iface.state_info.changed = 0;
+	notify_iface.state_info.ready = 1;
+	notify_iface.props.max_ra_option_size = RFC2460_MIN_MTU;
+	notify_iface.ra_header_info.AdvDefaultLifetime = 1800;
+
+	struct AdvPrefix *prefix = calloc(1, sizeof(struct AdvPrefix));
+	ck_assert_ptr_ne(0, prefix);
+	prefix_init_defaults(prefix);
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8::", &prefix->Prefix));
+	prefix->PrefixLen = 64;
+	prefix->curr_validlft = prefix->AdvValidLifetime;
+	prefix->curr_preferredlft = prefix->AdvPreferredLifetime;
+	notify_iface.AdvPrefixList = prefix;
+
+	/* Whatever procfs says, forwarding is on unless a test turns it off. */
+	set_ip6_forwarding(1);
+	memset(&stats, 0, sizeof(stats));
+
+	struct timespec start = {1000, 0};
+	set_simulated_clock(&start);
+	set_clock_source(simulated_clock);
+	set_send_transport(notify_transport);
+	notify_iface.times.last_ra_time = start;
+}
+
+static void notify_teardown(void)
+{
+	iface_queue_remove(&notify_iface);
+	set_send_transport(NULL);
+	set_clock_source(NULL);
+	free_ra_cache(&notify_iface);
+	free(notify_iface.AdvPrefixList);
+	notify_iface.AdvPrefixList = NULL;
+	safe_buffer_free(&notify_sent);
+	notify_sent = SAFE_BUFFER_INIT;
+	close(notify_sock);
+}
+
+/* Hand process_netlink_msg a notification, as the kernel would. */
+static void netlink_notify(struct nlmsghdr const *nh)
+{
+	int fds[2];
+	ck_assert_int_eq(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+	ck_assert_int_eq(nh->nlmsg_len, send(fds[1], nh, nh->nlmsg_len, 0));
+	process_netlink_msg(fds[0], &notify_iface, notify_sock);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static void netconf_notify(int32_t ifindex, int32_t forwarding)
+{
+	union {
+		struct nlmsghdr n;
+		char buf[NLMSG_SPACE(sizeof(struct netconfmsg)) + 2 * RTA_SPACE(sizeof(int32_t))];
+	} msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.n.nlmsg_len = sizeof(msg.buf);
+	msg.n.nlmsg_type = RTM_NEWNETCONF;
+	((struct netconfmsg *)NLMSG_DATA(&msg.n))->ncm_family = AF_INET6;
+
+	struct rtattr *rta = (struct rtattr *)(msg.buf + NLMSG_SPACE(sizeof(struct netconfmsg)));
+	rta->rta_type = NETCONFA_IFINDEX;
+	rta->rta_len = RTA_LENGTH(sizeof(int32_t));
+	memcpy(RTA_DATA(rta), &ifindex, sizeof(int32_t));
+	rta = (struct rtattr *)((char *)rta + RTA_SPACE(sizeof(int32_t)));
+	rta->rta_type = NETCONFA_FORWARDING;
+	rta->rta_len = RTA_LENGTH(sizeof(int32_t));
+	memcpy(RTA_DATA(rta), &forwarding, sizeof(int32_t));
+
+	netlink_notify(&msg.n);
+}
+
+static uint16_t notify_sent_router_lifetime(void)
+{
+	return ntohs(((struct nd_router_advert *)notify_sent.buffer)->nd_ra_router_lifetime);
+}
+
+START_TEST(test_netconf_forwarding)
+{
+	notify_iface.props.if_index = 1;
+	notify_iface.state_info.racount = MAX_INITIAL_RTR_ADVERTISEMENTS;
+	ck_assert_int_eq(0, send_ra_forall(notify_sock, &notify_iface, NULL));
+	ck_assert_int_eq(1800, notify_sent_router_lifetime());
+	reschedule_iface(&notify_iface, 600);
+
+	/* Forwarding being disabled is advertised as soon as MinDelayBetweenRAs allows... */
+	struct timespec now = {1001, 0};
+	set_simulated_clock(&now);
+	netconf_notify(NETCONFA_IFINDEX_ALL, 0);
+	ck_assert_int_eq(-1, check_ip6_forwarding());
+	ck_assert_int_eq(1003, notify_iface.times.next_multicast.tv_sec);
+	ck_assert_int_eq(1003, notify_iface.times.earliest_multicast.tv_sec);
+
+	now.tv_sec = 1003;
+	set_simulated_clock(&now);
+	ck_assert_int_eq(0, send_ra_forall(notify_sock, &notify_iface, NULL));
+	ck_assert_int_eq(0, notify_sent_router_lifetime());
+	reschedule_iface(&notify_iface, 600);
+
+	/* ...and so is it being enabled again. */
+	now.tv_sec = 1010;
+	set_simulated_clock(&now);
+	netconf_notify(NETCONFA_IFINDEX_ALL, 2);
+	ck_assert_int_eq(0, check_ip6_forwarding());
+	ck_assert_int_eq(1010, notify_iface.times.next_multicast.tv_sec);
+	ck_assert_int_eq(0, send_ra_forall(notify_sock, &notify_iface, NULL));
+	ck_assert_int_eq(1800, notify_sent_router_lifetime());
+	reschedule_iface(&notify_iface, 600);
+
+	/* A notification changing nothing leaves the RAs alone. */
+	netconf_notify(NETCONFA_IFINDEX_ALL, 1);
+	ck_assert_int_eq(1610, notify_iface.times.next_multicast.tv_sec);
+
+	/* The setting of the interface itself is kept as well. */
+	notify_iface.state_info.forwarding = 1;
+	netconf_notify(2, 0);
+	ck_assert_int_eq(1, notify_iface.state_info.forwarding);
+	netconf_notify(1, 0);
+	ck_assert_int_eq(0, notify_iface.state_info.forwarding);
+	ck_assert_int_eq(1610, notify_iface.times.next_multicast.tv_sec);
+}
+END_TEST
+
+static void netlink_attr(struct nlmsghdr *nh, unsigned short type, void const *data, size_t len)
+{
+	struct rtattr *rta = (struct rtattr *)((char *)nh + NLMSG_ALIGN(nh->nlmsg_len));
+	rta->rta_type = type;
+	rta->rta_len = RTA_LENGTH(len);
+	memcpy(RTA_DATA(rta), data, len);
+	nh->nlmsg_len = NLMSG_ALIGN(nh->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+}
+
+static void link_notify(int type, int ifindex, char const *name)
+{
+	union {
+		struct nlmsghdr n;
+		char buf[256];
+	} msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.n.nlmsg_type = type;
+	msg.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+	((struct ifinfomsg *)NLMSG_DATA(&msg.n))->ifi_index = ifindex;
+	netlink_attr(&msg.n, IFLA_IFNAME, name, strlen(name) + 1);
+	netlink_notify(&msg.n);
+}
+
+static void addr_notify(int type, int ifindex, char const *addr, int prefixlen, struct ifa_cacheinfo const *cacheinfo)
+{
+	union {
+		struct nlmsghdr n;
+		char buf[256];
+	} msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.n.nlmsg_type = type;
+	msg.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+	struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(&msg.n);
+	ifa->ifa_family = AF_INET6;
+	ifa->ifa_prefixlen = prefixlen;
+	ifa->ifa_index = ifindex;
+	struct in6_addr in6;
+	ck_assert_int_eq(1, inet_pton(AF_INET6, addr, &in6));
+	netlink_attr(&msg.n, IFA_ADDRESS, &in6, sizeof(in6));
+	if (cacheinfo)
+		netlink_attr(&msg.n, IFA_CACHEINFO, cacheinfo, sizeof(*cacheinfo));
+	netlink_notify(&msg.n);
+}
+
+/* The prefix options of the RA sent last, up to max of them, and how many there are. */
+static int notify_sent_prefixes(struct nd_opt_prefix_info const **pinfo, int max)
+{
+	int count = 0;
+	size_t offset = sizeof(struct nd_router_advert);
+	while (offset + 2 <= notify_sent.used) {
+		struct nd_opt_hdr const *opt = (struct nd_opt_hdr const *)(notify_sent.buffer + offset);
+		ck_assert_int_gt(opt->nd_opt_len, 0);
+		if (opt->nd_opt_type == ND_OPT_PREFIX_INFORMATION && count < max)
+			pinfo[count] = (struct nd_opt_prefix_info const *)opt;
+		count += opt->nd_opt_type == ND_OPT_PREFIX_INFORMATION;
+		offset += opt->nd_opt_len * 8;
+	}
+	return count;
+}
+
+START_TEST(test_netlink_addr_table)
+{
+	/* An interface the kernel doesn't have, known from the notifications alone. */
+	int const ifindex = 100000;
+	ck_assert_int_eq(0, netlink_seed_addr_table());
+	link_notify(RTM_NEWLINK, ifindex, "radvdtest0");
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8:2::1", 48, NULL);
+	addr_notify(RTM_NEWADDR, ifindex, "fe80::1", 64, NULL);
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8:1::1", 64, NULL);
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8:1::1", 56, NULL);
+
+	/* Sorted, with the prefix length of the latest notification. */
+	struct iface_addr const *addrs;
+	ck_assert_int_eq(3, netlink_iface_addrs(ifindex, NULL, &addrs));
+	char addr_str[INET6_ADDRSTRLEN];
+	addrtostr(&addrs[0].addr, addr_str, sizeof(addr_str));
+	ck_assert_str_eq("2001:db8:1::1", addr_str);
+	ck_assert_int_eq(56, addrs[0].prefixlen);
+	addrtostr(&addrs[1].addr, addr_str, sizeof(addr_str));
+	ck_assert_str_eq("2001:db8:2::1", addr_str);
+	ck_assert_int_eq(48, addrs[1].prefixlen);
+	addrtostr(&addrs[2].addr, addr_str, sizeof(addr_str));
+	ck_assert_str_eq("fe80::1", addr_str);
+
+	struct iface_addr const *by_name;
+	ck_assert_int_eq(3, netlink_iface_addrs(0, "radvdtest0", &by_name));
+	ck_assert_ptr_eq(addrs, by_name);
+
+	/* The addresses of the interface are set up from the table. */
+	struct Interface iface;
+	iface_init_defaults(&iface);
+	strlcpy(iface.props.name, "radvdtest0", sizeof(iface.props.name));
+	iface.props.if_index = ifindex;
+	ck_assert_int_eq(3, setup_iface_addrs(&iface));
+	ck_assert_int_eq(3, iface.props.addrs_count);
+	addrtostr(&iface.props.if_addr, addr_str, sizeof(addr_str));
+	ck_assert_str_eq("fe80::1", addr_str);
+	free(iface.props.if_addrs);
+
+	/* So are the prefixes of ::/64, all but the link local one. */
+	strlcpy(notify_iface.props.name, "radvdtest0", sizeof(notify_iface.props.name));
+	notify_iface.props.if_index = ifindex;
+	notify_iface.AdvPrefixList->Prefix = in6addr_any;
+	ck_assert_int_eq(0, send_ra_forall(notify_sock, &notify_iface, NULL));
+	struct nd_opt_prefix_info const *pinfo[2];
+	ck_assert_int_eq(2, notify_sent_prefixes(pinfo, 2));
+	addrtostr(&pinfo[0]->nd_opt_pi_prefix, addr_str, sizeof(addr_str));
+	ck_assert_str_eq("2001:db8:1::", addr_str);
+	ck_assert_int_eq(56, pinfo[0]->nd_opt_pi_prefix_len);
+	addrtostr(&pinfo[1]->nd_opt_pi_prefix, addr_str, sizeof(addr_str));
+	ck_assert_str_eq("2001:db8:2::", addr_str);
+	ck_assert_int_eq(48, pinfo[1]->nd_opt_pi_prefix_len);
+
+	addr_notify(RTM_DELADDR, ifindex, "2001:db8:2::1", 48, NULL);
+	ck_assert_int_eq(2, netlink_iface_addrs(ifindex, NULL, &addrs));
+	ck_assert_ptr_eq(NULL, notify_iface.ra_cache.ras);
+	ck_assert_int_eq(0, send_ra_forall(notify_sock, &notify_iface, NULL));
+	ck_assert_int_eq(1, notify_sent_prefixes(pinfo, 2));
+
+	/* The link going takes its addresses along. */
+	link_notify(RTM_DELLINK, ifindex, "radvdtest0");
+	ck_assert_int_eq(0, netlink_iface_addrs(ifindex, NULL, &addrs));
+	ck_assert_int_eq(0, netlink_iface_addrs(0, "radvdtest0", &addrs));
+}
+END_TEST
+
+START_TEST(test_netlink_prefix_lifetimes)
+{
+	int const ifindex = 100001;
+	ck_assert_int_eq(0, netlink_seed_addr_table());
+	link_notify(RTM_NEWLINK, ifindex, "radvdtest1");
+	struct ifa_cacheinfo cacheinfo = {.ifa_prefered = 300, .ifa_valid = 600};
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8:5::1", 64, &cacheinfo);
+	cacheinfo.ifa_prefered = 100;
+	cacheinfo.ifa_valid = 900;
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8:5::2", 64, &cacheinfo);
+	/* known without its lifetimes, it doesn't count */
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8:5::3", 64, NULL);
+
+	/* The longest of each lifetime of the addresses in the prefix. */
+	struct AdvPrefix prefix;
+	prefix_init_defaults(&prefix);
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8:5::", &prefix.Prefix));
+	prefix.PrefixLen = 64;
+	unsigned int preferred = 0, valid = 0;
+	ck_assert_int_eq(1, netlink_get_address_lifetimes(&prefix, &preferred, &valid));
+	ck_assert_int_eq(300, preferred);
+	ck_assert_int_eq(900, valid);
+
+	/* They count down with no notification to tell. */
+	struct timespec later = {1100, 0};
+	set_simulated_clock(&later);
+	ck_assert_int_eq(1, netlink_get_address_lifetimes(&prefix, &preferred, &valid));
+	ck_assert_int_eq(200, preferred);
+	ck_assert_int_eq(800, valid);
+
+	/* Prefixes that don't end on a byte, in and out of which the addresses are. */
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8:4::", &prefix.Prefix));
+	prefix.PrefixLen = 47;
+	ck_assert_int_eq(1, netlink_get_address_lifetimes(&prefix, &preferred, &valid));
+	ck_assert_int_eq(800, valid);
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8:6::", &prefix.Prefix));
+	ck_assert_int_eq(0, netlink_get_address_lifetimes(&prefix, &preferred, &valid));
+	struct in6_addr addr;
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8:5::1", &addr));
+	ck_assert_int_eq(0, prefix_match(&prefix, &addr));
+	prefix.PrefixLen = 46;
+	ck_assert_int_eq(1, prefix_match(&prefix, &addr));
+
+	/* The addresses going are noticed. */
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8:5::", &prefix.Prefix));
+	prefix.PrefixLen = 64;
+	addr_notify(RTM_DELADDR, ifindex, "2001:db8:5::2", 64, NULL);
+	ck_assert_int_eq(1, netlink_get_address_lifetimes(&prefix, &preferred, &valid));
+	ck_assert_int_eq(200, preferred);
+	ck_assert_int_eq(500, valid);
+
+	cacheinfo.ifa_prefered = UINT32_MAX;
+	cacheinfo.ifa_valid = UINT32_MAX;
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8:5::1", 64, &cacheinfo);
+	ck_assert_int_eq(1, netlink_get_address_lifetimes(&prefix, &preferred, &valid));
+	ck_assert_int_eq(UINT32_MAX, preferred);
+	ck_assert_int_eq(UINT32_MAX, valid);
+
+	link_notify(RTM_DELLINK, ifindex, "radvdtest1");
+	ck_assert_int_eq(0, netlink_get_address_lifetimes(&prefix, &preferred, &valid));
+}
+END_TEST
+
+START_TEST(test_netlink_prefix_ras)
+{
+	/* The address of the prefix is on another interface, with no lifetimes going down. */
+	int const ifindex = 100002;
+	ck_assert_int_eq(0, netlink_seed_addr_table());
+	link_notify(RTM_NEWLINK, ifindex, "radvdtest2");
+	struct ifa_cacheinfo cacheinfo = {.ifa_prefered = UINT32_MAX, .ifa_valid = UINT32_MAX};
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8::1", 64, &cacheinfo);
+
+	ck_assert_int_eq(0, send_ra_forall(notify_sock, &notify_iface, NULL));
+	struct nd_opt_prefix_info const *pinfo[1];
+	ck_assert_int_eq(1, notify_sent_prefixes(pinfo, 1));
+	ck_assert_int_eq(notify_iface.AdvPrefixList->AdvValidLifetime, ntohl(pinfo[0]->nd_opt_pi_valid_time));
+	ck_assert_int_eq(0, notify_iface.ra_cache.dynamic);
+
+	/* An address out of the prefix changes nothing. */
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8:9::1", 64, &cacheinfo);
+	ck_assert_ptr_ne(NULL, notify_iface.ra_cache.ras);
+
+	/* The address in it, deprecated, has its RAs built again. */
+	cacheinfo.ifa_prefered = 0;
+	cacheinfo.ifa_valid = 600;
+	addr_notify(RTM_NEWADDR, ifindex, "2001:db8::1", 64, &cacheinfo);
+	ck_assert_ptr_eq(NULL, notify_iface.ra_cache.ras);
+	ck_assert_int_eq(0, send_ra_forall(notify_sock, &notify_iface, NULL));
+	ck_assert_int_eq(1, notify_sent_prefixes(pinfo, 1));
+	ck_assert_int_eq(0, ntohl(pinfo[0]->nd_opt_pi_preferred_time));
+	ck_assert_int_eq(600, ntohl(pinfo[0]->nd_opt_pi_valid_time));
+	ck_assert_int_eq(1, notify_iface.ra_cache.dynamic);
+
+	/* So does it going. */
+	addr_notify(RTM_DELADDR, ifindex, "2001:db8::1", 64, NULL);
+	ck_assert_ptr_eq(NULL, notify_iface.ra_cache.ras);
+
+	link_notify(RTM_DELLINK, ifindex, "radvdtest2");
+}
+END_TEST
+
+/* A datagram of count new addresses of ifindex, as a renumbering brings, numbered from first. */
+static size_t burst_datagram(char *buf, size_t size, int ifindex, int first, int count)
+{
+	size_t len = 0;
+	for (int i = first; i < first + count; ++i) {
+		struct nlmsghdr *nh = (struct nlmsghdr *)(buf + len);
+		ck_assert_int_le(len + 64, size);
+		memset(nh, 0, 64);
+		nh->nlmsg_type = RTM_NEWADDR;
+		nh->nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+		struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(nh);
+		ifa->ifa_family = AF_INET6;
+		ifa->ifa_prefixlen = 64;
+		ifa->ifa_index = ifindex;
+		struct in6_addr addr;
+		ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8:7::1", &addr));
+		addr.s6_addr[6] = i >> 8;
+		addr.s6_addr[7] = i;
+		netlink_attr(nh, IFA_ADDRESS, &addr, sizeof(addr));
+		len += NLMSG_ALIGN(nh->nlmsg_len);
+	}
+	return len;
+}
+
+START_TEST(test_netlink_burst)
+{
+	int const ifindex = 100002;
+	notify_iface.props.if_index = ifindex;
+	memset(&stats, 0, sizeof(stats));
+
+	static char buf[4096];
+	size_t len = burst_datagram(buf, sizeof(buf), ifindex, 0, 50);
+	int fds[2];
+	ck_assert_int_eq(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+	ck_assert_int_eq(len, send(fds[1], buf, len, 0));
+	process_netlink_msg(fds[0], &notify_iface, notify_sock);
+	close(fds[0]);
+	close(fds[1]);
+
+	/* One setup, one restart of the initial RAs, for all of them. */
+	ck_assert_int_eq(50, stats.netlink_events);
+	ck_assert_int_eq(50, stats.iface_touches);
+	ck_assert_int_eq(49, stats.iface_touches_coalesced);
+	ck_assert_int_eq(50, notify_iface.state_info.touches);
+	ck_assert_int_eq(1, notify_iface.state_info.changed);
+
+	link_notify(RTM_DELLINK, ifindex, "radvdtest2");
+}
+END_TEST
+
+START_TEST(test_netlink_overrun)
+{
+	int const ifindex = 100003;
+	memset(&stats, 0, sizeof(stats));
+	ck_assert_int_eq(0, netlink_seed_addr_table());
+
+	/* The interface is set up with what the kernel has of it. */
+	struct iface_addr const *addrs;
+	int count = netlink_iface_addrs(0, "lo", &addrs);
+	ck_assert_int_ge(count, 0);
+	notify_iface.props.if_index = if_nametoindex("lo");
+	notify_iface.props.if_addrs = calloc(count + 1, sizeof(struct in6_addr));
+	ck_assert_ptr_ne(NULL, notify_iface.props.if_addrs);
+	for (int i = 0; i < count; ++i)
+		notify_iface.props.if_addrs[i] = addrs[i].addr;
+	notify_iface.props.addrs_count = count;
+
+	/* More notifications queued than one read takes, all read at the one wakeup. */
+	static char buf[65536];
+	int fds[2];
+	ck_assert_int_eq(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+	for (int i = 0; i < 8; ++i) {
+		size_t len = burst_datagram(buf, sizeof(buf), ifindex, 150 * i, 150);
+		ck_assert_int_eq(len, send(fds[1], buf, len, 0));
+	}
+	process_netlink_msg(fds[0], &notify_iface, notify_sock);
+	ck_assert_int_eq(1200, stats.netlink_events);
+	ck_assert_int_eq(0, stats.netlink_resyncs);
+	ck_assert_int_eq(1200, netlink_iface_addrs(ifindex, NULL, &addrs));
+
+	/*
+	 * One that doesn't fit the buffer is lost: the addresses are dumped
+	 * again, which the kernel has none of for that interface.  The one
+	 * with the same addresses as before isn't set up again.
+	 */
+	size_t len = burst_datagram(buf, sizeof(buf), ifindex, 1200, 1000);
+	ck_assert_int_gt(len, 32768);
+	ck_assert_int_eq(len, send(fds[1], buf, len, 0));
+	notify_iface.state_info.touches = 0;
+	process_netlink_msg(fds[0], &notify_iface, notify_sock);
+	ck_assert_int_eq(1200, stats.netlink_events);
+	ck_assert_int_eq(1, stats.netlink_resyncs);
+	ck_assert_int_eq(0, netlink_iface_addrs(ifindex, NULL, &addrs));
+	ck_assert_int_eq(0, notify_iface.state_info.touches);
+
+	/* One whose addresses changed meanwhile is. */
+	--notify_iface.props.addrs_count;
+	ck_assert_int_eq(len, send(fds[1], buf, len, 0));
+	process_netlink_msg(fds[0], &notify_iface, notify_sock);
+	ck_assert_int_eq(2, stats.netlink_resyncs);
+	ck_assert_int_eq(1, notify_iface.state_info.touches);
+
+	/* So is one whose link came back up, with the same addresses, while the notification of it was lost. */
+	++notify_iface.props.addrs_count;
+	link_notify(RTM_NEWLINK, notify_iface.props.if_index, "lo");
+	notify_iface.state_info.ready = 1;
+	notify_iface.state_info.touches = 0;
+	ck_assert_int_eq(len, send(fds[1], buf, len, 0));
+	process_netlink_msg(fds[0], &notify_iface, notify_sock);
+	ck_assert_int_eq(3, stats.netlink_resyncs);
+	ck_assert_int_eq(1, notify_iface.state_info.touches);
+
+	free(notify_iface.props.if_addrs);
+	notify_iface.props.if_addrs = NULL;
+	notify_iface.props.addrs_count = 0;
+	close(fds[0]);
+	close(fds[1]);
+}
+END_TEST
+
+static void netlink_dump_foo(struct nlmsghdr *nh, void *data) { ++*(int *)data; }
+
+START_TEST(test_netlink_requests)
+{
+	struct Interface iface;
+	iface_init_defaults(&iface);
+	iface.props.if_index = if_nametoindex("lo");
+	ck_assert_int_eq(6, netlink_get_device_addr_len(&iface));
+
+	/* A request failing leaves nothing behind for the next one to trip over. */
+	iface.props.if_index = 0x7fffffff;
+	ck_assert_int_eq(-1, netlink_get_device_addr_len(&iface));
+	iface.props.if_index = if_nametoindex("lo");
+	ck_assert_int_eq(6, netlink_get_device_addr_len(&iface));
+
+	/* A dump the kernel refuses, with the prefix length of a header it checks strictly, isn't an empty one. */
+	int count = 0;
+	struct ifaddrmsg ifaddr = {.ifa_family = AF_INET6, .ifa_prefixlen = 1};
+	ck_assert_int_eq(-1, netlink_dump(RTM_GETADDR, &ifaddr, sizeof(ifaddr), netlink_dump_foo, &count));
+	ck_assert_int_eq(0, count);
+	ifaddr.ifa_prefixlen = 0;
+	ck_assert_int_eq(0, netlink_dump(RTM_GETADDR, &ifaddr, sizeof(ifaddr), netlink_dump_foo, &count));
+	ck_assert_int_gt(count, 0);
+
+	/* One with a header shorter than the padding after it, which the kernel checks strictly as well. */
+	count = 0;
+	struct netconfmsg ncm = {.ncm_family = AF_INET6};
+	ck_assert_int_eq(0, netlink_dump(RTM_GETNETCONF, &ncm, sizeof(ncm), netlink_dump_foo, &count));
+	ck_assert_int_gt(count, 0);
+}
+END_TEST
+Suite *netlink_suite(void)
+{
+	TCase *tc_notify = tcase_create("notify");
+	tcase_add_checked_fixture(tc_notify, notify_setup, notify_teardown);
+	tcase_add_test(tc_notify, test_netconf_forwarding);
+	tcase_add_test(tc_notify, test_netlink_addr_table);
+	tcase_add_test(tc_notify, test_netlink_prefix_lifetimes);
+	tcase_add_test(tc_notify, test_netlink_prefix_ras);
+	tcase_add_test(tc_notify, test_netlink_burst);
+	tcase_add_test(tc_notify, test_netlink_overrun);
+
+	TCase *tc_requests = tcase_create("requests");
+	tcase_add_test(tc_requests, test_netlink_requests);
+
+	Suite *s = suite_create("netlink");
+	suite_add_tcase(s, tc_notify);
+	suite_add_tcase(s, tc_requests);
+
+	return s;
+}
@@ -0,0 +1,122 @@
+
+#include <check.h>
+
+#define TEST_RECV_PACKETS 1000
+#define TEST_RECV_BURST 100 /* small enough for the default socket buffer */
+
+/* RS/RA reception is exercised over UDP on ::1 so the tests need no privileges. */
+static int recv_sock = -1;
+static int send_sock = -1;
+static struct sockaddr_in6 recv_addr;
+
+static void recv_setup(void)
+{
+	recv_sock = socket(AF_INET6, SOCK_DGRAM, 0);
+	ck_assert_int_ge(recv_sock, 0);
+	send_sock = socket(AF_INET6, SOCK_DGRAM, 0);
+	ck_assert_int_ge(send_sock, 0);
+
+	int one = 1;
+	ck_assert_int_eq(0, setsockopt(recv_sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, &one, sizeof(one)));
+	ck_assert_int_eq(0, setsockopt(recv_sock, IPPROTO_IPV6, IPV6_RECVHOPLIMIT, &one, sizeof(one)));
+
+	memset(&recv_addr, 0, sizeof(recv_addr));
+	recv_addr.sin6_family = AF_INET6;
+	recv_addr.sin6_addr = in6addr_loopback;
+	ck_assert_int_eq(0, bind(recv_sock, (struct sockaddr *)&recv_addr, sizeof(recv_addr)));
+	socklen_t len = sizeof(recv_addr);
+	ck_assert_int_eq(0, getsockname(recv_sock, (struct sockaddr *)&recv_addr, &len));
+
+	memset(&stats, 0, sizeof(stats));
+}
+
+static void recv_teardown(void)
+{
+	close(recv_sock);
+	close(send_sock);
+}
+
+static void send_rs_flood(int count)
+{
+	struct nd_router_solicit rs;
+	memset(&rs, 0, sizeof(rs));
+	rs.nd_rs_type = ND_ROUTER_SOLICIT;
+
+	for (int i = 0; i < count; ++i) {
+		ck_assert_int_eq(sizeof(rs),
+				 sendto(send_sock, &rs, sizeof(rs), 0, (struct sockaddr *)&recv_addr, sizeof(recv_addr)));
+	}
+}
+
+START_TEST(test_recv_rs_ra)
+{
+	for (int i = 0; i < TEST_RECV_PACKETS; ++i) {
+		if (i % TEST_RECV_BURST == 0)
+			send_rs_flood(TEST_RECV_BURST);
+
+		unsigned char msg[MSG_SIZE_RECV];
+		unsigned char chdr[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
+		struct sockaddr_in6 addr;
+		struct in6_pktinfo *pkt_info = NULL;
+		int hoplimit;
+
+		int len = recv_rs_ra(recv_sock, msg, &addr, &pkt_info, &hoplimit, chdr);
+		ck_assert_int_eq(sizeof(struct nd_router_solicit), len);
+		ck_assert_ptr_ne(0, pkt_info);
+		ck_assert_int_eq(ND_ROUTER_SOLICIT, msg[0]);
+	}
+
+	ck_assert_int_eq(TEST_RECV_PACKETS, stats.rx_packets);
+	ck_assert_int_eq(TEST_RECV_PACKETS, stats.rx_syscalls);
+}
+END_TEST
+
+#ifdef HAVE_RECVMMSG
+static void count_rs(unsigned char *msg, int len, struct sockaddr_in6 *addr, struct in6_pktinfo *pkt_info, int hoplimit,
+		     void *data)
+{
+	ck_assert_int_eq(sizeof(struct nd_router_solicit), len);
+	ck_assert_int_eq(ND_ROUTER_SOLICIT, msg[0]);
+	ck_assert_ptr_ne(0, pkt_info);
+	ck_assert_int_eq(AF_INET6, addr->sin6_family);
+	++*(int *)data;
+}
+
+START_TEST(test_recv_rs_ra_batch)
+{
+	int received = 0;
+	for (int i = 0; i < TEST_RECV_PACKETS; i += TEST_RECV_BURST) {
+		send_rs_flood(TEST_RECV_BURST);
+		while (received < i + TEST_RECV_BURST) {
+			ck_assert_int_gt(recv_rs_ra_batch(recv_sock, RECV_BATCH_MAX, count_rs, &received), 0);
+		}
+	}
+
+	/* One syscall per RECV_BATCH_MAX packets instead of one per packet. */
+	ck_assert_int_eq(TEST_RECV_PACKETS, received);
+	ck_assert_int_eq(TEST_RECV_PACKETS, stats.rx_packets);
+	ck_assert_int_eq(TEST_RECV_PACKETS / TEST_RECV_BURST * ((TEST_RECV_BURST + RECV_BATCH_MAX - 1) / RECV_BATCH_MAX),
+			 stats.rx_syscalls);
+
+	/* Nothing is waiting, the call must not block. */
+	ck_assert_int_eq(-1, recv_rs_ra_batch(recv_sock, RECV_BATCH_MAX, count_rs, &received));
+
+	log_stats();
+}
+END_TEST
+#endif
+
+Suite *recv_suite(void)
+{
+	TCase *tc_recv = tcase_create("recv");
+	tcase_add_checked_fixture(tc_recv, recv_setup, recv_teardown);
+	tcase_add_test(tc_recv, test_recv_rs_ra);
+#ifdef HAVE_RECVMMSG
+	tcase_add_test(tc_recv, test_recv_rs_ra_batch);
+#endif
+
+	Suite *s = suite_create("recv");
+	suite_add_tcase(s, tc_recv);
+
+	return s;
+}
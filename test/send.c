@@ -813,6 +813,901 @@ START_TEST(test_add_ra_option_abro)
 }
 END_TEST
 
+/* RAs are sent over UDP to ::1 so the tests need no privileges. */
+static int batch_sock = -1;
+static struct Interface batch_iface;
+static struct in6_addr batch_src;
+
+static void batch_setup(void)
+{
+	batch_sock = socket(AF_INET6, SOCK_DGRAM, 0);
+	ck_assert_int_ge(batch_sock, 0);
+
+	iface_init_defaults(&batch_iface);
+	strlcpy(batch_iface.props.name, "lo", sizeof(batch_iface.props.name));
+	batch_src = in6addr_any;
+	batch_iface.props.if_addr_rasrc = &batch_src;
+
+	memset(&stats, 0, sizeof(stats));
+}
+
+static void batch_teardown(void) { close(batch_sock); }
+
+START_TEST(test_send_batch)
+{
+	char ra[] = "RA";
+	struct iovec iov = {ra, 2};
+
+	send_batch_begin();
+	for (int i = 0; i < 2 * SEND_BATCH_MAX; ++i) {
+		ck_assert_int_eq(0, really_send(batch_sock, &in6addr_loopback, &batch_iface, &iov, 1));
+	}
+	/* Nested batches are sent by the outermost one only. */
+	send_batch_begin();
+	ck_assert_int_eq(0, really_send(batch_sock, &in6addr_loopback, &batch_iface, &iov, 1));
+	send_batch_end();
+	ck_assert_int_eq(2 * SEND_BATCH_MAX, stats.tx_packets);
+	send_batch_end();
+
+	ck_assert_int_eq(2 * SEND_BATCH_MAX + 1, stats.tx_packets);
+#ifdef HAVE_SENDMMSG
+	ck_assert_int_eq(3, stats.tx_syscalls);
+#endif
+	ck_assert_int_eq(0, stats.tx_errors);
+}
+END_TEST
+
+START_TEST(test_send_batch_errors)
+{
+	char ra[] = "RA";
+	struct iovec iov = {ra, 2};
+
+	/* An interface that has gone away fails on its own, the others are still sent. */
+	struct Interface missing = batch_iface;
+	missing.props.if_index = 0x7fffffff;
+	missing.IgnoreIfMissing = 1;
+
+	send_batch_begin();
+	really_send(batch_sock, &in6addr_loopback, &batch_iface, &iov, 1);
+	really_send(batch_sock, &in6addr_loopback, &missing, &iov, 1);
+	really_send(batch_sock, &in6addr_loopback, &batch_iface, &iov, 1);
+	really_send(batch_sock, &in6addr_loopback, &missing, &iov, 1);
+	send_batch_end();
+
+	ck_assert_int_eq(2, stats.tx_packets);
+	ck_assert_int_eq(2, stats.tx_errors);
+
+	/* Outside of a batch the error is returned as before. */
+	ck_assert_int_eq(-1, really_send(batch_sock, &in6addr_loopback, &missing, &iov, 1));
+	ck_assert_int_eq(ENODEV, errno);
+}
+END_TEST
+
+static struct safe_buffer cache_sent = SAFE_BUFFER_INIT;
+static size_t cache_sent_iovlen = 0;
+
+/* Gather the iovecs of an RA into sb, as sendmsg does. */
+static size_t gather_iov(struct safe_buffer *sb, struct iovec const *iov, size_t iovlen)
+{
+	sb->used = 0;
+	for (size_t i = 0; i < iovlen; ++i)
+		safe_buffer_append(sb, iov[i].iov_base, iov[i].iov_len);
+	return sb->used;
+}
+
+static ssize_t cache_transport(int sock, struct msghdr const *mhdr, int flags)
+{
+	cache_sent_iovlen = mhdr->msg_iovlen;
+	return gather_iov(&cache_sent, mhdr->msg_iov, mhdr->msg_iovlen);
+}
+
+static void cache_setup(void)
+{
+	batch_setup();
+	batch_iface.AdvSendAdvert = 1;
+	batch_iface.state_info.changed = 0;
+	batch_iface.state_info.ready = 1;
+	batch_iface.props.max_ra_option_size = RFC2460_MIN_MTU;
+	batch_iface.ra_header_info.AdvDefaultLifetime = 1800;
+
+	struct AdvPrefix *prefix = calloc(1, sizeof(struct AdvPrefix));
+	ck_assert_ptr_ne(0, prefix);
+	prefix_init_defaults(prefix);
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8::", &prefix->Prefix));
+	prefix->PrefixLen = 64;
+	prefix->curr_validlft = prefix->AdvValidLifetime;
+	prefix->curr_preferredlft = prefix->AdvPreferredLifetime;
+	batch_iface.AdvPrefixList = prefix;
+
+	/* Whatever procfs says, forwarding is on unless a test turns it off. */
+	set_ip6_forwarding(1);
+
+	struct timespec start = {1000, 0};
+	set_simulated_clock(&start);
+	set_clock_source(simulated_clock);
+	set_send_transport(cache_transport);
+	batch_iface.times.last_ra_time = start;
+}
+
+static void cache_teardown(void)
+{
+	iface_queue_remove(&batch_iface);
+	set_send_transport(NULL);
+	set_clock_source(NULL);
+	free_ra_cache(&batch_iface);
+	while (batch_iface.AdvPrefixList) {
+		struct AdvPrefix *next = batch_iface.AdvPrefixList->next;
+		free(batch_iface.AdvPrefixList);
+		batch_iface.AdvPrefixList = next;
+	}
+	safe_buffer_free(&cache_sent);
+	batch_teardown();
+}
+
+static uint32_t cache_sent_validlft(void)
+{
+	struct nd_opt_prefix_info const *pinfo =
+	    (struct nd_opt_prefix_info const *)(cache_sent.buffer + sizeof(struct nd_router_advert));
+	ck_assert_int_ge(cache_sent.used, sizeof(struct nd_router_advert) + sizeof(struct nd_opt_prefix_info));
+	ck_assert_int_eq(ND_OPT_PREFIX_INFORMATION, pinfo->nd_opt_pi_type);
+	return ntohl(pinfo->nd_opt_pi_valid_time);
+}
+
+START_TEST(test_send_ra_cache)
+{
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	struct ra_iov *ras = batch_iface.ra_cache.ras;
+	ck_assert_ptr_ne(0, ras);
+	ck_assert_int_eq(0, batch_iface.ra_cache.dynamic);
+
+	/* The header and the prefix go out as they are, without being copied together... */
+	ck_assert_int_eq(2, cache_sent_iovlen);
+	ck_assert_ptr_eq(batch_iface.ra_cache.options[0].option->buffer, ras[0].iov[1].iov_base);
+
+	/* ...and they are the same bytes as a fresh build, whatever the destination. */
+	struct ra_cache fresh = {0};
+	assemble_ras(&batch_iface, NULL, batch_iface.ra_cache.cease_adv, &fresh);
+	struct safe_buffer fresh_sent = SAFE_BUFFER_INIT;
+	ck_assert_int_eq(cache_sent.used, gather_iov(&fresh_sent, fresh.ras[0].iov, fresh.ras[0].iovlen));
+	ck_assert_int_eq(fresh.ras[0].len, fresh_sent.used);
+	ck_assert_int_eq(0, memcmp(fresh_sent.buffer, cache_sent.buffer, cache_sent.used));
+	ck_assert_int_eq(1, fresh.ra_count);
+	safe_buffer_free(&fresh_sent);
+	safe_buffer_arena_free(&fresh.arena);
+
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, &in6addr_loopback));
+	ck_assert_ptr_eq(ras, batch_iface.ra_cache.ras);
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_ptr_eq(ras, batch_iface.ra_cache.ras);
+	ck_assert_int_eq(3, stats.tx_packets);
+}
+END_TEST
+
+START_TEST(test_send_ra_cache_invalidate)
+{
+	struct AdvPrefix *prefix = batch_iface.AdvPrefixList;
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(prefix->AdvValidLifetime, cache_sent_validlft());
+
+	/* Lifetimes that don't decrement leave the RA as it is... */
+	struct timespec later = {1010, 0};
+	set_simulated_clock(&later);
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(prefix->AdvValidLifetime, cache_sent_validlft());
+
+	/* ...decremented ones change it. */
+	prefix->DecrementLifetimesFlag = 1;
+	later.tv_sec += 10;
+	set_simulated_clock(&later);
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(prefix->AdvValidLifetime - 10, cache_sent_validlft());
+
+	/* Reconfiguring the interface, and ceasing, rebuild it too. */
+	batch_iface.ra_header_info.AdvCurHopLimit = 42;
+	invalidate_ra_cache(&batch_iface);
+	ck_assert_ptr_eq(0, batch_iface.ra_cache.ras);
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(42, ((struct nd_router_advert *)cache_sent.buffer)->nd_ra_curhoplimit);
+
+	batch_iface.state_info.cease_adv = 1;
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(0, ((struct nd_router_advert *)cache_sent.buffer)->nd_ra_router_lifetime);
+}
+END_TEST
+
+START_TEST(test_send_ra_cache_own_address)
+{
+	/* A prefix holding an address of the router itself, which the kernel keeps for good. */
+	struct AdvPrefix *prefix = batch_iface.AdvPrefixList;
+	prefix->Prefix = in6addr_loopback;
+	prefix->PrefixLen = 128;
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	struct ra_iov *ras = batch_iface.ra_cache.ras;
+	ck_assert_int_eq(0, batch_iface.ra_cache.dynamic);
+	ck_assert_int_eq(prefix->AdvValidLifetime, cache_sent_validlft());
+
+	struct timespec later = {1010, 0};
+	set_simulated_clock(&later);
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_ptr_eq(ras, batch_iface.ra_cache.ras);
+}
+END_TEST
+
+START_TEST(test_send_ra_cache_batch)
+{
+	/* The RAs queued in a batch point into the cache, so they go out before it changes. */
+	send_batch_begin();
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(0, stats.tx_packets);
+
+	batch_iface.ra_header_info.AdvCurHopLimit = 42;
+	invalidate_ra_cache(&batch_iface);
+	ck_assert_int_eq(1, stats.tx_packets);
+	ck_assert_int_eq(DFLT_AdvCurHopLimit, ((struct nd_router_advert *)cache_sent.buffer)->nd_ra_curhoplimit);
+
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	send_batch_end();
+	ck_assert_int_eq(2, stats.tx_packets);
+	ck_assert_int_eq(42, ((struct nd_router_advert *)cache_sent.buffer)->nd_ra_curhoplimit);
+}
+END_TEST
+
+static struct AdvPrefix *cache_add_prefix(char const *addr, int decrement)
+{
+	struct AdvPrefix *prefix = calloc(1, sizeof(struct AdvPrefix));
+	ck_assert_ptr_ne(0, prefix);
+	prefix_init_defaults(prefix);
+	ck_assert_int_eq(1, inet_pton(AF_INET6, addr, &prefix->Prefix));
+	prefix->PrefixLen = 64;
+	prefix->DecrementLifetimesFlag = decrement;
+	prefix->AdvValidLifetime = prefix->curr_validlft = 3600;
+	prefix->AdvPreferredLifetime = prefix->curr_preferredlft = 1800;
+	prefix->next = batch_iface.AdvPrefixList;
+	batch_iface.AdvPrefixList = prefix;
+	return prefix;
+}
+
+/* The cached RAs must be byte for byte what a full rebuild makes. */
+static void assert_ra_cache_fresh(void)
+{
+	struct ra_cache fresh = {0};
+	assemble_ras(&batch_iface, NULL, batch_iface.ra_cache.cease_adv, &fresh);
+
+	ck_assert_int_eq(fresh.ra_count, batch_iface.ra_cache.ra_count);
+	struct safe_buffer ra = SAFE_BUFFER_INIT;
+	struct safe_buffer fresh_ra = SAFE_BUFFER_INIT;
+	for (size_t i = 0; i < fresh.ra_count; ++i) {
+		gather_iov(&ra, batch_iface.ra_cache.ras[i].iov, batch_iface.ra_cache.ras[i].iovlen);
+		gather_iov(&fresh_ra, fresh.ras[i].iov, fresh.ras[i].iovlen);
+		ck_assert_int_eq(fresh_ra.used, ra.used);
+		ck_assert_int_eq(batch_iface.ra_cache.ras[i].len, ra.used);
+		ck_assert_int_eq(0, memcmp(fresh_ra.buffer, ra.buffer, ra.used));
+	}
+	ck_assert_int_eq(fresh.option_count, batch_iface.ra_cache.option_count);
+
+	safe_buffer_free(&ra);
+	safe_buffer_free(&fresh_ra);
+	safe_buffer_arena_free(&fresh.arena);
+}
+
+/* The valid lifetime of the prefix in each of the RAs sent, with whom to. */
+static uint32_t clients_validlft[16];
+static struct in6_addr clients_dest[16];
+static int clients_sent;
+
+static ssize_t clients_transport(int sock, struct msghdr const *mhdr, int flags)
+{
+	ssize_t len = cache_transport(sock, mhdr, flags);
+	ck_assert_int_lt(clients_sent, 16);
+	clients_validlft[clients_sent] = cache_sent_validlft();
+	clients_dest[clients_sent++] = ((struct sockaddr_in6 const *)mhdr->msg_name)->sin6_addr;
+	return len;
+}
+
+START_TEST(test_send_ra_clients)
+{
+	struct Clients clients[3];
+	memset(clients, 0, sizeof(clients));
+	for (int i = 0; i < 3; ++i) {
+		clients[i].Address = in6addr_loopback;
+		clients[i].Address.s6_addr[0] = 0xfe;
+		clients[i].Address.s6_addr[1] = 0x80;
+		clients[i].Address.s6_addr[14] = i + 1;
+		clients[i].next = i < 2 ? &clients[i + 1] : NULL;
+	}
+	clients[1].ignored = 1;
+	batch_iface.ClientList = clients;
+
+	struct AdvPrefix *prefix = batch_iface.AdvPrefixList;
+	prefix->DecrementLifetimesFlag = 1;
+	set_send_transport(clients_transport);
+
+	/* A tick every 10.6 seconds: the lifetimes go down by the whole of it, the fractions are not lost. */
+	struct timespec now = {1000, 0};
+	for (int tick = 1; tick <= 10; ++tick) {
+		now.tv_sec += 10 + (now.tv_nsec + 600000000) / 1000000000;
+		now.tv_nsec = (now.tv_nsec + 600000000) % 1000000000;
+		set_simulated_clock(&now);
+
+		/* The RA is built once a tick, for all of the clients, and it's the same for all of them. */
+		uint32_t generation = batch_iface.ra_cache.generation;
+		invalidate_ra_cache(&batch_iface);
+		clients_sent = 0;
+		ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, NULL));
+		ck_assert_int_eq(generation + 1, batch_iface.ra_cache.generation);
+
+		ck_assert_int_eq(2, clients_sent);
+		ck_assert(IN6_ARE_ADDR_EQUAL(&clients[0].Address, &clients_dest[0]));
+		ck_assert(IN6_ARE_ADDR_EQUAL(&clients[2].Address, &clients_dest[1]));
+		ck_assert_int_eq(clients_validlft[0], clients_validlft[1]);
+		ck_assert_int_eq(prefix->AdvValidLifetime - tick * 106 / 10, clients_validlft[0]);
+	}
+	ck_assert_int_eq(20, stats.tx_packets);
+
+	/* A client soliciting gets the same RA, without the lifetimes going down any further. */
+	clients_sent = 0;
+	ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, &clients[2].Address));
+	ck_assert_int_eq(1, clients_sent);
+	ck_assert_int_eq(prefix->AdvValidLifetime - 106, clients_validlft[0]);
+
+	batch_iface.ClientList = NULL;
+}
+END_TEST
+
+START_TEST(test_send_ra_cache_patch)
+{
+	/* The 2001:db8::/64 of the fixture does not decrement. */
+	struct AdvPrefix *short_lived = cache_add_prefix("2001:db8:1::", 1);
+	short_lived->curr_preferredlft = 150;
+	cache_add_prefix("2001:db8:2::", 1);
+	cache_add_prefix("2001:db8:3::", 1);
+
+	struct NAT64Prefix nat64;
+	memset(&nat64, 0, sizeof(nat64));
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "64:ff9b::", &nat64.Prefix));
+	nat64.PrefixLen = 96;
+	nat64.AdvValidLifetime = nat64.curr_validlft = 1800;
+	batch_iface.NAT64PrefixList = &nat64;
+
+	/* two prefixes per RA */
+	batch_iface.props.max_ra_option_size = sizeof(struct nd_router_advert) + 2 * sizeof(struct nd_opt_prefix_info);
+
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	struct ra_iov *ras = batch_iface.ra_cache.ras;
+	ck_assert_int_gt(batch_iface.ra_cache.ra_count, 1);
+	ck_assert_int_eq(5, batch_iface.ra_cache.option_count);
+	assert_ra_cache_fresh();
+
+	/* Decremented lifetimes are written over the cached RAs. */
+	struct timespec later = {1100, 0};
+	set_simulated_clock(&later);
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_ptr_eq(ras, batch_iface.ra_cache.ras);
+	ck_assert_int_eq(50, short_lived->curr_preferredlft);
+	assert_ra_cache_fresh();
+
+	/* So are the router lifetime and the NAT64 lifetime. */
+	ck_assert_int_eq(0, patch_ra_cache(&batch_iface, !batch_iface.ra_cache.cease_adv));
+	assert_ra_cache_fresh();
+	nat64.curr_validlft = 17;
+	ck_assert_int_eq(0, patch_ra_cache(&batch_iface, batch_iface.ra_cache.cease_adv));
+	assert_ra_cache_fresh();
+
+	/* A prefix that runs out leaves its RA, so they are built again. */
+	later.tv_sec += 60;
+	set_simulated_clock(&later);
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(0, short_lived->curr_preferredlft);
+	ck_assert_int_eq(4, batch_iface.ra_cache.option_count);
+	assert_ra_cache_fresh();
+
+	batch_iface.NAT64PrefixList = NULL;
+}
+END_TEST
+
+START_TEST(test_send_ra_arena)
+{
+	cache_add_prefix("2001:db8:1::", 0);
+
+	struct in6_addr rdnss_addr = in6addr_loopback;
+	struct AdvRDNSS rdnss;
+	rdnss_init_defaults(&rdnss, &batch_iface);
+	rdnss.AdvRDNSSNumber = 1;
+	rdnss.AdvRDNSSAddr = &rdnss_addr;
+	batch_iface.AdvRDNSSList = &rdnss;
+
+	char *suffixes[] = {"branch.example.com", "example.com"};
+	struct AdvDNSSL dnssl;
+	memset(&dnssl, 0, sizeof(dnssl));
+	dnssl.AdvDNSSLLifetime = 1000;
+	dnssl.AdvDNSSLNumber = 2;
+	dnssl.AdvDNSSLSuffixes = suffixes;
+	batch_iface.AdvDNSSLList = &dnssl;
+
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	size_t allocations = batch_iface.ra_cache.arena.allocations;
+	ck_assert_int_gt(allocations, 0);
+
+	/* Rebuilding the RA each time, as for lifetimes that can't be cached, takes nothing from the heap either. */
+	for (int i = 0; i < 100; ++i) {
+		invalidate_ra_cache(&batch_iface);
+		ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	}
+	ck_assert_int_eq(allocations, batch_iface.ra_cache.arena.allocations);
+	ck_assert_int_eq(101, stats.tx_packets);
+	assert_ra_cache_fresh();
+
+	batch_iface.AdvRDNSSList = NULL;
+	batch_iface.AdvDNSSLList = NULL;
+}
+END_TEST
+
+/* How many RAs the options of count sizes take packed in that order, closing an RA on the first that doesn't fit. */
+static size_t in_order_ra_count(size_t const *sizes, size_t count, size_t room)
+{
+	size_t ra_count = 0;
+	size_t left = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (ra_count == 0 || sizes[i] > left) {
+			++ra_count;
+			left = room;
+		}
+		left = sizes[i] > left ? 0 : left - sizes[i];
+	}
+	return ra_count;
+}
+
+/* Each descriptor finds its options present, and build_ra_options encodes them. */
+START_TEST(test_ra_option_descs)
+{
+	struct NAT64Prefix nat64;
+	memset(&nat64, 0, sizeof(nat64));
+	nat64.PrefixLen = 96;
+	batch_iface.NAT64PrefixList = &nat64;
+
+	struct AdvRoute routes[3];
+	for (int i = 0; i < 3; ++i) {
+		route_init_defaults(&routes[i], &batch_iface);
+		routes[i].PrefixLen = i * 48;
+		routes[i].next = i < 2 ? &routes[i + 1] : NULL;
+	}
+	batch_iface.AdvRouteList = routes;
+
+	struct in6_addr rdnss_addrs[2] = {in6addr_loopback, in6addr_loopback};
+	struct AdvRDNSS rdnss;
+	rdnss_init_defaults(&rdnss, &batch_iface);
+	rdnss.AdvRDNSSNumber = 2;
+	rdnss.AdvRDNSSAddr = rdnss_addrs;
+	batch_iface.AdvRDNSSList = &rdnss;
+
+	char *suffixes[] = {"example.com.", "a..b", "branch.example.com"};
+	struct AdvDNSSL dnssl;
+	memset(&dnssl, 0, sizeof(dnssl));
+	dnssl.AdvDNSSLNumber = 3;
+	dnssl.AdvDNSSLSuffixes = suffixes;
+	batch_iface.AdvDNSSLList = &dnssl;
+
+	struct AdvLowpanCo lowpanco;
+	memset(&lowpanco, 0, sizeof(lowpanco));
+	struct AdvAbro abro;
+	memset(&abro, 0, sizeof(abro));
+	batch_iface.AdvLowpanCoList = &lowpanco;
+	batch_iface.AdvAbroList = &abro;
+
+	batch_iface.AdvLinkMTU = 1500;
+	batch_iface.AdvSourceLLAddress = 1;
+	batch_iface.sllao.if_hwaddr_len = 48;
+	batch_iface.mipv6.AdvIntervalOpt = 1;
+	batch_iface.mipv6.AdvHomeAgentInfo = 1;
+	batch_iface.mipv6.HomeAgentPreference = 1;
+	char capport[] = "https://portal.example.com/api";
+	batch_iface.AdvCaptivePortalAPI = capport;
+
+	struct safe_buffer_arena arena = {0};
+	size_t sizes[256] = {0};
+	for (struct safe_buffer_list *cur = build_ra_options(&batch_iface, NULL, &arena); cur; cur = cur->next) {
+		ck_assert_int_gt(cur->sb->used, 0);
+		sizes[cur->sb->buffer[0]] += cur->sb->used;
+	}
+	safe_buffer_arena_free(&arena);
+
+	for (size_t i = 0; i < sizeof(ra_option_descs) / sizeof(ra_option_descs[0]); ++i) {
+		struct ra_option_desc const *desc = &ra_option_descs[i];
+		ck_assert_msg(desc->present(&batch_iface), "option %d missing", desc->type);
+		ck_assert_msg(sizes[desc->type] > 0, "option %d not built", desc->type);
+		ck_assert_ptr_eq(desc, find_option_desc(desc->type));
+	}
+
+	batch_iface.NAT64PrefixList = NULL;
+	batch_iface.AdvRouteList = NULL;
+	batch_iface.AdvRDNSSList = NULL;
+	batch_iface.AdvDNSSLList = NULL;
+	batch_iface.AdvLowpanCoList = NULL;
+	batch_iface.AdvAbroList = NULL;
+	batch_iface.AdvCaptivePortalAPI = NULL;
+}
+END_TEST
+
+START_TEST(test_plan_ras)
+{
+	struct safe_buffer_arena arena = {0};
+	size_t ra_of[8];
+
+	/* In order, 60, 50 + 40 and 50 take three RAs; planned, 60 + 40 and 50 + 50 take two. */
+	size_t sizes[] = {60, 50, 40, 50};
+	ck_assert_int_eq(3, in_order_ra_count(sizes, 4, 100));
+	ck_assert_int_eq(2, plan_ras(sizes, 4, 100, ra_of, &arena));
+	ck_assert_int_eq(0, ra_of[0]);
+	ck_assert_int_eq(1, ra_of[1]);
+	ck_assert_int_eq(0, ra_of[2]);
+	ck_assert_int_eq(1, ra_of[3]);
+
+	/* An option that doesn't fit in any RA is sent alone. */
+	size_t oversized[] = {8, 150, 8};
+	ck_assert_int_eq(2, plan_ras(oversized, 3, 100, ra_of, &arena));
+	ck_assert_int_eq(0, ra_of[1]);
+	ck_assert_int_eq(1, ra_of[0]);
+	ck_assert_int_eq(1, ra_of[2]);
+
+	/* First-fit decreasing would take three RAs where the order they were built in takes two. */
+	size_t in_order[] = {30, 50, 20, 20, 60, 20};
+	ck_assert_int_eq(2, plan_ras(in_order, 6, 100, ra_of, &arena));
+	ck_assert_int_eq(0, ra_of[2]);
+	ck_assert_int_eq(1, ra_of[3]);
+
+	ck_assert_int_eq(0, plan_ras(sizes, 0, 100, ra_of, &arena));
+
+	safe_buffer_arena_free(&arena);
+}
+END_TEST
+
+/*
+ * Links with many prefixes and routes, and a few larger RDNSS and DNSSL
+ * options, with the RAs they take packed in the order the options are
+ * built and as planned.  Each link has the 2001:db8::/64 of the fixture
+ * on top of its prefixes.
+ */
+static struct packing_link {
+	int prefixes;
+	int routes;
+	int rdnss_addrs[3];    /* of each RDNSS option, 0 for none */
+	int dnssl_suffixes[2]; /* of each DNSSL option, 0 for none */
+	unsigned int max_ra_option_size;
+	size_t in_order_ras;
+	size_t planned_ras;
+} const packing_corpus[] = {
+    {0, 0, {0, 0, 0}, {0, 0}, RFC2460_MIN_MTU, 1, 1},
+    {6, 9, {3, 0, 0}, {4, 0}, RFC2460_MIN_MTU, 1, 1},
+    {24, 45, {3, 12, 0}, {4, 12}, 1500, 2, 2},
+    {30, 0, {2, 20, 40}, {4, 12}, RFC2460_MIN_MTU, 3, 2},
+    {42, 72, {0, 0, 0}, {0, 0}, RFC2460_MIN_MTU, 3, 2},
+    {48, 36, {3, 0, 0}, {4, 12}, RFC2460_MIN_MTU, 3, 2},
+    {54, 63, {2, 20, 40}, {0, 0}, RFC2460_MIN_MTU, 4, 3},
+    {60, 99, {2, 20, 40}, {4, 12}, RFC2460_MIN_MTU, 5, 4},
+    {60, 99, {2, 20, 40}, {4, 12}, 1500, 4, 4},
+};
+
+static void check_packing_link(struct packing_link const *link)
+{
+	static char *const suffix_pool[] = {
+	    "example.com",	      "branch.example.com",    "corp.example.net",	"lab.example.org",
+	    "a.b.c.example.com",     "sales.eu.example.com",  "printers.example.com", "x.example",
+	    "eng.example.com",	      "ops.us.example.net",    "voice.example.org",	"guest.example.com",
+	    "iot.branch.example.com", "backup.dc.example.net", "mail.example.com",	"y.example",
+	};
+	struct AdvPrefix *fixture_prefix = batch_iface.AdvPrefixList;
+	memset(&stats, 0, sizeof(stats));
+	invalidate_ra_cache(&batch_iface);
+
+	char addr[INET6_ADDRSTRLEN];
+	for (int i = 0; i < link->prefixes; ++i) {
+		snprintf(addr, sizeof(addr), "2001:db8:%x::", i + 1);
+		cache_add_prefix(addr, 0);
+	}
+
+	struct AdvRoute routes[100];
+	ck_assert_int_le(link->routes, 100);
+	for (int i = 0; i < link->routes; ++i) {
+		route_init_defaults(&routes[i], &batch_iface);
+		snprintf(addr, sizeof(addr), "2001:db8:8%03x::", i);
+		ck_assert_int_eq(1, inet_pton(AF_INET6, addr, &routes[i].Prefix));
+		routes[i].PrefixLen = 48;
+		routes[i].next = i + 1 < link->routes ? &routes[i + 1] : NULL;
+	}
+	batch_iface.AdvRouteList = link->routes ? routes : NULL;
+
+	struct in6_addr rdnss_addrs[40];
+	struct AdvRDNSS rdnss[3];
+	batch_iface.AdvRDNSSList = NULL;
+	for (int i = 0; i < 40; ++i)
+		rdnss_addrs[i] = in6addr_loopback;
+	for (int i = 2; i >= 0; --i) {
+		if (!link->rdnss_addrs[i])
+			continue;
+		ck_assert_int_le(link->rdnss_addrs[i], 40);
+		rdnss_init_defaults(&rdnss[i], &batch_iface);
+		rdnss[i].AdvRDNSSNumber = link->rdnss_addrs[i];
+		rdnss[i].AdvRDNSSAddr = rdnss_addrs;
+		rdnss[i].next = batch_iface.AdvRDNSSList;
+		batch_iface.AdvRDNSSList = &rdnss[i];
+	}
+
+	struct AdvDNSSL dnssl[2];
+	batch_iface.AdvDNSSLList = NULL;
+	for (int i = 1; i >= 0; --i) {
+		if (!link->dnssl_suffixes[i])
+			continue;
+		ck_assert_int_le(link->dnssl_suffixes[i], 16);
+		memset(&dnssl[i], 0, sizeof(dnssl[i]));
+		dnssl[i].AdvDNSSLLifetime = 1000;
+		dnssl[i].AdvDNSSLNumber = link->dnssl_suffixes[i];
+		dnssl[i].AdvDNSSLSuffixes = (char **)suffix_pool + i * (16 - link->dnssl_suffixes[i]);
+		dnssl[i].next = batch_iface.AdvDNSSLList;
+		batch_iface.AdvDNSSLList = &dnssl[i];
+	}
+
+	batch_iface.props.max_ra_option_size = link->max_ra_option_size;
+	ck_assert_int_eq(0, send_ra(batch_sock, &batch_iface, NULL));
+	struct ra_cache const *cache = &batch_iface.ra_cache;
+
+	/* The same options in the order they are built, to count the RAs they take that way. */
+	struct safe_buffer_arena arena = {0};
+	size_t sizes[256];
+	size_t option_count = 0;
+	size_t option_bytes = 0;
+	for (struct safe_buffer_list *cur = build_ra_options(&batch_iface, NULL, &arena); cur; cur = cur->next) {
+		ck_assert_int_lt(option_count, 256);
+		sizes[option_count++] = cur->sb->used;
+		option_bytes += cur->sb->used;
+	}
+	safe_buffer_arena_free(&arena);
+	size_t room = link->max_ra_option_size - sizeof(struct nd_router_advert);
+	ck_assert_int_eq(link->in_order_ras, in_order_ra_count(sizes, option_count, room));
+
+	/* Never more RAs, so never more bytes on the link, and still all of the options, each RA within the MTU. */
+	ck_assert_int_eq(link->planned_ras, cache->ra_count);
+	size_t bytes = 0;
+	size_t iovecs = 0;
+	for (size_t i = 0; i < cache->ra_count; ++i) {
+		ck_assert_int_le(cache->ras[i].len, link->max_ra_option_size);
+		bytes += cache->ras[i].len;
+		iovecs += cache->ras[i].iovlen - 1;
+	}
+	ck_assert_int_eq(option_count, iovecs);
+	ck_assert_int_eq(cache->ra_count * sizeof(struct nd_router_advert) + option_bytes, bytes);
+	ck_assert_int_eq(cache->ra_count, stats.tx_packets);
+
+	batch_iface.AdvRouteList = NULL;
+	batch_iface.AdvRDNSSList = NULL;
+	batch_iface.AdvDNSSLList = NULL;
+	while (batch_iface.AdvPrefixList != fixture_prefix) {
+		struct AdvPrefix *next = batch_iface.AdvPrefixList->next;
+		free(batch_iface.AdvPrefixList);
+		batch_iface.AdvPrefixList = next;
+	}
+}
+
+START_TEST(test_send_ra_packing)
+{
+	for (size_t i = 0; i < sizeof(packing_corpus) / sizeof(packing_corpus[0]); ++i) {
+		check_packing_link(&packing_corpus[i]);
+	}
+}
+END_TEST
+
+/*
+ * An hour of RAs on a link with long lived options, each one keyed by its
+ * type and, for the prefixes, its prefix, with the lifetime it's refreshed
+ * against: that of the option, or the router's for the MTU.
+ */
+struct sched_option {
+	unsigned char type;
+	struct in6_addr prefix;
+	uint32_t lifetime;
+	struct timespec last_seen;
+	int seen;
+};
+
+static struct sched_option sched_options[16];
+static size_t sched_option_count;
+static size_t sched_bytes;
+static size_t sched_multicast_ras;
+static size_t sched_last_ra_len;
+
+static struct sched_option *sched_find_option(unsigned char const *opt)
+{
+	struct in6_addr prefix = in6addr_any;
+	if (opt[0] == ND_OPT_PREFIX_INFORMATION)
+		memcpy(&prefix, opt + offsetof(struct nd_opt_prefix_info, nd_opt_pi_prefix), sizeof(prefix));
+
+	for (size_t i = 0; i < sched_option_count; ++i) {
+		if (sched_options[i].type == opt[0] && IN6_ARE_ADDR_EQUAL(&sched_options[i].prefix, &prefix))
+			return &sched_options[i];
+	}
+
+	ck_assert_int_lt(sched_option_count, sizeof(sched_options) / sizeof(sched_options[0]));
+	struct sched_option *option = &sched_options[sched_option_count++];
+	memset(option, 0, sizeof(*option));
+	option->type = opt[0];
+	option->prefix = prefix;
+	return option;
+}
+
+/* Counts the bytes sent, and checks that no option of the multicast RAs goes over a third of its lifetime unsent. */
+static ssize_t sched_transport(int sock, struct msghdr const *mhdr, int flags)
+{
+	size_t len = gather_iov(&cache_sent, mhdr->msg_iov, mhdr->msg_iovlen);
+	sched_bytes += len;
+	sched_last_ra_len = len;
+
+	struct sockaddr_in6 const *addr = mhdr->msg_name;
+	if (!IN6_IS_ADDR_MULTICAST(&addr->sin6_addr))
+		return len;
+	++sched_multicast_ras;
+
+	struct timespec now;
+	clock_now(&now);
+	for (size_t off = sizeof(struct nd_router_advert); off + 2 <= len && cache_sent.buffer[off + 1];
+	     off += cache_sent.buffer[off + 1] * 8) {
+		unsigned char const *opt = cache_sent.buffer + off;
+		struct sched_option *option = sched_find_option(opt);
+
+		uint32_t lifetime = batch_iface.ra_header_info.AdvDefaultLifetime;
+		if (opt[0] == ND_OPT_PREFIX_INFORMATION)
+			memcpy(&lifetime, opt + offsetof(struct nd_opt_prefix_info, nd_opt_pi_preferred_time), sizeof(lifetime));
+		else if (opt[0] != ND_OPT_MTU)
+			memcpy(&lifetime, opt + 4, sizeof(lifetime));
+		if (opt[0] != ND_OPT_MTU)
+			lifetime = ntohl(lifetime);
+
+		if (option->seen)
+			ck_assert_int_le(timespecdiff(&now, &option->last_seen), option->lifetime * 1000 / MIN_OPTION_REFRESHES);
+		option->lifetime = lifetime;
+		option->last_seen = now;
+		option->seen = 1;
+	}
+
+	return len;
+}
+
+static struct in6_addr sched_rdnss_addr;
+static struct AdvRDNSS sched_rdnss;
+static struct AdvDNSSL sched_dnssl;
+static struct AdvRoute sched_route;
+static char *sched_suffixes[] = {"branch.example.com", "example.com"};
+
+static void schedule_setup(void)
+{
+	cache_setup();
+	set_send_transport(sched_transport);
+
+	batch_iface.MaxRtrAdvInterval = 60;
+	batch_iface.ra_header_info.AdvDefaultLifetime = 1800;
+	batch_iface.AdvLinkMTU = 1500;
+	cache_add_prefix("2001:db8:1::", 0);
+	cache_add_prefix("2001:db8:2::", 0);
+
+	sched_rdnss_addr = in6addr_loopback;
+	rdnss_init_defaults(&sched_rdnss, &batch_iface);
+	sched_rdnss.AdvRDNSSLifetime = 1200;
+	sched_rdnss.AdvRDNSSNumber = 1;
+	sched_rdnss.AdvRDNSSAddr = &sched_rdnss_addr;
+	batch_iface.AdvRDNSSList = &sched_rdnss;
+
+	memset(&sched_dnssl, 0, sizeof(sched_dnssl));
+	sched_dnssl.AdvDNSSLLifetime = 1800;
+	sched_dnssl.AdvDNSSLNumber = 2;
+	sched_dnssl.AdvDNSSLSuffixes = sched_suffixes;
+	batch_iface.AdvDNSSLList = &sched_dnssl;
+
+	/* The default route lifetime is three RA intervals, that one goes in every RA. */
+	route_init_defaults(&sched_route, &batch_iface);
+	ck_assert_int_eq(1, inet_pton(AF_INET6, "2001:db8:ff::", &sched_route.Prefix));
+	sched_route.PrefixLen = 48;
+	batch_iface.AdvRouteList = &sched_route;
+}
+
+static void schedule_teardown(void)
+{
+	free_option_schedules(&batch_iface);
+	batch_iface.AdvRDNSSList = NULL;
+	batch_iface.AdvDNSSLList = NULL;
+	batch_iface.AdvRouteList = NULL;
+	cache_teardown();
+}
+
+/* Sends the multicast RAs of an hour, one each MaxRtrAdvInterval, and an RS answered halfway, returns the bytes sent. */
+static size_t sched_hour(int scheduling)
+{
+	invalidate_ra_cache(&batch_iface);
+	free_option_schedules(&batch_iface);
+	batch_iface.AdvOptionScheduling = scheduling;
+	sched_option_count = 0;
+	sched_bytes = 0;
+	sched_multicast_ras = 0;
+
+	struct timespec now = {1000, 0};
+	set_simulated_clock(&now);
+	batch_iface.times.last_ra_time = now;
+
+	ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, NULL));
+	size_t full_len = sched_last_ra_len;
+	ck_assert_int_eq(1, batch_iface.ra_cache.ra_count);
+
+	for (int t = 60; t <= 3600; t += 60) {
+		now.tv_sec = 1000 + t;
+		set_simulated_clock(&now);
+		ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, NULL));
+
+		/* The initial RAs carry all of the options, as does the RA answering an RS. */
+		if (t < MAX_INITIAL_RTR_ADVERTISEMENTS * 60)
+			ck_assert_int_eq(full_len, sched_last_ra_len);
+		if (t == 1800) {
+			struct in6_addr host = in6addr_loopback;
+			ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, &host));
+			ck_assert_int_eq(full_len, sched_last_ra_len);
+		}
+		if (t == 2400) {
+			batch_iface.state_info.solicited = 1;
+			ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, NULL));
+			ck_assert_int_eq(full_len, sched_last_ra_len);
+		}
+	}
+
+	/* Each option went out in time, to the end of the hour. */
+	ck_assert_int_eq(7, sched_option_count);
+	for (size_t i = 0; i < sched_option_count; ++i) {
+		ck_assert_int_le(timespecdiff(&now, &sched_options[i].last_seen),
+				 sched_options[i].lifetime * 1000 / MIN_OPTION_REFRESHES);
+	}
+	ck_assert_int_eq(62, sched_multicast_ras);
+	ck_assert_int_eq(63, stats.tx_packets);
+	ck_assert_int_eq(0, stats.tx_errors);
+	memset(&stats, 0, sizeof(stats));
+
+	return sched_bytes;
+}
+
+START_TEST(test_send_ra_schedule)
+{
+	size_t blasted = sched_hour(0);
+	ck_assert_ptr_eq(0, batch_iface.schedules);
+
+	size_t scheduled = sched_hour(1);
+
+	/* Only the multicast destination is kept, the host that sent the RS isn't. */
+	ck_assert_ptr_ne(0, batch_iface.schedules);
+	ck_assert_ptr_eq(0, batch_iface.schedules->next);
+	ck_assert(IN6_IS_ADDR_MULTICAST(&batch_iface.schedules->dest));
+
+	/* RFC 7772: the long lived options are refreshed a few times a lifetime, not in every RA. */
+	ck_assert_int_lt(scheduled * 2, blasted);
+}
+END_TEST
+
+START_TEST(test_send_ra_schedule_rebuild)
+{
+	batch_iface.AdvOptionScheduling = 1;
+	for (int i = 0; i < MAX_INITIAL_RTR_ADVERTISEMENTS + 1; ++i)
+		ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, NULL));
+	size_t short_len = sched_last_ra_len;
+
+	/* A rebuilt cache keeps the schedule of the options still there, a new one is sent at once. */
+	cache_add_prefix("2001:db8:3::", 0);
+	invalidate_ra_cache(&batch_iface);
+	ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(short_len + sizeof(struct nd_opt_prefix_info), sched_last_ra_len);
+	ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(short_len, sched_last_ra_len);
+
+	/* Ceasing, the zeroed lifetimes all go out. */
+	batch_iface.state_info.cease_adv = 1;
+	ck_assert_int_eq(0, send_ra_forall(batch_sock, &batch_iface, NULL));
+	ck_assert_int_eq(1, batch_iface.ra_cache.cease_adv);
+	ck_assert_int_eq(batch_iface.ra_cache.ras[0].len, sched_last_ra_len);
+}
+END_TEST
+
 Suite *send_suite(void)
 {
 	TCase *tc_update = tcase_create("update");
@@ -840,9 +1735,39 @@ Suite *send_suite(void)
 	tcase_add_test(tc_build, test_add_ra_option_lowpanco);
 	tcase_add_test(tc_build, test_add_ra_option_abro);
 
+	TCase *tc_batch = tcase_create("batch");
+	tcase_add_checked_fixture(tc_batch, batch_setup, batch_teardown);
+	tcase_add_test(tc_batch, test_send_batch);
+	tcase_add_test(tc_batch, test_send_batch_errors);
+
+	TCase *tc_cache = tcase_create("cache");
+	tcase_add_checked_fixture(tc_cache, cache_setup, cache_teardown);
+	tcase_add_test(tc_cache, test_send_ra_cache);
+	tcase_add_test(tc_cache, test_send_ra_cache_invalidate);
+	tcase_add_test(tc_cache, test_send_ra_cache_own_address);
+	tcase_add_test(tc_cache, test_send_ra_cache_batch);
+	tcase_add_test(tc_cache, test_send_ra_cache_patch);
+	tcase_add_test(tc_cache, test_send_ra_clients);
+	tcase_add_test(tc_cache, test_send_ra_arena);
+
+	TCase *tc_packing = tcase_create("packing");
+	tcase_add_checked_fixture(tc_packing, cache_setup, cache_teardown);
+	tcase_add_test(tc_packing, test_ra_option_descs);
+	tcase_add_test(tc_packing, test_plan_ras);
+	tcase_add_test(tc_packing, test_send_ra_packing);
+
+	TCase *tc_schedule = tcase_create("schedule");
+	tcase_add_checked_fixture(tc_schedule, schedule_setup, schedule_teardown);
+	tcase_add_test(tc_schedule, test_send_ra_schedule);
+	tcase_add_test(tc_schedule, test_send_ra_schedule_rebuild);
+
 	Suite *s = suite_create("send");
 	suite_add_tcase(s, tc_update);
 	suite_add_tcase(s, tc_build);
+	suite_add_tcase(s, tc_batch);
+	suite_add_tcase(s, tc_cache);
+	suite_add_tcase(s, tc_packing);
+	suite_add_tcase(s, tc_schedule);
 
 	return s;
 }
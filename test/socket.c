@@ -0,0 +1,167 @@
+
+#include <check.h>
+#include <poll.h>
+
+#ifdef HAVE_LINUX_FILTER_H
+#define PREFILTER_ACCEPT 0xffffffff
+#define PREFILTER_DROP 0
+#define PREFILTER_INVALID 1
+
+/*
+ * Raw ICMPv6 sockets need privileges, so the prefilter is checked by
+ * running it here on a minimal interpreter of the instructions it uses.
+ */
+static uint32_t run_prefilter(struct ip6_hdr const *ip6, unsigned char const *icmp, uint32_t len)
+{
+	uint32_t a = 0;
+	unsigned char const *net = (unsigned char const *)ip6;
+
+	for (size_t pc = 0; pc < sizeof(icmpv6_prefilter) / sizeof(icmpv6_prefilter[0]); ++pc) {
+		struct sock_filter const *f = &icmpv6_prefilter[pc];
+		unsigned char const *p = f->k >= (uint32_t)SKF_NET_OFF ? net + (f->k - SKF_NET_OFF) : icmp + f->k;
+
+		switch (f->code) {
+		case BPF_LD | BPF_B | BPF_ABS:
+			a = p[0];
+			break;
+		case BPF_LD | BPF_H | BPF_ABS:
+			a = (p[0] << 8) | p[1];
+			break;
+		case BPF_LD | BPF_W | BPF_LEN:
+			a = len;
+			break;
+		case BPF_ALU | BPF_AND | BPF_K:
+			a &= f->k;
+			break;
+		case BPF_JMP | BPF_JEQ | BPF_K:
+			pc += (a == f->k) ? f->jt : f->jf;
+			break;
+		case BPF_JMP | BPF_JGE | BPF_K:
+			pc += (a >= f->k) ? f->jt : f->jf;
+			break;
+		case BPF_RET | BPF_K:
+			return f->k;
+		default:
+			/* not an instruction the prefilter is meant to use */
+			return PREFILTER_INVALID;
+		}
+	}
+
+	return PREFILTER_INVALID;
+}
+
+static struct ip6_hdr prefilter_ip6;
+static unsigned char prefilter_icmp[sizeof(struct nd_router_advert)];
+
+static void prefilter_packet(int type, char const *src)
+{
+	memset(&prefilter_ip6, 0, sizeof(prefilter_ip6));
+	prefilter_ip6.ip6_hlim = 255;
+	ck_assert_int_eq(1, inet_pton(AF_INET6, src, &prefilter_ip6.ip6_src));
+
+	memset(prefilter_icmp, 0, sizeof(prefilter_icmp));
+	prefilter_icmp[0] = type;
+}
+
+START_TEST(test_prefilter_rs)
+{
+	prefilter_packet(ND_ROUTER_SOLICIT, "2001:db8::1");
+	ck_assert_uint_eq(PREFILTER_ACCEPT, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_solicit)));
+
+	/* truncated */
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct icmp6_hdr) - 1));
+
+	/* not from a neighbor */
+	prefilter_ip6.ip6_hlim = 64;
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_solicit)));
+
+	/* invalid code */
+	prefilter_packet(ND_ROUTER_SOLICIT, "::");
+	prefilter_icmp[1] = 1;
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_solicit)));
+}
+END_TEST
+
+START_TEST(test_prefilter_ra)
+{
+	prefilter_packet(ND_ROUTER_ADVERT, "fe80::1");
+	ck_assert_uint_eq(PREFILTER_ACCEPT, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_advert)));
+
+	/* truncated */
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_solicit)));
+
+	/* not from a neighbor */
+	prefilter_ip6.ip6_hlim = 254;
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_advert)));
+
+	/* non-link-local sources */
+	prefilter_packet(ND_ROUTER_ADVERT, "2001:db8::1");
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_advert)));
+	prefilter_packet(ND_ROUTER_ADVERT, "fec0::1");
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_advert)));
+}
+END_TEST
+
+START_TEST(test_prefilter_other)
+{
+	prefilter_packet(ICMP6_ECHO_REQUEST, "fe80::1");
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_advert)));
+	prefilter_packet(ND_NEIGHBOR_SOLICIT, "fe80::1");
+	ck_assert_uint_eq(PREFILTER_DROP, run_prefilter(&prefilter_ip6, prefilter_icmp, sizeof(struct nd_router_advert)));
+}
+END_TEST
+#endif
+
+START_TEST(test_iface_socket_fallback)
+{
+	/* The socket of lo, bound to an index lo no longer has, that can't be bound again. */
+	int fds[2];
+	ck_assert_int_eq(0, pipe(fds));
+	struct iface_socket *is = calloc(1, sizeof(struct iface_socket));
+	ck_assert_ptr_ne(NULL, is);
+	strlcpy(is->name, "lo", sizeof(is->name));
+	is->if_index = 0x7fffffff;
+	is->sock = fds[0];
+	is->next = iface_sockets;
+	iface_sockets = is;
+
+	struct Interface iface;
+	iface_init_defaults(&iface);
+	strlcpy(iface.props.name, "lo", sizeof(iface.props.name));
+	iface.props.sock = fds[0];
+
+	/* lo falls back to the shared socket it is set up on, its own is closed. */
+	int shared = socket(AF_INET6, SOCK_DGRAM, 0);
+	ck_assert_int_ge(shared, 0);
+	setup_iface(shared, &iface);
+	ck_assert_int_eq(-1, iface.props.sock);
+	ck_assert_ptr_eq(NULL, find_iface_socket("lo"));
+	struct pollfd writer = {.fd = fds[1], .events = POLLOUT};
+	ck_assert_int_eq(1, poll(&writer, 1, 0));
+	ck_assert(writer.revents & POLLERR);
+
+	free(iface.props.if_addrs);
+	free_ra_cache(&iface);
+	close(shared);
+	close(fds[1]);
+}
+END_TEST
+
+Suite *socket_suite(void)
+{
+	TCase *tc_prefilter = tcase_create("prefilter");
+#ifdef HAVE_LINUX_FILTER_H
+	tcase_add_test(tc_prefilter, test_prefilter_rs);
+	tcase_add_test(tc_prefilter, test_prefilter_ra);
+	tcase_add_test(tc_prefilter, test_prefilter_other);
+#endif
+
+	TCase *tc_iface = tcase_create("iface");
+	tcase_add_test(tc_iface, test_iface_socket_fallback);
+
+	Suite *s = suite_create("socket");
+	suite_add_tcase(s, tc_prefilter);
+	suite_add_tcase(s, tc_iface);
+
+	return s;
+}
@@ -0,0 +1,198 @@
+
+#include <check.h>
+
+#define SIM_IFACES 100
+#define SIM_DAYS 7
+
+START_TEST(test_simulated_clock)
+{
+	struct timespec start = {1000, 500000000};
+	set_simulated_clock(&start);
+	set_clock_source(simulated_clock);
+
+	/* Time stands still until the driver moves it. */
+	struct timespec ts = next_timespec(1.5);
+	ck_assert_int_eq(1002, ts.tv_sec);
+	ck_assert_int_eq(0, ts.tv_nsec);
+	clock_now(&ts);
+	ck_assert_int_eq(0, timespecdiff(&ts, &start));
+
+	struct timespec later = {2000, 0};
+	set_simulated_clock(&later);
+	clock_now(&ts);
+	ck_assert_int_eq(999500, timespecdiff(&ts, &start));
+
+	set_clock_source(NULL);
+	clock_now(&ts);
+	ck_assert(timespecdiff(&ts, &later) != 0);
+}
+END_TEST
+
+/*
+ * The simulation harness: interfaces run through the scheduling core,
+ * expire_ifaces, timer_handler, reschedule_iface and send_ra_forall,
+ * against the simulated clock, with the RAs captured instead of sent.
+ */
+struct sim_capture {
+	int count;
+	struct timespec last;
+	int64_t min_interval;
+	int64_t max_interval;
+	int64_t max_initial_interval;
+};
+
+static struct Interface *sim_ifaces;
+static struct sim_capture *sim_captures;
+
+/* Stands in for sendmsg, an RA that isn't what the scheduler should send is a send error. */
+static ssize_t sim_transport(int sock, struct msghdr const *mhdr, int flags)
+{
+	struct msghdr msg = *mhdr;
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg)
+		return -1;
+
+	struct in6_pktinfo *pkt_info = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+	int i = pkt_info->ipi6_ifindex - 1;
+	if (i < 0 || i >= SIM_IFACES)
+		return -1;
+
+	struct sockaddr_in6 const *addr = msg.msg_name;
+	if (!IN6_IS_ADDR_MC_LINKLOCAL(&addr->sin6_addr) || ((unsigned char *)msg.msg_iov[0].iov_base)[0] != ND_ROUTER_ADVERT)
+		return -1;
+
+	struct sim_capture *capture = &sim_captures[i];
+	struct timespec now;
+	clock_now(&now);
+	if (capture->count > 0) {
+		int64_t interval = timespecdiff(&now, &capture->last);
+		if (capture->count < MAX_INITIAL_RTR_ADVERTISEMENTS) {
+			if (interval > capture->max_initial_interval)
+				capture->max_initial_interval = interval;
+		} else {
+			if (!capture->min_interval || interval < capture->min_interval)
+				capture->min_interval = interval;
+			if (interval > capture->max_interval)
+				capture->max_interval = interval;
+		}
+	}
+	capture->last = now;
+	++capture->count;
+
+	return msg.msg_iov[0].iov_len;
+}
+
+static void sim_setup(void)
+{
+	struct timespec start = {1000000, 0};
+	set_simulated_clock(&start);
+	set_clock_source(simulated_clock);
+	set_send_transport(sim_transport);
+	memset(&stats, 0, sizeof(stats));
+
+	sim_ifaces = calloc(SIM_IFACES, sizeof(struct Interface));
+	sim_captures = calloc(SIM_IFACES, sizeof(struct sim_capture));
+	ck_assert_ptr_ne(0, sim_ifaces);
+	ck_assert_ptr_ne(0, sim_captures);
+
+	for (int i = 0; i < SIM_IFACES; ++i) {
+		struct Interface *iface = &sim_ifaces[i];
+		iface_init_defaults(iface);
+		snprintf(iface->props.name, sizeof(iface->props.name), "sim%d", i);
+		iface->props.if_index = i + 1;
+		ck_assert_int_eq(1, inet_pton(AF_INET6, "fe80::1", &iface->props.if_addr));
+		iface->props.if_addr_rasrc = &iface->props.if_addr;
+		iface->props.max_ra_option_size = RFC2460_MIN_MTU;
+		iface->AdvSendAdvert = 1;
+		iface->MinRtrAdvInterval = DFLT_MinRtrAdvInterval(iface);
+		iface->state_info.changed = 0;
+		iface->state_info.ready = 1;
+
+		/* kicked off all at once */
+		pace_iface(iface, 0, i, SIM_IFACES);
+	}
+}
+
+static void sim_teardown(void)
+{
+	for (int i = 0; i < SIM_IFACES; ++i) {
+		iface_queue_remove(&sim_ifaces[i]);
+	}
+	free(sim_ifaces);
+	free(sim_captures);
+
+	set_send_transport(NULL);
+	set_clock_source(NULL);
+}
+
+/* Jumps from deadline to deadline, as the main loop would sleep, until the end. */
+static int sim_run(struct timespec const *end)
+{
+	int sock = -1;
+	int wakeups = 0;
+
+	for (;;) {
+		struct Interface *next = find_iface_by_time();
+		if (!next || timespecdiff(&next->times.next_multicast, end) > 0)
+			break;
+
+		/* to the ns, as expire_ifaces doesn't take a deadline less than a ms away for expired */
+		struct timespec now;
+		clock_now(&now);
+		struct timespec const *deadline = &next->times.next_multicast;
+		if (deadline->tv_sec > now.tv_sec || (deadline->tv_sec == now.tv_sec && deadline->tv_nsec > now.tv_nsec))
+			set_simulated_clock(deadline);
+
+		send_batch_begin();
+		expire_ifaces(timer_handler, &sock, MAX_EXPIRED_IFACES_PER_WAKEUP);
+		send_batch_end();
+		++wakeups;
+	}
+
+	return wakeups;
+}
+
+START_TEST(test_simulated_days)
+{
+	struct timespec end = next_timespec(SIM_DAYS * 24 * 60 * 60);
+	int wakeups = sim_run(&end);
+	ck_assert_int_gt(wakeups, 0);
+
+	int total = 0;
+	for (int i = 0; i < SIM_IFACES; ++i) {
+		struct Interface const *iface = &sim_ifaces[i];
+		struct sim_capture const *capture = &sim_captures[i];
+
+		/* RFC 4861 6.2.4: the initial RAs at most MAX_INITIAL_RTR_ADVERT_INTERVAL apart... */
+		ck_assert_int_le(capture->max_initial_interval, MAX_INITIAL_RTR_ADVERT_INTERVAL * 1000);
+
+		/* ...then the RAs randomly spaced within [MinRtrAdvInterval, MaxRtrAdvInterval]. */
+		ck_assert_int_ge(capture->min_interval, iface->MinRtrAdvInterval * 1000 - 1);
+		ck_assert_int_le(capture->max_interval, iface->MaxRtrAdvInterval * 1000 + 1);
+		ck_assert_int_ge(capture->count, SIM_DAYS * 24 * 60 * 60 / iface->MaxRtrAdvInterval);
+		ck_assert_int_le(capture->count,
+				 MAX_INITIAL_RTR_ADVERTISEMENTS + SIM_DAYS * 24 * 60 * 60 / iface->MinRtrAdvInterval);
+
+		total += capture->count;
+	}
+
+	ck_assert_int_eq(0, stats.tx_errors);
+	ck_assert_int_eq(total, stats.tx_packets);
+}
+END_TEST
+
+Suite *timer_suite(void)
+{
+	TCase *tc_clock = tcase_create("clock");
+	tcase_add_test(tc_clock, test_simulated_clock);
+
+	TCase *tc_sim = tcase_create("sim");
+	tcase_add_checked_fixture(tc_sim, sim_setup, sim_teardown);
+	tcase_add_test(tc_sim, test_simulated_days);
+
+	Suite *s = suite_create("timer");
+	suite_add_tcase(s, tc_clock);
+	suite_add_tcase(s, tc_sim);
+
+	return s;
+}
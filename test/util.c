@@ -106,6 +106,40 @@ START_TEST(test_safe_buffer_list_to_safe_buffer)
 }
 END_TEST
 
+START_TEST(test_safe_buffer_arena)
+{
+	struct safe_buffer_arena arena = {0};
+	struct safe_buffer_list *sbl = new_arena_safe_buffer_list(&arena);
+	char array[] = {"This is a test"};
+
+	for (int i = 0; i < 1000; ++i) {
+		sbl = safe_buffer_list_append(sbl);
+		safe_buffer_append(sbl->sb, array, sizeof(array));
+		ck_assert_ptr_eq(&arena, sbl->sb->arena);
+	}
+	ck_assert_str_eq((const char *)(sbl->sb->buffer), array);
+	ck_assert_int_gt(arena.allocations, 1);
+
+	/* Released in one step, the same build again takes nothing from the heap. */
+	size_t allocations = arena.allocations;
+	safe_buffer_arena_reset(&arena);
+	sbl = new_arena_safe_buffer_list(&arena);
+	for (int i = 0; i < 1000; ++i) {
+		sbl = safe_buffer_list_append(sbl);
+		safe_buffer_append(sbl->sb, array, sizeof(array));
+	}
+	ck_assert_int_eq(allocations, arena.allocations);
+
+	/* More than a block at once */
+	struct safe_buffer *sb = new_arena_safe_buffer(&arena);
+	safe_buffer_pad(sb, 16 * 1024);
+	ck_assert_int_eq(allocations + 1, arena.allocations);
+
+	safe_buffer_arena_free(&arena);
+	ck_assert_ptr_eq(0, arena.blocks);
+}
+END_TEST
+
 START_TEST(test_addrtostr)
 {
 	char buffer[INET6_ADDRSTRLEN] = {""};
@@ -277,6 +311,7 @@ Suite *util_suite(void)
 	TCase *tc_safe_buffer_list = tcase_create("safe_buffer_list");
 	tcase_add_test(tc_safe_buffer_list, test_safe_buffer_list);
 	tcase_add_test(tc_safe_buffer_list, test_safe_buffer_list_to_safe_buffer);
+	tcase_add_test(tc_safe_buffer_list, test_safe_buffer_arena);
 
 	TCase *tc_str = tcase_create("str");
 	tcase_add_test(tc_str, test_addrtostr);
@@ -16,13 +16,42 @@
 #include "config.h"
 #include "radvd.h"
 
+static void monotonic_clock(struct timespec *ts);
+
+/*
+ * Everything radvd schedules is timed against clock_now, which normally
+ * reads CLOCK_MONOTONIC.  Tests plug in simulated_clock instead, which
+ * only moves when told to, to run days of schedule in seconds.
+ */
+static void (*clock_source)(struct timespec *ts) = monotonic_clock;
+static struct timespec simulated_time;
+
+#ifdef UNIT_TEST
+#include "test/timer.c"
+#endif
+
+static void monotonic_clock(struct timespec *ts) { clock_gettime(CLOCK_MONOTONIC, ts); }
+
+void clock_now(struct timespec *ts) { clock_source(ts); }
+
+/* Use source as the clock, or CLOCK_MONOTONIC again if it is NULL. */
+void set_clock_source(void (*source)(struct timespec *ts)) { clock_source = source ? source : monotonic_clock; }
+
+void simulated_clock(struct timespec *ts) { *ts = simulated_time; }
+
+void set_simulated_clock(struct timespec const *ts) { simulated_time = *ts; }
+
 struct timespec next_timespec(double next)
 {
 	struct timespec ts;
 
-	clock_gettime(CLOCK_MONOTONIC, &ts);
+	clock_now(&ts);
 	ts.tv_sec += (int)next;
 	ts.tv_nsec += 1000000000ULL * (next - (int)next);
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec += ts.tv_nsec / 1000000000L;
+		ts.tv_nsec %= 1000000000L;
+	}
 	return ts;
 }
 
@@ -39,7 +68,7 @@ uint64_t next_time_msec(struct Interface const *iface)
 {
 	struct timespec ts;
 	int64_t diff_ms;
-	clock_gettime(CLOCK_MONOTONIC, &ts);
+	clock_now(&ts);
 	diff_ms = timespecdiff(&iface->times.next_multicast, &ts);
 	if (diff_ms <= 0)
 		return 0;
@@ -20,16 +20,39 @@
 #include "test/util.c"
 #endif
 
-struct safe_buffer *new_safe_buffer(void)
+struct radvd_stats stats;
+
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGN 16
+
+struct arena_block {
+	struct arena_block *next;
+	size_t size;
+	size_t used;
+	unsigned char __attribute__((aligned(ARENA_ALIGN))) data[];
+};
+
+struct safe_buffer *new_safe_buffer(void) { return new_arena_safe_buffer(NULL); }
+
+/**
+ * Create a new safe_buffer whose storage comes from arena, or from the heap
+ * if arena is NULL.  Arena buffers are released with the arena only.
+ */
+struct safe_buffer *new_arena_safe_buffer(struct safe_buffer_arena *arena)
 {
-	struct safe_buffer *sb = malloc(sizeof(struct safe_buffer));
+	struct safe_buffer *sb =
+	    arena ? safe_buffer_arena_alloc(arena, sizeof(struct safe_buffer)) : malloc(sizeof(struct safe_buffer));
 	*sb = SAFE_BUFFER_INIT;
-	sb->should_free = 1;
+	sb->should_free = !arena;
+	sb->arena = arena;
 	return sb;
 }
 
 void safe_buffer_free(struct safe_buffer *sb)
 {
+	if (sb && sb->arena)
+		return;
+
 	if (sb && sb->buffer) {
 		free(sb->buffer);
 		sb->buffer = NULL;
@@ -66,8 +89,73 @@ void safe_buffer_resize(struct safe_buffer *sb, size_t n)
 			exit(1);
 		}
 		sb->allocated = n;
-		sb->buffer = realloc(sb->buffer, sb->allocated);
+		if (sb->arena) {
+			unsigned char *buffer = safe_buffer_arena_alloc(sb->arena, sb->allocated);
+			if (sb->used > 0)
+				memcpy(buffer, sb->buffer, sb->used);
+			sb->buffer = buffer;
+		} else {
+			sb->buffer = realloc(sb->buffer, sb->allocated);
+		}
+	}
+}
+
+/**
+ * Take size bytes from arena, from the heap only if none of its blocks
+ * has room left.
+ */
+void *safe_buffer_arena_alloc(struct safe_buffer_arena *arena, size_t size)
+{
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+	struct arena_block *block = arena->current;
+	while (block && block->size - block->used < size)
+		block = block->next;
+
+	if (!block) {
+		size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+		block = malloc(sizeof(struct arena_block) + block_size);
+		if (!block) {
+			flog(LOG_ERR, "unable to grow a buffer arena by %zu bytes", block_size);
+			exit(1);
+		}
+		block->size = block_size;
+		block->used = 0;
+
+		/* appended, so a reset arena is bumped through the same blocks again */
+		block->next = NULL;
+		struct arena_block **last = &arena->blocks;
+		while (*last)
+			last = &(*last)->next;
+		*last = block;
+		++arena->allocations;
+	}
+
+	arena->current = block;
+	void *p = block->data + block->used;
+	block->used += size;
+	return p;
+}
+
+/**
+ * Release everything taken from arena at once, keeping its blocks.
+ */
+void safe_buffer_arena_reset(struct safe_buffer_arena *arena)
+{
+	for (struct arena_block *block = arena->blocks; block; block = block->next) {
+		block->used = 0;
+	}
+	arena->current = arena->blocks;
+}
+
+void safe_buffer_arena_free(struct safe_buffer_arena *arena)
+{
+	while (arena->blocks) {
+		struct arena_block *next = arena->blocks->next;
+		free(arena->blocks);
+		arena->blocks = next;
 	}
+	arena->current = NULL;
 }
 
 size_t safe_buffer_pad(struct safe_buffer *sb, size_t count)
@@ -95,10 +183,18 @@ size_t safe_buffer_append(struct safe_buffer *sb, void const *v, size_t count)
  *
  * @return new safe_buffer_list, with a safe_buffer on the heap.
  */
-struct safe_buffer_list *new_safe_buffer_list(void)
+struct safe_buffer_list *new_safe_buffer_list(void) { return new_arena_safe_buffer_list(NULL); }
+
+/**
+ * Create a new safe_buffer_list in arena, or on the heap if arena is NULL.
+ *
+ * @return new safe_buffer_list, with a safe_buffer in the same place.
+ */
+struct safe_buffer_list *new_arena_safe_buffer_list(struct safe_buffer_arena *arena)
 {
-	struct safe_buffer_list *sbl = malloc(sizeof(struct safe_buffer_list));
-	sbl->sb = new_safe_buffer();
+	struct safe_buffer_list *sbl =
+	    arena ? safe_buffer_arena_alloc(arena, sizeof(struct safe_buffer_list)) : malloc(sizeof(struct safe_buffer_list));
+	sbl->sb = new_arena_safe_buffer(arena);
 	sbl->next = NULL;
 	return sbl;
 }
@@ -116,7 +212,7 @@ struct safe_buffer_list *safe_buffer_list_append(struct safe_buffer_list *sbl)
 {
 	// Only allocate a new entry if this one has bytes in it.
 	if (sbl->sb && sbl->sb->used > 0) {
-		struct safe_buffer_list *next = new_safe_buffer_list();
+		struct safe_buffer_list *next = new_arena_safe_buffer_list(sbl->sb->arena);
 		sbl->next = next;
 		sbl = next;
 	}
@@ -147,11 +243,13 @@ void safe_buffer_list_free(struct safe_buffer_list *sbl)
 {
 	struct safe_buffer_list *next;
 	for (struct safe_buffer_list *current = sbl; current; current = next) {
+		next = current->next;
+		if (current->sb && current->sb->arena)
+			continue;
 		if (current->sb) {
 			safe_buffer_free(current->sb);
 			current->sb = NULL;
 		}
-		next = current->next;
 		free(current);
 	}
 }
@@ -276,6 +374,20 @@ int count_mask(struct sockaddr_in6 *m)
 	return count;
 }
 
+struct in6_addr prefixlen_mask(int prefixlen)
+{
+	struct in6_addr mask = {};
+	int i = 0;
+
+	for (; i < 16 && prefixlen >= 8; ++i, prefixlen -= 8) {
+		mask.s6_addr[i] = 0xff;
+	}
+	if (i < 16 && prefixlen > 0)
+		mask.s6_addr[i] = 0xff << (8 - prefixlen);
+
+	return mask;
+}
+
 struct in6_addr get_prefix6(struct in6_addr const *addr, struct in6_addr const *mask)
 {
 	struct in6_addr prefix = *addr;
@@ -318,3 +430,25 @@ int drop_root_privileges(const char *username)
 	}
 	return 0;
 }
+
+void log_stats(void)
+{
+	flog(LOG_INFO, "stats: received %" PRIu64 " packet(s) in %" PRIu64 " syscall(s), %.3f syscall(s) per packet",
+	     stats.rx_packets, stats.rx_syscalls, stats.rx_packets ? (double)stats.rx_syscalls / stats.rx_packets : 0.0);
+	flog(LOG_INFO, "stats: sent %" PRIu64 " RA(s) in %" PRIu64 " syscall(s), %.3f syscall(s) per RA, %" PRIu64 " error(s)",
+	     stats.tx_packets, stats.tx_syscalls, stats.tx_packets ? (double)stats.tx_syscalls / stats.tx_packets : 0.0,
+	     stats.tx_errors);
+	flog(LOG_INFO, "stats: at most %" PRIu64 " RA(s) sent within one second", stats.tx_peak_rate);
+	flog(LOG_INFO, "stats: %" PRIu64 " netlink event(s), %" PRIu64 " changing an interface, %" PRIu64 " of these coalesced",
+	     stats.netlink_events, stats.iface_touches, stats.iface_touches_coalesced);
+	flog(LOG_INFO, "stats: %" PRIu64 " netlink resync(s) after notifications were lost", stats.netlink_resyncs);
+
+	struct rusage usage;
+	double cpu = 0;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+		      (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+	}
+	flog(LOG_INFO, "stats: %" PRIu64 " wakeup(s), %" PRIu64 " timer(s) coalesced into another's wakeup, %.3f second(s) of CPU time",
+	     stats.wakeups, stats.timers_coalesced, cpu);
+}